@@ -17,6 +17,7 @@
 #define _LIB_BARRELFISH_AOS_MESSAGES_H
 
 #include <aos/aos.h>
+#include <aos/deferred.h>
 
 #define MAX_PROC_PAGES 1 << 16   // 256 mib (65536 pages)
 
@@ -53,9 +54,79 @@ enum msg_type {
     EXIT_MSG,
     WAIT_MSG,
     SPAWN_WITH_CAPS_MSG,
+    GET_ZEROED_FRAME,
+    PUTSTRING,
+    BENCH_SINK,      ///< payload init acknowledges without looking at it
+    BENCH_UMP,       ///< have init run the UMP benchmark between two cores
+    UMP_BENCH_PING,
+    UMP_BENCH_PONG,
+    UMP_BENCH_RUN,
+    UMP_BENCH_DONE,
+    NS_REGISTER,     ///< register a name for the server endpoint that comes along
+    NS_DEREGISTER,
+    NS_LOOKUP,       ///< find the core of a server, and its endpoint if it is on this one
+    NS_ENUMERATE,
+    NS_BIND_UMP,     ///< hand the frame that comes along to a server as a channel to it
+    NS_BIND_LMP,     ///< client to server: the client's endpoint for a new channel
+    NS_BIND_BULK,    ///< client to server: the bulk frame of a bound channel
+    NS_RPC,          ///< request on a channel between a client and a server
+    NS_REPLY,        ///< answer to any nameservice message sent over UMP
+    PROC_MGMT_REQ,   ///< ask the init that spawned a process about it
+    PROC_MGMT_REPLY,
+    MSG_TYPE_COUNT,  ///< number of message types, not a message type itself
 };
 
 
+/*
+ * The first word of every message carries the message type in its low 14 bits, flags in
+ * bits 14 and 15 and the id of the call it belongs to from bit 16 up. Replies echo the id of their request, which
+ * is how the client matches them to the waiting caller. Id 0 is never handed out.
+ *
+ * Bit 15 marks a message whose payload is sent inline: words[1] holds the usual argument,
+ * words[2] the payload length in bytes and the remaining words the start of the payload.
+ * The rest follows in as many plain 8-word messages as needed.
+ *
+ * Bit 14 marks a request whose payload has been placed in the request area of the bulk
+ * frame the domain shares with init, words[1] again holding the argument and words[2] the
+ * payload length. Results that do not fit into the reply word are left by init in the
+ * response area of the same frame.
+ */
+#define AOS_RPC_HDR(type, id)    (((uintptr_t)(id) << 16) | ((uintptr_t)(type) & 0x3fff))
+#define AOS_RPC_HDR_TYPE(hdr)    ((enum msg_type)((hdr) & 0x3fff))
+#define AOS_RPC_HDR_ID(hdr)      ((uint32_t)((hdr) >> 16))
+#define AOS_RPC_HDR_INLINE       ((uintptr_t)1 << 15)
+#define AOS_RPC_IS_INLINE(hdr)   (((hdr) & AOS_RPC_HDR_INLINE) != 0)
+#define AOS_RPC_HDR_BULK         ((uintptr_t)1 << 14)
+#define AOS_RPC_IS_BULK(hdr)     (((hdr) & AOS_RPC_HDR_BULK) != 0)
+/// bulk slot of a request, above the call id
+#define AOS_RPC_HDR_WITH_SLOT(slot)  ((uintptr_t)(slot) << 48)
+#define AOS_RPC_HDR_SLOT(hdr)        ((size_t)((hdr) >> 48) % AOS_RPC_BULK_SLOTS)
+
+/// largest payload sent inline, anything bigger goes through the bulk frame. With header,
+/// argument and length, it fits into one extended LMP message (LMP_LONG_MSG_LENGTH words)
+#define AOS_RPC_INLINE_MAX 1000
+
+/// size of each of the request and response areas of the bulk frame shared with init
+#define AOS_RPC_BULK_SIZE BASE_PAGE_SIZE
+
+/// bulk calls that may be outstanding on a channel at once, each one has its own areas
+#define AOS_RPC_BULK_SLOTS 4
+
+/// size of the bulk frame: the request areas of all slots, then their response areas
+#define AOS_RPC_BULK_FRAME_SIZE (2 * AOS_RPC_BULK_SLOTS * AOS_RPC_BULK_SIZE)
+
+/// maximum number of calls that can be outstanding on one channel at a time
+#define AOS_RPC_MAX_PENDING 16
+
+/// messages the endpoint of an RPC channel holds, the largest inline payload takes 15 of them
+#ifndef AOS_RPC_LMP_BUF_MSGS
+#define AOS_RPC_LMP_BUF_MSGS 16
+#endif
+
+/// size of the endpoint buffer of an RPC channel, in words
+#define AOS_RPC_LMP_BUF_WORDS LMP_BUF_WORDS(AOS_RPC_LMP_BUF_MSGS)
+
+
 /// type of the receive handler function.
 /// depending on your RPC implementation, maybe you want to slightly adapt this
 typedef void (*aos_recv_handler_fn)(void *rpc);
@@ -67,9 +138,38 @@ typedef void (*aos_recv_handler_fn)(void *rpc);
  * Note: the RPC binding should work over LMP (M4) or UMP (M6)
  */
 
-// store pointers to the URPC frames for the other three cores (BSP only)
+// store pointers to the URPC frames shared between the BSP and each other core
 // genvaddr_t global_urpc_frames[4];
 
+/// pages of slots of the UMP ring in each direction between the BSP and a core
+#define UMP_RING_PAGES 2
+
+/// pages of the area holding the data of large messages in each direction
+#define UMP_DATA_PAGES 8
+
+/*
+ * Layout of the URPC frame shared between the BSP and another core: one page with the
+ * bootinfo and, from half of it, the two struct ump_chan. The rings of both directions
+ * follow, then their data areas. Only the first MON_URPC_SIZE bytes are mapped by the
+ * kernel, init on the core maps the whole frame itself.
+ */
+#define UMP_URPC_FRAME_SIZE ((1 + 2 * (UMP_RING_PAGES + UMP_DATA_PAGES)) * BASE_PAGE_SIZE)
+#define UMP_URPC_RING_OFFSET(direction) ((1 + (direction) * UMP_RING_PAGES) * BASE_PAGE_SIZE)
+#define UMP_URPC_DATA_OFFSET(direction) \
+    ((1 + 2 * UMP_RING_PAGES + (direction) * UMP_DATA_PAGES) * BASE_PAGE_SIZE)
+
+/*
+ * Every pair of app cores talks over a frame of its own, with the same layout as the URPC
+ * frame minus the bootinfo. Direction 0 of it goes from the lower to the higher core id.
+ * The BSP sets them up and then publishes their physical addresses in the URPC frame of
+ * each core, at UMP_URPC_MESH_OFFSET.
+ */
+struct ump_mesh_info {
+    volatile uint64_t ready;                // set once the frames below are valid
+    genpaddr_t        frames[4];            // frame shared with each other core, 0 if none
+};
+#define UMP_URPC_MESH_OFFSET (BASE_PAGE_SIZE / 2 + 2 * sizeof(struct ump_chan))
+
 // get the correct struct ump_chan on the monitor
 // direction == 0: core -> monitor
 // direction == 1: monitor -> core
@@ -80,26 +180,82 @@ struct ump_chan *get_ump_chan_mon(coreid_t core, int direction);
 // direction == 1: monitor -> core
 struct ump_chan *get_ump_chan_core(int direction);
 
-// circular buffer for UMP messaging in a URPC frame
+/// number of cores that init can talk to over UMP
+#define UMP_MAX_CORES 4
+
+// get the channel between this core and another, on any core
+// direction == 0: this core -> core
+// direction == 1: core -> this core
+struct ump_chan *get_ump_chan_peer(coreid_t core, int direction);
+
+// whether there are channels between this core and another one yet
+bool ump_peer_connected(coreid_t core);
+
+// store pointers to the frames holding the direct channels to other app cores (app cores only)
+// genvaddr_t global_ump_mesh_frames[UMP_MAX_CORES];
+
+/// size of a cache line, the unit of transfer of UMP channels
+#define UMP_CACHE_LINE 64
+
+/// the consumer publishes freed slots to the producer after at most this many
+#define UMP_ACK_BATCH 16
+
+/*
+ * Single-producer/single-consumer ring of cache-line sized slots in a URPC frame. Each
+ * side only ever writes its own part of the control block, which sit on separate cache
+ * lines. The consumer spots new messages by the sequence number in the slot itself, so it
+ * never reads the producer's head. The producer only reads the consumer's acknowledged
+ * count when its cached copy says the ring is full, and the consumer only publishes that
+ * count every UMP_ACK_BATCH slots or when it runs dry.
+ *
+ * The data of large messages goes into a separate data area, allocated in order like the
+ * ring, and only a descriptor of it travels through the slots (see ump_send_data()). The
+ * receiver reads it in place and hands the space back with ump_msg_release().
+ */
 struct ump_chan {
-    size_t base;  // offset of base from struct ump_chan
-    size_t head;  // offset of head from base
-    size_t tail;  // offset of tail from base
-    size_t size;  // size of the buffer
-};
+    // set up once by ump_chan_init()
+    size_t base;       // offset of the slots from struct ump_chan
+    size_t size;       // size of the slot area in bytes
+    size_t data_base;  // offset of the data area from struct ump_chan
+    size_t data_size;  // size of the data area in bytes, 0 if there is none
+
+    // producer side
+    size_t head __attribute__((aligned(UMP_CACHE_LINE)));  // slots written so far
+    size_t acked_cache;                                    // last acked value read
+    size_t data_head;                                      // data bytes allocated so far
+    size_t data_acked_cache;                               // last data_acked value read
+    struct thread_mutex send_mutex;                        // serializes the sending threads
+
+    // consumer side
+    volatile size_t acked __attribute__((aligned(UMP_CACHE_LINE)));  // slots freed, published
+    size_t tail;                                                     // slots consumed so far
+    volatile size_t data_acked;  // data bytes freed, published
+    size_t data_seen;            // end of the furthest data released so far
+    struct thread_mutex release_mutex;  // serializes the threads releasing data
+    volatile uint32_t sleeping;  // core id + 1 of the receiver if it stopped polling, else 0
+} __attribute__((aligned(UMP_CACHE_LINE)));
 
 // circular ump chan buffer functions
+
+// add a message to the channel, yielding while there is no room for it
 errval_t ump_send(struct ump_chan *chan, char *buf, size_t size);
 
+// add a message to the channel, or fail with LIB_ERR_UMP_CHAN_FULL if there is no room
+errval_t ump_try_send(struct ump_chan *chan, char *buf, size_t size);
+
+// dequeue the next message if it is of the given type
 errval_t ump_receive(struct ump_chan *chan, enum msg_type type, void *buf);
 
+// copy out the next message without dequeuing it
+errval_t ump_peek(struct ump_chan *chan, void *buf);
+
 void ump_print(struct ump_chan *chan);
 
 struct cache_line {
     char payload[58];
     uint8_t frag_num;
     uint8_t total_frags;
-    uint32_t valid;
+    uint32_t seq;  // number of the slot since the channel was set up plus one, 0 if never written
 };
 
 struct ump_payload {
@@ -107,44 +263,246 @@ struct ump_payload {
     coreid_t send_core;  // core that sent the message
     coreid_t recv_core;  // core that should receive the message
     char payload[128];
+    uint32_t data_len;   // bytes of data in the channel's data area, 0 if none
+    size_t data_pos;     // where they are, set by ump_send_data()
 };
 
-struct aos_rpc {
-    struct lmp_chan *lmp_chan;
-    domainid_t pid;
+// send msg with len bytes of data placed in the channel's data area, yielding while full
+errval_t ump_send_data(struct ump_chan *chan, struct ump_payload *msg, const void *data,
+                       size_t len);
+
+// the data of a message received on chan, read in place, NULL if it has none
+void *ump_msg_data(struct ump_chan *chan, struct ump_payload *msg);
+
+// hand the space of the data of a received message back to the sender
+void ump_msg_release(struct ump_chan *chan, struct ump_payload *msg);
+
+// a capability on its way to another core, serialised and recreated by init
+struct ump_cap {
+    struct capability raw;  // as identified on the sending core, ObjType_Null if none
+    coreid_t owner;         // core that owns it and all its copies
 };
 
-struct aos_rpc_num_payload {
-    struct aos_rpc *rpc;
-    uintptr_t val;
+#define UMP_SPAWN_MAX_CAPS 2
+
+// payload of SPAWN_WITH_CAPS_MSG between cores, argv follows in the data area
+struct ump_spawn_caps {
+    int argc;
+    int capc;
+    struct ump_cap capv[UMP_SPAWN_MAX_CAPS];
+};
+STATIC_ASSERT(sizeof(struct ump_spawn_caps) <= sizeof(((struct ump_payload *)0)->payload),
+              "spawn request does not fit into a UMP message");
+
+/// longest name a service can be registered under, including the terminating NUL
+#define NS_NAME_LEN 64
+
+// payload of NS_BIND_UMP between cores, the frame holding the channel travels as cap
+struct ump_ns_bind {
+    struct ump_cap cap;
+    char name[NS_NAME_LEN];
 };
+STATIC_ASSERT(sizeof(struct ump_ns_bind) <= sizeof(((struct ump_payload *)0)->payload),
+              "nameservice bind request does not fit into a UMP message");
+
+/// what PROC_MGMT_REQ asks of the init that spawned a process
+enum ump_proc_op {
+    UMP_PROC_STATUS,    ///< its struct proc_status, sent back in the data area
+    UMP_PROC_TRY_WAIT,  ///< its exit status if it has terminated, it is reaped then
+    UMP_PROC_LIST,      ///< the PIDs of all running processes on that core, in the data area
+};
+
+// payload of PROC_MGMT_REQ between cores
+struct ump_proc_req {
+    enum ump_proc_op op;
+    domainid_t       pid;
+};
+
+// payload of PROC_MGMT_REPLY
+struct ump_proc_reply {
+    errval_t err;
+    int      status;      // exit status for UMP_PROC_TRY_WAIT
+    bool     terminated;  // whether UMP_PROC_TRY_WAIT found it terminated
+};
+
+/**
+ * @brief handler for one message type received on a demultiplexed UMP channel
+ *
+ * Returns true if it has dealt with the message, false to queue it for ump_demux_recv().
+ * Handlers run without any lock held and may themselves wait on the same channel.
+ */
+typedef bool (*ump_handler_fn)(struct ump_payload *msg, void *arg);
+
+struct ump_msg_node {
+    struct ump_payload   msg;
+    struct ump_msg_node *next;
+};
+
+struct ump_msg_queue {
+    struct ump_msg_node *head;
+    struct ump_msg_node *tail;
+};
+
+/*
+ * Receive side of a UMP channel that drains every message that is ready, instead of only the
+ * one at the tail of the ring, and sorts them into a software queue per message type. A
+ * message nobody is waiting for yet so no longer holds up the ones behind it.
+ */
+struct ump_demux {
+    struct ump_chan      *chan;
+    struct thread_mutex   mutex;
+    struct ump_msg_queue  queues[MSG_TYPE_COUNT];
+    ump_handler_fn        handlers[MSG_TYPE_COUNT];
+    void                 *handler_args[MSG_TYPE_COUNT];
+    struct ump_msg_node  *free;  // recycled queue nodes
+    struct thread_mutex   call_mutex;  // held from sending a request until its reply is in
+
+    // waitset binding, see ump_demux_register_waitset()
+    struct waitset_chanstate waitset_state;
+    struct waitset          *ws;
+    struct deferred_event    park_timer;
+    uint32_t                 empty_polls;  // polls in a row that found nothing
+    uint32_t                 skip;         // polls left to skip while backing off
+    bool                     parked;       // polled for too long without a message
+    bool                     asleep;       // no longer polled, waiting for the timer or an IPI
+};
+
+/*
+ * Polling policy of a demultiplexer bound to a waitset. The dispatcher checks the channel on
+ * every run and yield. After UMP_POLL_SPIN checks in a row that found nothing, it skips more
+ * and more of them, up to UMP_POLL_MAX_SKIP. After UMP_POLL_PARK empty checks the channel
+ * stops being polled altogether and is only looked at every UMP_POLL_PARK_US, so an idle
+ * dispatcher can block. Any message resets it to checking every time.
+ */
+#define UMP_POLL_SPIN     64
+#define UMP_POLL_MAX_SKIP 64
+#define UMP_POLL_PARK     1024
+#define UMP_POLL_PARK_US  1000
 
-struct aos_rpc_string_payload {
-    struct aos_rpc *rpc;
-    struct capref frame;
-    size_t len;
+/*
+ * With notifications set up (ump_notify_init()), a receiver that stops polling marks its
+ * channels as sleeping and the sender raises an IPI on its core with the next message. The
+ * timer is then only a fallback, in case the sender could not send one.
+ */
+#define UMP_POLL_PARK_NOTIFY_US 100000
+
+// set up demultiplexing of the messages received on chan
+void ump_demux_init(struct ump_demux *dm, struct ump_chan *chan);
+
+// have messages of the given type passed to fn as soon as they are received
+void ump_demux_register(struct ump_demux *dm, enum msg_type type, ump_handler_fn fn, void *arg);
+
+// drain all ready messages from the channel, dispatching or queueing them
+errval_t ump_demux_poll(struct ump_demux *dm);
+
+// get the oldest queued message of the given type, LIB_ERR_NO_UMP_MSG if there is none yet
+errval_t ump_demux_recv(struct ump_demux *dm, enum msg_type type, struct ump_payload *msg);
+
+// the demultiplexer of the channel returned by get_ump_chan_peer(core, 1)
+struct ump_demux *get_ump_demux_peer(coreid_t core);
+
+// drain the channels from all connected cores
+errval_t ump_demux_poll_peers(void);
+
+// have the channel polled by the dispatcher, running ump_demux_poll() from ws when a message arrives
+errval_t ump_demux_register_waitset(struct ump_demux *dm, struct waitset *ws);
+
+// check for a message while disabled, for the dispatcher's polling of waitset channels
+bool ump_demux_poll_disabled(struct waitset_chanstate *chan);
+
+// have senders wake up receivers on this core that stopped polling with an IPI, handled on ws
+errval_t ump_notify_init(struct waitset *ws);
+
+// wait for a message of the given type: spin briefly, then keep polling all peers and yield.
+// Threads expecting the same type of reply from one peer hold its call_mutex until they got it.
+errval_t ump_demux_wait(struct ump_demux *dm, enum msg_type type, struct ump_payload *msg);
+
+/**
+ * @brief one outstanding call on an RPC channel
+ *
+ * Synchronous calls keep this on the stack of the calling thread. For asynchronous calls it
+ * is the handle returned to the caller, who must keep it alive until the call has completed
+ * and, if a completion closure was given, until that closure has run.
+ */
+struct aos_rpc_call {
+    uint32_t       id;
+    bool           done;
+    enum msg_type  type;    ///< message type of the reply
+    uintptr_t      val;     ///< payload word of the reply
+    struct capref  cap;     ///< capability sent with the reply, or NULL_CAP
+    char          *buf;     ///< receives an inline reply payload, or NULL
+    size_t         buflen;  ///< size of buf in bytes
+    size_t         len;     ///< length of the inline reply payload
+
+    // asynchronous calls only
+    bool                      async;
+    struct waitset           *done_ws;    ///< waitset the completion closure runs on, or NULL
+    struct event_closure      done_cl;
+    struct waitset_chanstate  done_chan;
 };
 
-struct aos_rpc_cmdline_payload {
-    struct aos_rpc   *rpc;
-    struct capref     frame;
-           size_t     len;
-           coreid_t   core;
-           domainid_t pid;
+/// reassembly state for an inline payload arriving in several messages
+struct aos_rpc_inline_rx {
+    uintptr_t hdr;    ///< header word of the first message
+    uintptr_t arg;    ///< argument word of the first message
+    size_t    len;    ///< payload length in bytes
+    size_t    off;    ///< bytes received so far
+    char      buf[AOS_RPC_INLINE_MAX + 1];  ///< payload, NUL-terminated once complete
 };
 
-struct aos_rpc_ram_cap_req_payload {
-    struct aos_rpc *rpc;
-    size_t bytes;
-    size_t alignment;
+/// a reply that found the client's buffer full, sent later from the default waitset
+struct aos_rpc_txq_msg {
+    struct aos_rpc_txq_msg *next;
+    lmp_send_flags_t        flags;
+    struct capref           cap;       ///< our copy, deleted once sent
+    size_t                  nwords;
+    uintptr_t               words[];
 };
 
-struct aos_rpc_ram_cap_resp_payload {
-    struct aos_rpc *rpc;
-    struct capref ret_cap;
-    size_t ret_bytes;
+struct aos_rpc {
+    struct lmp_chan *lmp_chan;
+    domainid_t pid;
+
+    // client side: calls waiting for their reply
+    struct waitset       ws;           ///< replies are dispatched only on this waitset
+    struct thread_mutex  mutex;        ///< protects pending, next_id and pump
+    struct thread_cond   cond;         ///< signalled on every reply and pump hand-off
+    struct thread_mutex  send_mutex;   ///< keeps concurrent senders off the channel
+    struct aos_rpc_call *pending[AOS_RPC_MAX_PENDING];  ///< indexed by id % MAX_PENDING
+    uint32_t             next_id;
+    struct thread       *pump;         ///< thread currently dispatching ws, if any
+
+    struct aos_rpc_inline_rx rx;       ///< inline payload being received (both sides)
+
+    // server side: replies never wait for the client, they are queued instead (send_mutex)
+    struct aos_rpc_txq_msg *txq_head;
+    struct aos_rpc_txq_msg *txq_tail;
+
+    // asynchronous calls: a thread drains replies while any of them is outstanding
+    struct thread       *async_pump;
+    struct thread_cond   async_cond;   ///< signalled when the first async call is started
+    size_t               async_pending;
+
+    // bulk frame shared with init, mapped once when the channel is set up
+    void                *bulk_req;     ///< request areas, written by the client
+    void                *bulk_resp;    ///< response areas, written by init
+    struct thread_mutex  bulk_mutex;   ///< protects bulk_busy (client side)
+    struct thread_cond   bulk_cond;    ///< signalled when a slot is released
+    uint32_t             bulk_busy;    ///< slots of outstanding bulk calls, one bit each
 };
 
+/// request area of the bulk slot named in the header of a request
+static inline void *aos_rpc_bulk_req(struct aos_rpc *rpc, uintptr_t hdr)
+{
+    return (char *)rpc->bulk_req + AOS_RPC_HDR_SLOT(hdr) * AOS_RPC_BULK_SIZE;
+}
+
+/// response area of the bulk slot named in the header of a request
+static inline void *aos_rpc_bulk_resp(struct aos_rpc *rpc, uintptr_t hdr)
+{
+    return (char *)rpc->bulk_resp + AOS_RPC_HDR_SLOT(hdr) * AOS_RPC_BULK_SIZE;
+}
+
 struct get_all_pids_frame_output {
     size_t      num_pids;
     domainid_t  pids[128];
@@ -155,47 +513,27 @@ struct get_elf_mod_names_output {
     char     names[MOD_NAME_MAX_NUM][MOD_NAME_LEN];
 };
 
-struct get_pid_frame_output {
-    domainid_t pid;
-};
-
-struct wait_frame_output {
-    int status;
+/// response of the nameservice requests in the bulk frame, the error is the reply word
+struct ns_frame_output {
+    coreid_t core;   ///< NS_LOOKUP: core the server runs on
+    size_t   num;    ///< NS_ENUMERATE: number of names that follow
+    char     names[];  ///< NS_ENUMERATE: NUL-terminated names, back to back
 };
 
+/// request of SPAWN_WITH_CAPS_MSG in the bulk frame, the capability travels with the message
 struct spawn_with_caps_frame_input {
     int argc;
-    char argv[8][8];
     int capc;
-    struct capref cap;
     coreid_t core;
-    domainid_t pid;
+    char argv[];    ///< argc NUL-terminated strings, back to back
 };
 
-// global send acknowledgement handler
-void send_ack_handler(void *arg);
-
-// global send ack with a pid handler
-void send_pid_handler(void *arg);
-
-// global send char handler (getchar)
-void send_char_handler(void *arg);
-
-// global send ram cap response handler
-void send_ram_cap_resp_handler(void *arg); 
-
 // global receive handler
 void gen_recv_handler(void *arg);
 
-// global ack handler (for processes)
-void ack_recv_handler(void *arg);
-
 // for serial
 void char_recv_handler(void *arg);
 
-// child process setup message send handler
-void setup_send_handler(void *arg);
-
 // general handler for recieving an ack with a pid in it.
 void pid_recv_handler(void* arg);
 
@@ -208,7 +546,184 @@ void pid_recv_handler(void* arg);
  */
 errval_t aos_rpc_init(struct aos_rpc *rpc);
 
-errval_t ump_chan_init(struct ump_chan *chan, size_t base);
+/**
+ * @brief Start a call on an RPC channel without waiting for its reply.
+ *
+ * @param[in]  rpc   the RPC channel to use
+ * @param[in]  type  message type of the request
+ * @param[in]  cap   capability to send with the request, or NULL_CAP
+ * @param[in]  arg1  first payload word of the request
+ * @param[in]  arg2  second payload word of the request
+ * @param[in]  ws    waitset to run closure on once the reply has arrived, or NULL
+ * @param[in]  cl    completion closure, ignored if ws is NULL
+ * @param[out] call  handle of the call, filled in with the reply on completion
+ *
+ * @returns SYS_ERR_OK once the request has been sent, or error value on failure
+ *
+ * Note: the reply is collected by a thread of the library, so neither the caller nor ws
+ * have to be dispatched for the call to complete. Use aos_rpc_call_test() or
+ * aos_rpc_call_await() to treat the handle as a future.
+ */
+errval_t aos_rpc_call_async(struct aos_rpc *rpc, enum msg_type type, struct capref cap,
+                            uintptr_t arg1, uintptr_t arg2, struct waitset *ws,
+                            struct event_closure cl, struct aos_rpc_call *call);
+
+/**
+ * @brief Start a call whose request carries up to AOS_RPC_INLINE_MAX bytes inline.
+ *
+ * Same as aos_rpc_call_async() otherwise.
+ */
+errval_t aos_rpc_call_async_inline(struct aos_rpc *rpc, enum msg_type type, uintptr_t arg,
+                                   const void *data, size_t len, struct waitset *ws,
+                                   struct event_closure cl, struct aos_rpc_call *call);
+
+/**
+ * @brief Check whether an asynchronous call has completed, without blocking.
+ */
+bool aos_rpc_call_test(struct aos_rpc *rpc, struct aos_rpc_call *call);
+
+/**
+ * @brief Block until an asynchronous call has completed.
+ *
+ * @param[in] rpc   the RPC channel the call was started on
+ * @param[in] call  handle of the call
+ *
+ * @returns SYS_ERR_OK on success, or error value on failure
+ */
+errval_t aos_rpc_call_await(struct aos_rpc *rpc, struct aos_rpc_call *call);
+
+/**
+ * @brief Reply to a request received on an RPC channel (server side).
+ *
+ * @param[in] rpc      the channel the request arrived on
+ * @param[in] req_hdr  first word of the request, its call id is echoed in the reply
+ * @param[in] type     message type of the reply
+ * @param[in] cap      capability to send with the reply, or NULL_CAP
+ * @param[in] val      payload word of the reply
+ *
+ * @returns SYS_ERR_OK on success, or error value on failure
+ *
+ * Note: the reply is sent right away rather than from a send closure, so that a client
+ * pipelining several requests gets one reply for each of them.
+ */
+errval_t aos_rpc_reply(struct aos_rpc *rpc, uintptr_t req_hdr, enum msg_type type,
+                       struct capref cap, uintptr_t val);
+
+/**
+ * @brief Reply to a request with a payload of up to AOS_RPC_INLINE_MAX bytes sent inline.
+ *
+ * @param[in] rpc      the channel the request arrived on
+ * @param[in] req_hdr  first word of the request, its call id is echoed in the reply
+ * @param[in] type     message type of the reply
+ * @param[in] val      argument word of the reply
+ * @param[in] data     the payload
+ * @param[in] len      length of the payload in bytes
+ *
+ * @returns SYS_ERR_OK on success, or error value on failure
+ */
+errval_t aos_rpc_reply_inline(struct aos_rpc *rpc, uintptr_t req_hdr, enum msg_type type,
+                              uintptr_t val, const void *data, size_t len);
+
+/**
+ * @brief Feed a received message into the inline payload reassembly of a channel.
+ *
+ * @param[in]     rpc  the channel the message arrived on
+ * @param[in,out] msg  the received message, extended messages included
+ *
+ * @returns true if msg is ready to be handled, false if it only carried part of an inline
+ *          payload and more messages are to follow
+ *
+ * When the last part of an inline payload arrives, the first three words of msg are
+ * restored to those of the first message so that it can be handled like any other. The
+ * payload itself is then in rpc->rx.buf. A payload sent as one extended message is complete
+ * right away.
+ */
+bool aos_rpc_inline_recv(struct aos_rpc *rpc, struct lmp_recv_long_msg *msg);
+
+/**
+ * @brief Map the bulk frame shared between a domain and init into the caller's vspace.
+ *
+ * @param[in] rpc    the channel the frame belongs to
+ * @param[in] frame  frame of AOS_RPC_BULK_FRAME_SIZE bytes, request areas first
+ *
+ * @returns SYS_ERR_OK on success, or error value on failure
+ *
+ * Note: both sides map the frame exactly once, when the channel is set up. Payloads that
+ * do not fit inline are then copied through it instead of through a fresh frame per call.
+ */
+errval_t aos_rpc_bulk_map(struct aos_rpc *rpc, struct capref frame);
+
+/**
+ * @brief Set up one direction of a UMP channel.
+ *
+ * @param[in] chan       control block of the channel, shared by both sides
+ * @param[in] base       offset of the ring slots from chan
+ * @param[in] size       size of the ring in bytes, a multiple of the size of a slot
+ * @param[in] data_base  offset of the data area for large messages from chan
+ * @param[in] data_size  size of the data area in bytes, 0 if large messages are not needed
+ *
+ * @returns SYS_ERR_OK
+ */
+errval_t ump_chan_init(struct ump_chan *chan, size_t base, size_t size, size_t data_base,
+                       size_t data_size);
+
+/**
+ * @brief Set up both directions of a UMP channel in a frame laid out like a URPC frame.
+ *
+ * @param[in] frame  mapping of a frame of UMP_URPC_FRAME_SIZE bytes
+ */
+void ump_frame_init(void *frame);
+
+// get one direction of the channel in a frame laid out like a URPC frame
+struct ump_chan *ump_frame_chan(void *frame, int direction);
+
+/**
+ * @brief Set up an RPC channel to a server on this core that listens on an endpoint.
+ *
+ * @param[in] rpc  the aos_rpc struct to initialize
+ * @param[in] ep   the endpoint the server accepts new channels on
+ *
+ * @returns SYS_ERR_OK on success, or error value on failure
+ *
+ * The server answers from an endpoint of its own for the channel. A bulk frame is then
+ * shared with it like the one every domain shares with init.
+ */
+errval_t aos_rpc_bind(struct aos_rpc *rpc, struct capref ep);
+
+/**
+ * @brief Perform a call with a payload of any size up to AOS_RPC_BULK_SIZE bytes.
+ *
+ * @param[in]  rpc      the RPC channel to use, set up by aos_rpc_bind()
+ * @param[in]  type     message type of the request
+ * @param[in]  cap      capability to send with the request, or NULL_CAP
+ * @param[in]  data     the payload
+ * @param[in]  len      length of the payload in bytes
+ * @param[out] out      receives the payload of the reply, AOS_RPC_BULK_SIZE bytes
+ * @param[out] outlen   length of the payload of the reply
+ * @param[out] call     filled in with the reply, including the capability sent with it
+ *
+ * @returns SYS_ERR_OK on success, or error value on failure
+ *
+ * Small payloads without a capability go inline, everything else through the bulk frame.
+ * The server answers with aos_rpc_reply_msg().
+ */
+errval_t aos_rpc_call_msg(struct aos_rpc *rpc, enum msg_type type, struct capref cap,
+                          const void *data, size_t len, void *out, size_t *outlen,
+                          struct aos_rpc_call *call);
+
+/**
+ * @brief Reply to a request made with aos_rpc_call_msg() (server side).
+ *
+ * @param[in] rpc      the channel the request arrived on
+ * @param[in] req_hdr  first word of the request, its call id is echoed in the reply
+ * @param[in] cap      capability to send with the reply, or NULL_CAP
+ * @param[in] data     the payload of the reply
+ * @param[in] len      length of the payload in bytes, at most AOS_RPC_BULK_SIZE
+ *
+ * @returns SYS_ERR_OK on success, or error value on failure
+ */
+errval_t aos_rpc_reply_msg(struct aos_rpc *rpc, uintptr_t req_hdr, struct capref cap,
+                           const void *data, size_t len);
 
 
 
@@ -272,6 +787,47 @@ errval_t aos_rpc_get_ram_cap(struct aos_rpc *chan, size_t bytes, size_t alignmen
                              struct capref *retcap, size_t *ret_bytes);
 
 
+/**
+ * @brief Start a request for a RAM capability with >= bytes of size
+ *
+ * @param[in]  chan       the RPC channel to use (memory channel)
+ * @param[in]  bytes      minimum number of bytes to request
+ * @param[in]  alignment  minimum alignment of the requested RAM capability
+ * @param[in]  ws         waitset to run closure on once the reply has arrived, or NULL
+ * @param[in]  cl         completion closure, ignored if ws is NULL
+ * @param[out] call       handle of the request
+ *
+ * @returns SYS_ERR_OK on success, or error value on failure
+ *
+ * Channel: memory
+ *
+ * Note: on completion call->cap holds the capability, NULL_CAP if the request was refused,
+ * and call->val its size in bytes.
+ */
+errval_t aos_rpc_get_ram_cap_async(struct aos_rpc *chan, size_t bytes, size_t alignment,
+                                   struct waitset *ws, struct event_closure cl,
+                                   struct aos_rpc_call *call);
+
+
+/**
+ * @brief Request a frame capability whose memory is already zeroed
+ *
+ * @param[in]  chan       the RPC channel to use (memory channel)
+ * @param[in]  bytes      minimum number of bytes to request
+ * @param[out] retcap     received frame capability
+ * @param[out] ret_bytes  size of the received frame in bytes
+ *
+ * @returns SYS_ERR_OK on success, or error value on failure
+ *
+ * Channel: memory
+ *
+ * Note: the frame comes from init's pre-zeroed pool, so neither the caller nor the
+ * kernel has to clear it on the critical path.
+ */
+errval_t aos_rpc_get_zeroed_frame(struct aos_rpc *chan, size_t bytes, struct capref *retcap,
+                                  size_t *ret_bytes);
+
+
 /*
  * ------------------------------------------------------------------------------------------------
  * AOS RPC: Serial Channel
@@ -301,6 +857,21 @@ errval_t aos_rpc_serial_getchar(struct aos_rpc *chan, char *retc);
 errval_t aos_rpc_serial_putchar(struct aos_rpc *chan, char c);
 
 
+/**
+ * @brief sends a string of characters to the serial
+ *
+ * @param chan  the RPC channel to use (serial channel)
+ * @param buf   the characters to send, need not be NUL-terminated
+ * @param len   number of characters to send
+ *
+ * @return SYS_ERR_OK on success, or error value on failure
+ *
+ * Note: up to AOS_RPC_INLINE_MAX characters go inline, longer strings are passed through
+ * the bulk frame shared with init. Either way init writes them out in one go.
+ */
+errval_t aos_rpc_serial_putstring(struct aos_rpc *chan, const char *buf, size_t len);
+
+
 /*
  * ------------------------------------------------------------------------------------------------
  * AOS RPC: Process Management
@@ -343,6 +914,24 @@ errval_t aos_rpc_proc_spawn_with_cmdline(struct aos_rpc *chan, const char *cmdli
                                          domainid_t *newpid);
 
 
+/**
+ * @brief starts a request to spawn a new process with the supplied commandline
+ *
+ * @param[in]  chan     the RPC channel to use (process channel)
+ * @param[in]  cmdline  command line of the new process, at most AOS_RPC_INLINE_MAX bytes
+ * @param[in]  core     core on which to spawn the new process on
+ * @param[in]  ws       waitset to run closure on once the reply has arrived, or NULL
+ * @param[in]  cl       completion closure, ignored if ws is NULL
+ * @param[out] call     handle of the request, call->val holds the PID on completion
+ *
+ * @return SYS_ERR_OK on success, or error value on failure
+ */
+errval_t aos_rpc_proc_spawn_with_cmdline_async(struct aos_rpc *chan, const char *cmdline,
+                                               coreid_t core, struct waitset *ws,
+                                               struct event_closure cl,
+                                               struct aos_rpc_call *call);
+
+
 /**
  * @brief requests a new process to be spawned with the default arguments
  *
@@ -388,9 +977,9 @@ errval_t aos_rpc_proc_get_status(struct aos_rpc *chan, domainid_t pid, coreid_t
 /**
  * @brief obtains the name of a process with a given PID
  *
- * @param[in] chan  the RPC channel to use (process channel)
- * @param[in] name  the name of the process to search for
- * @param[in] pid   returns PID of the process to pause/suspend
+ * @param[in]  chan  the RPC channel to use (process channel)
+ * @param[in]  pid   PID of the process
+ * @param[out] name  returns the name of the process (freed by caller)
  *
  * @return SYS_ERR_OK on success, or error value on failure
  */
@@ -495,6 +1084,102 @@ errval_t aos_rpc_proc_kill(struct aos_rpc *chan, domainid_t pid);
 errval_t aos_rpc_proc_kill_all(struct aos_rpc *chan, const char *name);
 
 
+/// round trips of a single message timed by the UMP benchmark
+#define UMP_BENCH_ROUNDS 256
+
+/// messages streamed by the UMP benchmark to measure throughput
+#define UMP_BENCH_STREAM 4096
+
+/// result of the UMP benchmark, times in cycles of the sending core (see rdccnt())
+struct ump_bench_result {
+    uint64_t rtt[UMP_BENCH_ROUNDS];  ///< round trip of each message, in order
+    uint64_t stream_cycles;          ///< to stream UMP_BENCH_STREAM messages, until acked
+};
+
+/**
+ * @brief sends a payload that init acknowledges without processing it
+ *
+ * @param[in] chan  the RPC channel to use (init channel)
+ * @param[in] buf   the payload, sent inline or through the bulk frame depending on its size
+ * @param[in] len   length of the payload, at most AOS_RPC_BULK_SIZE bytes
+ *
+ * @return SYS_ERR_OK on success, or error value on failure
+ */
+errval_t aos_rpc_bench_sink(struct aos_rpc *chan, const void *buf, size_t len);
+
+/**
+ * @brief has init time UMP messages between two cores
+ *
+ * @param[in]  chan  the RPC channel to use (init channel)
+ * @param[in]  from  core whose init sends the messages
+ * @param[in]  to    core whose init answers them
+ * @param[out] res   the measurements
+ *
+ * @return SYS_ERR_OK on success, or error value on failure
+ */
+errval_t aos_rpc_bench_ump(struct aos_rpc *chan, coreid_t from, coreid_t to,
+                           struct ump_bench_result *res);
+
+/**
+ * @brief registers a server endpoint under a name
+ *
+ * @param[in] chan  the RPC channel to use (init channel)
+ * @param[in] name  the name, shorter than NS_NAME_LEN
+ * @param[in] ep    endpoint the server accepts new channels on
+ *
+ * @return SYS_ERR_OK on success, or error value on failure
+ */
+errval_t aos_rpc_ns_register(struct aos_rpc *chan, const char *name, struct capref ep);
+
+/**
+ * @brief removes a name registered with aos_rpc_ns_register()
+ *
+ * @param[in] chan  the RPC channel to use (init channel)
+ * @param[in] name  the name
+ *
+ * @return SYS_ERR_OK on success, or error value on failure
+ */
+errval_t aos_rpc_ns_deregister(struct aos_rpc *chan, const char *name);
+
+/**
+ * @brief finds the server registered under a name
+ *
+ * @param[in]  chan  the RPC channel to use (init channel)
+ * @param[in]  name  the name
+ * @param[out] core  the core the server runs on
+ * @param[out] ep    its endpoint if it runs on this core, NULL_CAP otherwise
+ *
+ * @return SYS_ERR_OK on success, or error value on failure
+ */
+errval_t aos_rpc_ns_lookup(struct aos_rpc *chan, const char *name, coreid_t *core,
+                           struct capref *ep);
+
+/**
+ * @brief lists the registered names starting with a prefix
+ *
+ * @param[in]  chan   the RPC channel to use (init channel)
+ * @param[in]  query  the prefix
+ * @param[out] out    receives the names, AOS_RPC_BULK_SIZE bytes
+ *
+ * @return SYS_ERR_OK on success, or error value on failure
+ */
+errval_t aos_rpc_ns_enumerate(struct aos_rpc *chan, const char *query,
+                              struct ns_frame_output *out);
+
+/**
+ * @brief has init hand a frame to a server on another core as a UMP channel to it
+ *
+ * @param[in] chan   the RPC channel to use (init channel)
+ * @param[in] name   the name the server is registered under
+ * @param[in] core   the core it runs on
+ * @param[in] frame  frame of UMP_URPC_FRAME_SIZE bytes set up with ump_frame_init()
+ *
+ * @return SYS_ERR_OK on success, or error value on failure
+ */
+errval_t aos_rpc_ns_bind_ump(struct aos_rpc *chan, const char *name, coreid_t core,
+                             struct capref frame);
+
+
 
 
 /**
@@ -110,6 +110,9 @@ static inline errval_t cap_retype(struct capref dest, struct capref src, gensize
     return cap_retype_many(dest, src, offset, new_type, objsize, 1);
 }
 
+errval_t frame_retype_prezeroed(struct capref dest, struct capref src, gensize_t offset,
+                                gensize_t bytes);
+
 
 /**
  * @brief creates a new capability with the given size and type (limited )
@@ -33,6 +33,15 @@ invoke_monitor_spawn_core(hwid_t core_id, enum cpu_type cpu_type,
                        entry, context, psci_use_hvc).error;
 }
 
+/**
+ * \brief Raise a notification IPI (IPI_NOTIFY_SGI) on another core.
+ */
+static inline errval_t
+invoke_ipi_notify(coreid_t core_id)
+{
+    return cap_invoke2(cap_ipi, IPICmd_Send_Notify, core_id).error;
+}
+
 static inline errval_t
 invoke_monitor_create_cap(uint64_t *raw, capaddr_t caddr, int level,
         capaddr_t slot, coreid_t owner)
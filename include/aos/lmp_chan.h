@@ -41,6 +41,7 @@ struct lmp_chan {
     } connstate;
 
     size_t buflen_words;    ///< requested LMP buffer length, in words
+    uintptr_t *long_buf;    ///< send buffer of extended messages, NULL until first used
 };
 
 void lmp_chan_init(struct lmp_chan *lc);
@@ -52,6 +53,10 @@ errval_t lmp_chan_register_send(struct lmp_chan *lc, struct waitset *ws,
 errval_t lmp_chan_deregister_send(struct lmp_chan *lc);
 void lmp_chan_migrate_send(struct lmp_chan *lc, struct waitset *ws);
 errval_t lmp_chan_alloc_recv_slot(struct lmp_chan *lc);
+errval_t lmp_chan_recv(struct lmp_chan *lc, struct lmp_recv_msg *msg, struct capref *cap);
+errval_t lmp_chan_recv_long(struct lmp_chan *lc, struct lmp_recv_long_msg *msg,
+                            struct capref *cap);
+uintptr_t *lmp_chan_long_buf(struct lmp_chan *lc);
 void lmp_channels_retry_send_disabled(dispatcher_handle_t handle);
 
 /**
@@ -95,24 +100,6 @@ static inline void lmp_chan_migrate_recv(struct lmp_chan *lc,
     lmp_endpoint_migrate(lc->endpoint, ws);
 }
 
-/**
- * \brief Receive a message from an LMP channel, if possible
- *
- * Non-blocking. May fail if no message is available.
- *
- * \param lc  LMP channel
- * \param msg LMP message buffer, to be filled-in
- * \param cap If non-NULL, filled-in with location of received capability, if any
- */
-static inline errval_t lmp_chan_recv(struct lmp_chan *lc,
-                                     struct lmp_recv_msg *msg,
-                                     struct capref *cap)
-{
-    assert(msg != NULL);
-    assert(msg->buf.buflen == LMP_MSG_LENGTH);
-    return lmp_endpoint_recv(lc->endpoint, &msg->buf, cap);
-}
-
 /**
  * \brief Check if a channel has data to receive
  */
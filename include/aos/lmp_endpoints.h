@@ -27,8 +27,11 @@ __BEGIN_DECLS
 /// In-endpoint size of a maximum-sized LMP message plus header
 #define LMP_RECV_LENGTH         (LMP_MSG_LENGTH + LMP_RECV_HEADER_LENGTH)
 
+/// Size of an LMP endpoint buffer (in words) holding n maximum-sized messages
+#define LMP_BUF_WORDS(n)                (LMP_RECV_LENGTH * (n))
+
 /// Default size of LMP endpoint buffer (in words), must be >= LMP_RECV_LENGTH
-#define DEFAULT_LMP_BUF_WORDS           (LMP_RECV_LENGTH * 2)
+#define DEFAULT_LMP_BUF_WORDS           LMP_BUF_WORDS(2)
 
 /// LMP endpoint structure (including data accessed only by user code)
 struct lmp_endpoint {
@@ -66,12 +69,23 @@ struct lmp_recv_msg {
 /// Static initialiser for lmp_recv_msg
 #define LMP_RECV_MSG_INIT { .buf.buflen = LMP_MSG_LENGTH };
 
+/// Version of #lmp_recv_msg large enough for extended messages
+struct lmp_recv_long_msg {
+    struct lmp_recv_buf buf;
+    uintptr_t words[LMP_LONG_MSG_LENGTH]; ///< Payload (up to maximum length)
+};
+
+/// Static initialiser for lmp_recv_long_msg
+#define LMP_RECV_LONG_MSG_INIT { .buf.buflen = LMP_LONG_MSG_LENGTH };
+
 errval_t lmp_endpoint_alloc(size_t buflen, struct lmp_endpoint **retep);
 void lmp_endpoint_free(struct lmp_endpoint *ep);
 errval_t lmp_endpoint_create_in_slot(size_t buflen, struct capref dest,
                                      struct lmp_endpoint **retep);
 void lmp_endpoint_set_recv_slot(struct lmp_endpoint *ep, struct capref slot);
 bool lmp_endpoint_can_recv(struct lmp_endpoint *ep);
+bool lmp_endpoint_space_drained(struct lmp_endpoint *ep);
+void lmp_endpoint_want_space_again(struct lmp_endpoint *ep);
 void lmp_endpoints_poll_disabled(dispatcher_handle_t handle);
 errval_t lmp_endpoint_recv(struct lmp_endpoint *ep, struct lmp_recv_buf *buf,
                            struct capref *cap);
@@ -17,6 +17,7 @@
 #define PAGING_TYPES_H_ 1
 
 #include <aos/solution.h>
+#include <aos/thread_sync.h>
 
 #define VADDR_OFFSET ((lvaddr_t)512UL*1024*1024*1024) // 1GB
 #define VREGION_FLAGS_READ       0x01 // Reading allowed
@@ -71,6 +72,9 @@ struct paging_state {
     char slab_buf[SLAB_STATIC_SIZE(NUM_PTS_ALLOC, sizeof(struct pageTable))];
     
     struct pageTable *root;
+
+    /// held while the tables are changed, threads of the domain map and unmap concurrently
+    struct thread_mutex mutex;
 };
 
 
@@ -43,6 +43,9 @@ struct thread *thread_self_disabled(void);
 errval_t thread_join(struct thread *thread, int *retval);
 errval_t thread_detach(struct thread *thread);
 
+void thread_stack_pool_set_cap(size_t cap);
+errval_t thread_stack_pool_prewarm(size_t stacksize, size_t count);
+
 void thread_pause(struct thread *thread);
 void thread_pause_and_capture_state(struct thread *thread,
                                     arch_registers_state_t **ret_regs);
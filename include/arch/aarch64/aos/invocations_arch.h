@@ -122,22 +122,35 @@ static inline struct sysret cap_invoke(struct capref to, uintptr_t argc, uintptr
  */
 STATIC_ASSERT(ObjType_Num < 0xFFFF, "retype invocation argument packing does not truncate enum "
                                     "objtype");
-static inline errval_t invoke_cnode_retype(struct capref root, capaddr_t src_cspace, capaddr_t cap,
-                                           gensize_t offset, enum objtype newtype,
-                                           gensize_t objsize, size_t count, capaddr_t to_cspace,
-                                           capaddr_t to, enum cnode_type to_level, capaddr_t slot)
+static inline errval_t invoke_cnode_retype_flags(struct capref root, capaddr_t src_cspace,
+                                                 capaddr_t cap, gensize_t offset,
+                                                 enum objtype newtype, gensize_t objsize,
+                                                 size_t count, capaddr_t to_cspace, capaddr_t to,
+                                                 enum cnode_type to_level, capaddr_t slot,
+                                                 uint32_t flags)
 {
     assert(cap != CPTR_NULL);
 
     assert(newtype < ObjType_Num);
     assert(count <= 0xFFFFFFFF);
     assert(to_level <= 0xF);
+    assert((flags & 0xFFFFF) == 0);
 
     return cap_invoke10(root, CNodeCmd_Retype, src_cspace, cap, offset,
-                        ((uint32_t)to_level << 16) | newtype, objsize, count, to_cspace, to, slot)
+                        flags | ((uint32_t)to_level << 16) | newtype, objsize, count, to_cspace,
+                        to, slot)
         .error;
 }
 
+static inline errval_t invoke_cnode_retype(struct capref root, capaddr_t src_cspace, capaddr_t cap,
+                                           gensize_t offset, enum objtype newtype,
+                                           gensize_t objsize, size_t count, capaddr_t to_cspace,
+                                           capaddr_t to, enum cnode_type to_level, capaddr_t slot)
+{
+    return invoke_cnode_retype_flags(root, src_cspace, cap, offset, newtype, objsize, count,
+                                     to_cspace, to, to_level, slot, 0);
+}
+
 
 static inline errval_t invoke_vnode_map(struct capref ptable, capaddr_t slot, capaddr_t src_root,
                                         capaddr_t src, enum cnode_type srclevel, size_t flags,
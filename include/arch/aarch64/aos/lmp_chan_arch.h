@@ -17,6 +17,7 @@
 
 #include <aos/syscall_arch.h>
 #include <aos/caddr.h>
+#include <aos/curdispatcher_arch.h>
 #include <barrelfish_kpi/lmp.h>
 #include <barrelfish_kpi/syscalls.h>
 
@@ -64,6 +65,33 @@ static inline errval_t lmp_ep_send(struct capref ep, lmp_send_flags_t flags, str
     return syscall(si.raw, arg1, arg2, arg3, arg4, arg5, arg6, arg7, arg8, send_cap_info, 0, 0).error;
 }
 
+/**
+ * \brief Send an extended message on the given LMP channel, if possible
+ *
+ * Like lmp_ep_send(), but the kernel copies the payload from a buffer instead of
+ * registers. The buffer must lie in the current dispatcher's frame, see
+ * lmp_chan_long_buf().
+ *
+ * \param ep Remote endpoint cap
+ * \param flags LMP send flags
+ * \param send_cap (Optional) capability to send with the message
+ * \param buf Message payload
+ * \param length_words Length of the message in words, at most LMP_LONG_MSG_LENGTH
+ */
+static inline errval_t lmp_ep_send_long(struct capref ep, lmp_send_flags_t flags,
+                                        struct capref send_cap, const uintptr_t *buf,
+                                        size_t length_words)
+{
+    uintptr_t offset = (uintptr_t)buf - (uintptr_t)curdispatcher();
+
+    if (length_words > LMP_LONG_MSG_LENGTH) {
+        return SYS_ERR_ILLEGAL_INVOCATION;
+    }
+
+    return lmp_ep_send(ep, flags | LMP_FLAG_LONG, send_cap, 0, offset, length_words, 0, 0, 0,
+                       0, 0, 0);
+}
+
 #define lmp_ep_send8(ep, flags, send_cap, a, b, c, d, e, f, g, h)                                  \
     lmp_ep_send((ep), (flags), (send_cap), 8, (a), (b), (c), (d), (e), (f), (g), (h))
 #define lmp_ep_send7(ep, flags, send_cap, a, b, c, d, e, f, g)                                     \
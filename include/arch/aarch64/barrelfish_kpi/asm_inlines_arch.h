@@ -26,6 +26,14 @@ static inline uint64_t rdtsc(void)
     return ccnt;
 }
 
+/// cycles of this core, readable from EL0 as the kernel enables the cycle counter
+static inline uint64_t rdccnt(void)
+{
+    uint64_t ccnt;
+    __asm__ volatile("mrs %[ccnt], PMCCNTR_EL0;" : [ccnt] "=r" (ccnt));
+    return ccnt;
+}
+
 static inline uint64_t rdtscp(void)
 {
     uint64_t ccnt;
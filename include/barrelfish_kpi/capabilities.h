@@ -50,6 +50,11 @@ __BEGIN_DECLS
 #define CAPRIGHTS_NORIGHTS   0
 
 typedef uint8_t CapRights;
+
+/// Retype flag: the source memory is known to be zero, skip clearing the new objects.
+/// Only honoured for Frame to Frame retypes, where the caller could already read the memory,
+/// and for RAM to Frame retypes through the monitor's kernel capability.
+#define RETYPE_FLAG_NOZERO (1 << 20)
 #define PRIuCAPRIGHTS PRIu8
 #define PRIxCAPRIGHTS PRIx8
 
@@ -542,8 +547,12 @@ enum id_cmd {
 enum ipi_cmd {
     IPICmd_Send_Start,  ///< Send Startup IPI to a destination core
     IPICmd_Send_Init,   ///< Send Init IPI to a destination core
+    IPICmd_Send_Notify, ///< Send a notification IPI to a destination core
 };
 
+/// SGI raised on the destination core by IPICmd_Send_Notify
+#define IPI_NOTIFY_SGI 1
+
 /**
  * Maximum command ordinal.
  */
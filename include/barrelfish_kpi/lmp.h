@@ -21,6 +21,9 @@
 
 #define LMP_RECV_HEADER_LENGTH  1 /* word */
 
+/// Maximum payload of an extended message sent with #LMP_FLAG_LONG (1 KiB)
+#define LMP_LONG_MSG_LENGTH     128 /* words */
+
 #ifndef __ASSEMBLER__
 
 /// Incoming LMP endpoint message buffer
@@ -29,6 +32,7 @@ struct lmp_endpoint_kern {
     capaddr_t     recv_cptr;  ///< CSpace address of slot to receive caps
     uint32_t    delivered;  ///< Position in buffer (words delivered by kernel)
     uint32_t    consumed;   ///< Position in buffer (words consumed by user)
+    uint32_t    space_wanted; ///< Words a notifying sender failed to deliver, 0 if none
     uintptr_t   buf[];      ///< Buffer for async LMP messages
 };
 
@@ -38,6 +42,8 @@ typedef enum lmp_send_flag {
     LMP_FLAG_YIELD      = 1 << 1,
     LMP_FLAG_GIVEAWAY   = 1 << 2,
     LMP_FLAG_IDENTIFY   = 1 << 3,
+    LMP_FLAG_NOTIFY     = 1 << 4, ///< Ask for a wakeup once a full buffer has drained
+    LMP_FLAG_LONG       = 1 << 5, ///< Payload is in a buffer in the dispatcher frame
 } lmp_send_flags_t;
 
 
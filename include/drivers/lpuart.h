@@ -47,6 +47,11 @@ errval_t lpuart_enable_interrupt(struct lpuart_s * s);
  */
 errval_t lpuart_putchar(struct lpuart_s* s, char c);
 
+/*
+ * write. Blocks until all len characters of buf have been handed to the device
+ */
+errval_t lpuart_write(struct lpuart_s* s, const char *buf, size_t len);
+
 /*
  * getchar. Non blocking. If no data is available
  * returns LPUART_ERR_NO_DATA. If the device has lost data
@@ -29,6 +29,7 @@ errval_t pl011_init(struct pl011_s** s, void *base);
 errval_t pl011_enable_interrupt(struct pl011_s * s);
 errval_t pl011_putchar(struct pl011_s* s, char c);
 errval_t pl011_getchar(struct pl011_s* s, char *c);
+errval_t pl011_write(struct pl011_s* s, const char *buf, size_t len);
 
 
 #endif
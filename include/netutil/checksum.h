@@ -34,11 +34,57 @@
  */
 
 
+#include <stddef.h>
 #include <stdint.h>
 
+/*
+ * Checksum values are in network byte order as stored in the packet, i.e.
+ * they can be written to or compared with a header field directly.
+ */
+
 /**
  * Calculate the internet checksum according to RFC1071
  */
 uint16_t inet_checksum(void *dataptr, uint16_t len);
 
+/**
+ * Add len bytes at data to a running ones' complement sum.
+ *
+ * Start with sum = 0 and pass the result of the previous call to continue a
+ * checksum over several buffers; all but the last buffer must have an even
+ * length. Finish with inet_checksum_fold().
+ */
+uint32_t inet_checksum_partial(const void *data, size_t len, uint32_t sum);
+
+/**
+ * Turn a running sum from inet_checksum_partial() into a checksum field
+ */
+uint16_t inet_checksum_fold(uint32_t sum);
+
+/**
+ * Copy len bytes from src to dst and return the running sum over them, as
+ * inet_checksum_partial() would, reading the source only once.
+ */
+uint32_t inet_checksum_copy_partial(void *dst, const void *src, size_t len,
+                                    uint32_t sum);
+
+/**
+ * Copy len bytes from src to dst and return their internet checksum
+ */
+uint16_t inet_checksum_copy(void *dst, const void *src, uint16_t len);
+
+/**
+ * Incrementally update a checksum field after a 16-bit header word changed
+ * from old_word to new_word (RFC 1624). All values in network byte order.
+ */
+uint16_t inet_checksum_update16(uint16_t check, uint16_t old_word,
+                                uint16_t new_word);
+
+/**
+ * Incrementally update a checksum field after a 32-bit header field (e.g. an
+ * IPv4 address) changed from old_word to new_word. Network byte order.
+ */
+uint16_t inet_checksum_update32(uint16_t check, uint32_t old_word,
+                                uint32_t new_word);
+
 #endif
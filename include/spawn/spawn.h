@@ -27,8 +27,6 @@ struct elfimg;
 struct bootinfo;
 struct waitset;
 
-extern struct spawninfo* root;
-
 /**
  * @brief represents the state of the process
  */
@@ -77,8 +75,9 @@ struct spawninfo {
     //           e.g. references to the child's
     //           capabilities or paging state
 
-    // the next spawninfo struct
-    struct spawninfo *next;
+    // the next spawninfo structs in init's process table buckets, by PID and by name
+    struct spawninfo *pid_next;
+    struct spawninfo *name_next;
 
     // Child's paging state
     struct paging_state *st;
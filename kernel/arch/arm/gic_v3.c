@@ -16,6 +16,7 @@
 #include <paging_kernel_arch.h>
 #include <arch/arm/gic.h>
 #include <irq.h>
+#include <barrelfish_kpi/capabilities.h>
 #include <getopt/getopt.h>
 
 static gic_v3_dist_t gic_v3_dist_dev;
@@ -150,6 +151,9 @@ void gic_cpu_interface_enable(void)
     //Disable PPIs
     gic_v3_redist_GICR_ICENABLER0_wr(&gic_v3_redist_dev, MASK_32);
 
+    // other cores wake up sleeping receivers with this one
+    gic_v3_redist_GICR_ISENABLER0_wr(&gic_v3_redist_dev, 1 << IPI_NOTIFY_SGI);
+
     gic_v3_redist_GICR_IGROUPR0_rawwr(&gic_v3_redist_dev, MASK_32);
     gic_v3_redist_GICR_IGRPMODR0_rawwr(&gic_v3_redist_dev, 0);
 
@@ -144,6 +144,15 @@ errval_t irq_table_notify_domains(struct kcb *kcb)
     return SYS_ERR_OK;
 }
 
+/**
+ * \brief Returns whether a user-space listener has registered for an IRQ.
+ */
+bool user_interrupt_registered(int irq)
+{
+    assert(irq >= 0 && irq < NDISPATCH);
+    return irq_dispatch[irq].cap.type != ObjType_Null;
+}
+
 /**
  * \brief Send interrupt notification to user-space listener.
  *
@@ -19,6 +19,7 @@
 #include <stdio.h>
 #include <wakeup.h>
 #include <irq.h>
+#include <barrelfish_kpi/capabilities.h>
 #include <arch/arm/arm.h>
 #include <arch/arm/gic.h>
 #include <arch/arm/platform.h>
@@ -222,6 +223,11 @@ void nosave_handle_irq(void)
 #endif
         wakeup_check(systime_now());
         dispatch(schedule());
+    } else if (irq == IPI_NOTIFY_SGI && !user_interrupt_registered(irq)) {
+        // another core posted a message before init registered for notifications, the
+        // receiver's park timer picks it up
+        platform_acknowledge_irq(irq);
+        dispatch(schedule());
     } else {
         platform_acknowledge_irq(irq);
         send_user_interrupt(irq);
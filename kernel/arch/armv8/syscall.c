@@ -202,10 +202,12 @@ handle_retype_common(
     capaddr_t dest_slot        = sa->x9;
     // Level of destination cnode in destination cspace
     uint8_t dest_cnode_level   = (word >> 16) & 0xF;
+    // Caller asserts the source memory is already zeroed
+    bool skip_zero             = (word & RETYPE_FLAG_NOZERO) != 0;
 
     return sys_retype(root, source_croot, source_cptr, offset, type,
                       objsize, count, dest_cspace_cptr, dest_cnode_cptr,
-                      dest_cnode_level, dest_slot, from_monitor);
+                      dest_cnode_level, dest_slot, from_monitor, skip_zero);
 }
 
 static struct sysret
@@ -790,6 +792,26 @@ monitor_spawn_core(
     return sys_monitor_spawn_core(core_id, cpu_type, entry, context_id);
 }
 
+static struct sysret
+monitor_send_notify(
+    struct capability *kernel_cap,
+    arch_registers_state_t* context,
+    int argc)
+{
+    (void)argc;
+    (void)kernel_cap;
+
+    struct registers_aarch64_syscall_args* sa = &context->syscall_args;
+
+    coreid_t core_id = sa->arg1;
+    if (core_id >= platform_get_core_count()) {
+        return SYSRET(SYS_ERR_CORE_NOT_FOUND);
+    }
+
+    gic_raise_softirq(core_id, IPI_NOTIFY_SGI);
+    return SYSRET(SYS_ERR_OK);
+}
+
 static struct sysret
 monitor_identify_cap(
     struct capability *kernel_cap,
@@ -1119,6 +1141,7 @@ static invocation_t invocations[ObjType_Num][CAP_MAX_CMD] = {
     },
     [ObjType_IPI] = {
         [IPICmd_Send_Start]  = monitor_spawn_core,
+        [IPICmd_Send_Notify] = monitor_send_notify,
     },
     [ObjType_ID] = {
         [IDCmd_Identify] = handle_idcap_identify
@@ -1166,7 +1189,8 @@ handle_invoke(union syscall_info si, uint64_t a1, uint64_t a2, uint64_t a3,
         assert(listener != NULL);
 
         if (listener->disp) {
-            uint8_t length_words = si.invoke.msg_words;
+            size_t length_words = si.invoke.msg_words;
+            uintptr_t *payload = &context->regs[1];
 
             uint8_t send_bits    = (sa->x9 >> 32) & 0xf;
             capaddr_t send_cptr  = sa->x9 & 0xffffffff;
@@ -1180,6 +1204,8 @@ handle_invoke(union syscall_info si, uint64_t a1, uint64_t a2, uint64_t a3,
             bool yield = flags & LMP_FLAG_YIELD;
             // is the cap (if present) to be deleted on send?
             bool give_away = flags & LMP_FLAG_GIVEAWAY;
+            // is the payload in a buffer rather than in registers?
+            bool long_msg = flags & LMP_FLAG_LONG;
 
             // save the registers in the context
             // XXX: we should pass them to lmp_deliver() directly
@@ -1191,9 +1217,23 @@ handle_invoke(union syscall_info si, uint64_t a1, uint64_t a2, uint64_t a3,
             sa->arg5 = a5;
             sa->arg6 = a6;
 
+            // the first two words then give its offset in the dispatcher frame and length
+            if (long_msg) {
+                length_words = a2;
+                r.error = lmp_long_payload(to, dcb_current, a1, length_words, &payload);
+            }
+
             // try to deliver message
-            r.error = lmp_deliver(to, dcb_current, &context->regs[1],
-                                    length_words, send_cptr, send_bits, give_away);
+            if (err_is_ok(r.error)) {
+                r.error = lmp_deliver(to, dcb_current, payload, length_words, send_cptr,
+                                      send_bits, give_away);
+            }
+
+            // does the sender want a wakeup once the buffer drained?
+            if ((flags & LMP_FLAG_NOTIFY)
+                && err_no(r.error) == SYS_ERR_LMP_BUF_OVERFLOW) {
+                lmp_want_space(to, length_words);
+            }
 
             /* Switch to reciever upon successful delivery
                 * with sync flag, or (some cases of)
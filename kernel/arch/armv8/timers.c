@@ -69,18 +69,14 @@ void platform_timer_init(int timeslice)
     err = platform_enable_interrupt(platform_get_timer_interrupt(), 0, 0, 0);
     assert(err_is_ok(err));
 
-// AT: disable for now because it's not supported by QEMU version<2.6.0
-// AT: doesn't seem to break anything
-//    armv8_PMUSERENR_EL0_t pmu = 0;
-    /* don't trap access to PM registers to EL 1 */
-//    pmu = armv8_PMUSERENR_EL0_EN_insert(pmu, 1);
-    /* don't trap software increment wrap to EL 1 */
-//    pmu = armv8_PMUSERENR_EL0_SW_insert(pmu, 1);
-    /* don't trap cycle counter to EL 1 */
-//    pmu = armv8_PMUSERENR_EL0_CR_insert(pmu, 1);
-    /* don't trap event counter read to EL 1*/
-//    pmu = armv8_PMUSERENR_EL0_ER_insert(pmu, 1);
-//    armv8_PMUSERENR_EL0_wr(NULL, pmu);
+    /* start the cycle counter. It counts at EL0 and EL1 and is not switched with the
+     * dispatcher, benchmarks read it for times in cycles of this core */
+    armv8_PMCNTENSET_EL0_C_wrf(NULL, 1);
+
+    /* don't trap reads of the cycle counter from EL0 to EL1, nothing else of the PMU */
+    armv8_PMUSERENR_EL0_t pmu = 0;
+    pmu = armv8_PMUSERENR_EL0_CR_insert(pmu, 1);
+    armv8_PMUSERENR_EL0_wr(NULL, pmu);
 }
 
 systime_t systime_now(void)
@@ -631,6 +631,7 @@ static errval_t caps_zero_objects(enum objtype type, lpaddr_t lpaddr,
  * \param count         Number of objects to be created
  *                      (count <= caps_max_numobjs(type, size, objsize))
  * \param dest_caps     Pointer to array of CTEs to hold created caps.
+ * \param zero          Whether the new local objects have to be cleared.
  *
  * \return Error code
  */
@@ -640,7 +641,7 @@ STATIC_ASSERT(68 == ObjType_Num, "Knowledge of all cap types");
 
 static errval_t caps_create(enum objtype type, lpaddr_t lpaddr, gensize_t size,
                             gensize_t objsize, size_t count, coreid_t owner,
-                            struct cte *dest_caps)
+                            struct cte *dest_caps, bool zero)
 {
     errval_t err;
 
@@ -680,7 +681,7 @@ static errval_t caps_create(enum objtype type, lpaddr_t lpaddr, gensize_t size,
     temp_cap.rights = CAPRIGHTS_ALLRIGHTS;
 
     debug(SUBSYS_CAPS, "owner = %d, my_core_id = %d\n", owner, my_core_id);
-    if (owner == my_core_id) {
+    if (owner == my_core_id && zero) {
         // If we're creating new local objects, they need to be cleared
         err = caps_zero_objects(type, lpaddr, objsize, count);
         if (err_is_fail(err)) {
@@ -1577,7 +1578,7 @@ errval_t caps_create_new(enum objtype type, lpaddr_t addr, size_t bytes,
     //}
 
     /* Create the new capabilities */
-    errval_t err = caps_create(type, addr, bytes, objsize, numobjs, owner, caps);
+    errval_t err = caps_create(type, addr, bytes, objsize, numobjs, owner, caps, true);
     if (err_is_fail(err)) {
         return err;
     }
@@ -1594,11 +1595,13 @@ errval_t caps_create_new(enum objtype type, lpaddr_t addr, size_t bytes,
 STATIC_ASSERT(68 == ObjType_Num, "Knowledge of all cap types");
 /// Retype caps
 /// Create `count` new caps of `type` from `offset` in src, and put them in
-/// `dest_cnode` starting at `dest_slot`.
+/// `dest_cnode` starting at `dest_slot`. If `skip_zero` is set and both src
+/// and the new caps are Frames, the (already accessible) memory is not cleared.
+/// The monitor may skip clearing Frames retyped from RAM as well.
 errval_t caps_retype(enum objtype type, gensize_t objsize, size_t count,
                      struct capability *dest_cnode, cslot_t dest_slot,
                      struct cte *src_cte, gensize_t offset,
-                     bool from_monitor)
+                     bool from_monitor, bool skip_zero)
 {
     TRACE(KERNEL, CAP_RETYPE, 0);
     TRACE(KERNEL_CAPOPS, RETYPE_ENTER, ++retype_seqnum);
@@ -1866,13 +1869,19 @@ errval_t caps_retype(enum objtype type, gensize_t objsize, size_t count,
         caps_locate_slot(get_address(dest_cnode), dest_slot);
     if(type == ObjType_IRQSrc){
         // Pass special arguments
-        err = caps_create(type, 0, 0, 0, 1, my_core_id, dest_cte);
+        err = caps_create(type, 0, 0, 0, 1, my_core_id, dest_cte, true);
         if(err_is_ok(err)){
             dest_cte->cap.u.irqsrc.vec_start = vec_start_new;
             dest_cte->cap.u.irqsrc.vec_end = vec_end_new;
         }
     } else {
-        err = caps_create(type, base, size, objsize, count, my_core_id, dest_cte);
+        // a caller that may read the source frame could already access its contents, and
+        // the monitor hands out all memory in the first place, so trusting either of them
+        // about the memory being zero does not leak anything
+        bool zero = !(skip_zero && type == ObjType_Frame
+                      && ((src_cap->type == ObjType_Frame && (src_cap->rights & CAPRIGHTS_READ))
+                          || (src_cap->type == ObjType_RAM && from_monitor)));
+        err = caps_create(type, base, size, objsize, count, my_core_id, dest_cte, zero);
     }
     if (err_is_fail(err)) {
         debug(SUBSYS_CAPS, "caps_retype: failed to create a dest cap\n");
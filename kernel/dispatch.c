@@ -22,6 +22,7 @@
 #include <systime.h>
 #include <barrelfish_kpi/syscalls.h>
 #include <barrelfish_kpi/lmp.h>
+#include <barrelfish_kpi/init.h>
 #include <trace/trace.h>
 #include <trace_definitions/trace_defs.h>
 #include <barrelfish_kpi/dispatcher_shared_target.h>
@@ -270,6 +271,71 @@ errval_t lmp_can_deliver_payload(struct capability *ep,
     return SYS_ERR_OK;
 }
 
+/**
+ * \brief Ask for a notification once an LMP endpoint has room for a payload
+ *
+ * Called after a send failed with SYS_ERR_LMP_BUF_OVERFLOW. Consumption is only
+ * visible to the receiver, so this just marks the endpoint; the receiver's library
+ * sends an empty message back over its channel when it drains past the mark.
+ *
+ * \param ep     Endpoint capability the send failed on
+ * \param payload_len Length (in number of words) of the undelivered payload
+ */
+void lmp_want_space(struct capability *ep, size_t payload_len)
+{
+    assert(ep != NULL);
+    assert(ep->type == ObjType_EndPointLMP);
+    struct dcb *recv = ep->u.endpointlmp.listener;
+    assert(recv != NULL);
+
+    if (recv->disp == 0 || ep->u.endpointlmp.epoffset == 0) {
+        return;
+    }
+
+    struct lmp_endpoint_kern *recv_ep
+        = (void *)((uint8_t *)recv->disp + ep->u.endpointlmp.epoffset);
+
+    /* several senders may be waiting, remember the largest of them */
+    uint32_t wanted = payload_len + LMP_RECV_HEADER_LENGTH;
+    if (recv_ep->space_wanted < wanted) {
+        recv_ep->space_wanted = wanted;
+    }
+}
+
+/**
+ * \brief Locate the payload of an extended LMP message in the sender's dispatcher frame
+ *
+ * The kernel keeps every dispatcher frame mapped, so the payload is copied straight
+ * from there into the receiver's endpoint without touching the sender's address space.
+ *
+ * \param ep      Endpoint capability to send to
+ * \param send    DCB of the sender
+ * \param offset  Offset of the payload in the sender's dispatcher frame
+ * \param len     Length (in number of words) of payload
+ * \param payload Filled in with the location of the payload
+ */
+errval_t lmp_long_payload(struct capability *ep, struct dcb *send, lvaddr_t offset,
+                          size_t len, uintptr_t **payload)
+{
+    assert(ep != NULL);
+    assert(ep->type == ObjType_EndPointLMP);
+    assert(send != NULL && payload != NULL);
+
+    if (len > LMP_LONG_MSG_LENGTH || offset % sizeof(uintptr_t) != 0
+        || offset > DISPATCHER_FRAME_SIZE
+        || len * sizeof(uintptr_t) > DISPATCHER_FRAME_SIZE - offset) {
+        return SYS_ERR_INVALID_USER_BUFFER;
+    }
+
+    /* one that never fits would leave its sender waiting for space forever */
+    if (len + LMP_RECV_HEADER_LENGTH >= ep->u.endpointlmp.epbuflen) {
+        return SYS_ERR_LMP_MSG_TOO_LONG;
+    }
+
+    *payload = (uintptr_t *)(send->disp + offset);
+    return SYS_ERR_OK;
+}
+
 /**
  * \brief Deliver the payload of an LMP message to a dispatcher.
  *
@@ -28,5 +28,6 @@ errval_t irq_table_alloc_dest_cap(uint8_t dcn_vbits, capaddr_t dcn,
 struct kcb;
 errval_t irq_table_notify_domains(struct kcb *kcb);
 void send_user_interrupt(int irq);
+bool user_interrupt_registered(int irq);
 
 #endif // KERNEL_ARCH_ARM_IRQ_H
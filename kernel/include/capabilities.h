@@ -150,7 +150,7 @@ void paging_dump_tables(struct dcb *dispatcher, lvaddr_t va);
 errval_t caps_retype(enum objtype type, gensize_t objsize, size_t count,
                      struct capability *dest_cnode, cslot_t dest_slot,
                      struct cte *src_cte, gensize_t offset,
-                     bool from_monitor);
+                     bool from_monitor, bool skip_zero);
 errval_t is_retypeable(struct cte *src_cte,
                        enum objtype src_type,
                        enum objtype dest_type,
@@ -77,6 +77,9 @@ extern struct dcb *dcb_current;
 void dispatch(struct dcb *dcb) __attribute__ ((noreturn));
 errval_t lmp_can_deliver_payload(struct capability *ep,
                                  size_t payload_len);
+void lmp_want_space(struct capability *ep, size_t payload_len);
+errval_t lmp_long_payload(struct capability *ep, struct dcb *send, lvaddr_t offset,
+                          size_t len, uintptr_t **payload);
 errval_t lmp_deliver_payload(struct capability *ep, struct dcb *send,
                              uintptr_t *payload, size_t payload_len,
                              bool captransfer, bool now);
@@ -0,0 +1,54 @@
+/**
+ * \file
+ * \brief Kernel memory fill/copy primitives.
+ *
+ * memset() and memmove() pick an architecture-optimised path where one is
+ * available. The portable word-at-a-time loops they fall back to are
+ * exported here so that the microbenchmarks can compare both.
+ */
+
+/*
+ * Copyright (c) 2023, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#ifndef __KERNEL_MEMOPS_H
+#define __KERNEL_MEMOPS_H
+
+#include <stddef.h>
+
+/// Portable word-at-a-time memset(), used for small or non-cacheable fills
+void *memset_generic(void *s, int c, size_t n);
+
+/// Portable word-at-a-time memmove(), used for small or close-overlap copies
+void *memmove_generic(void *s1, const void *s2, size_t n);
+
+#if defined(__aarch64__)
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * \brief Check whether the fast paths may be used.
+ *
+ * The optimised routines issue unaligned accesses and DC ZVA, both of which
+ * fault on Device memory. That is what every access is while the MMU or the
+ * data cache is off (e.g. in the boot driver), so only take the fast paths
+ * when running at EL1 with SCTLR_EL1.{M,C} set.
+ */
+static inline bool memops_cacheable(void)
+{
+    uint64_t el, sctlr;
+    __asm volatile("mrs %[el], CurrentEL" : [el] "=r" (el));
+    if (((el >> 2) & 0x3) != 1) {
+        return false;
+    }
+    __asm volatile("mrs %[sctlr], sctlr_el1" : [sctlr] "=r" (sctlr));
+    return (sctlr & 0x5) == 0x5;
+}
+#endif
+
+#endif // __KERNEL_MEMOPS_H
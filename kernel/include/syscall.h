@@ -36,7 +36,8 @@ struct sysret
 sys_retype(struct capability *root, capaddr_t source_croot, capaddr_t source_cptr,
            gensize_t offset, enum objtype type, gensize_t objsize, size_t count,
            capaddr_t dest_cspace_ptr, capaddr_t dest_cnode_cptr,
-           uint8_t dest_level, cslot_t dest_slot,  bool from_monitor);
+           uint8_t dest_level, cslot_t dest_slot,  bool from_monitor,
+           bool skip_zero);
 struct sysret sys_create(struct capability *root, enum objtype type,
                          size_t objsize, capaddr_t dest_cnode_cptr,
                          uint8_t dest_level, cslot_t dest_slot);
@@ -21,6 +21,8 @@
 #include <stdio.h>
 #include <string.h>
 #include <microbenchmarks.h>
+#include <memops.h>
+#include <systime.h>
 #include <misc.h>
 
 static uint64_t divide_round(uint64_t quotient, uint64_t divisor)
@@ -78,11 +80,112 @@ static int microbenchmarks_print_all(struct microbench *benchs, size_t nbenchs)
     return 0;
 }
 
+/*
+ * Memory fill/copy benchmarks: the optimised memset()/memmove() against the
+ * portable loops they replaced, on the sizes the kernel actually uses
+ * (page-sized zeroing in caps_zero_objects(), small struct copies).
+ */
+
+#define MEMBENCH_BYTES  (4 * 1024)
+
+static uint8_t membench_buf[2][MEMBENCH_BYTES + 64] __attribute__((aligned(64)));
+
+typedef void *(*membench_fill_fn)(void *, int, size_t);
+typedef void *(*membench_copy_fn)(void *, const void *, size_t);
+
+/// what the fill benchmarks find in the buffer, so a fill that does nothing is caught
+#define MEMBENCH_PATTERN 0xa5
+
+static int membench_fill(struct microbench *mb, membench_fill_fn fn,
+                         size_t offset, size_t bytes, int value)
+{
+    for (size_t i = 0; i < sizeof(membench_buf[0]); i++) {
+        membench_buf[0][i] = MEMBENCH_PATTERN;
+    }
+
+    systime_t start = systime_now();
+    for (int i = 0; i < MICROBENCH_ITERATIONS; i++) {
+        fn(membench_buf[0] + offset, value, bytes);
+    }
+    mb->result = systime_now() - start;
+
+    // the filled range has the value, the bytes around it are untouched
+    for (size_t i = 0; i < sizeof(membench_buf[0]); i++) {
+        uint8_t expected = (i >= offset && i < offset + bytes) ? (uint8_t)value
+                                                               : MEMBENCH_PATTERN;
+        if (membench_buf[0][i] != expected) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int membench_copy(struct microbench *mb, membench_copy_fn fn,
+                         size_t offset, size_t bytes)
+{
+    for (size_t i = 0; i < bytes; i++) {
+        membench_buf[1][i] = (uint8_t)i;
+    }
+
+    systime_t start = systime_now();
+    for (int i = 0; i < MICROBENCH_ITERATIONS; i++) {
+        fn(membench_buf[0] + offset, membench_buf[1], bytes);
+    }
+    mb->result = systime_now() - start;
+
+    for (size_t i = 0; i < bytes; i++) {
+        if (membench_buf[0][offset + i] != (uint8_t)i) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+#define MEMBENCH_FILL(_name, _fn, _off, _bytes, _value) \
+    static int _name(struct microbench *mb) \
+    { return membench_fill(mb, _fn, _off, _bytes, _value); }
+
+#define MEMBENCH_COPY(_name, _fn, _off, _bytes) \
+    static int _name(struct microbench *mb) \
+    { return membench_copy(mb, _fn, _off, _bytes); }
+
+MEMBENCH_FILL(memset_page_generic, memset_generic, 0, MEMBENCH_BYTES, 0)
+MEMBENCH_FILL(memset_page, memset, 0, MEMBENCH_BYTES, 0)
+MEMBENCH_FILL(memset_page_value_generic, memset_generic, 0, MEMBENCH_BYTES, 0x5a)
+MEMBENCH_FILL(memset_page_value, memset, 0, MEMBENCH_BYTES, 0x5a)
+MEMBENCH_FILL(memset_small_generic, memset_generic, 3, 100, 0)
+MEMBENCH_FILL(memset_small, memset, 3, 100, 0)
+MEMBENCH_FILL(memset_small_value_generic, memset_generic, 3, 100, 0x5a)
+MEMBENCH_FILL(memset_small_value, memset, 3, 100, 0x5a)
+MEMBENCH_COPY(memmove_page_generic, memmove_generic, 0, MEMBENCH_BYTES)
+MEMBENCH_COPY(memmove_page, memmove, 0, MEMBENCH_BYTES)
+MEMBENCH_COPY(memmove_unaligned_generic, memmove_generic, 5, MEMBENCH_BYTES)
+MEMBENCH_COPY(memmove_unaligned, memmove, 5, MEMBENCH_BYTES)
+
+static struct microbench mem_benchmarks[] = {
+    { .name = "memset 4K zero (generic)",      .run_func = memset_page_generic },
+    { .name = "memset 4K zero",                .run_func = memset_page },
+    { .name = "memset 4K 0x5a (generic)",      .run_func = memset_page_value_generic },
+    { .name = "memset 4K 0x5a",                .run_func = memset_page_value },
+    { .name = "memset 100B unaligned (generic)", .run_func = memset_small_generic },
+    { .name = "memset 100B unaligned",         .run_func = memset_small },
+    { .name = "memset 100B 0x5a (generic)",    .run_func = memset_small_value_generic },
+    { .name = "memset 100B 0x5a",              .run_func = memset_small_value },
+    { .name = "memmove 4K (generic)",          .run_func = memmove_page_generic },
+    { .name = "memmove 4K",                    .run_func = memmove_page },
+    { .name = "memmove 4K unaligned (generic)", .run_func = memmove_unaligned_generic },
+    { .name = "memmove 4K unaligned",          .run_func = memmove_unaligned },
+};
+
 void microbenchmarks_run_all(void)
 {
+    size_t mem_benchmarks_size = sizeof(mem_benchmarks) / sizeof(mem_benchmarks[0]);
+
     microbenchmarks_run(arch_benchmarks, arch_benchmarks_size);
+    microbenchmarks_run(mem_benchmarks, mem_benchmarks_size);
 
     printf("\n------------------------ Statistics ------------------------\n");
     microbenchmarks_print_all(arch_benchmarks, arch_benchmarks_size);
+    microbenchmarks_print_all(mem_benchmarks, mem_benchmarks_size);
     printf("------------------------------------------------------------\n\n");
 }
@@ -121,17 +121,12 @@ memmove(void *dst, const void *src, size_t sz)
 void *
 memcpy(void *dst, const void *src, size_t len)
 {
-    char *d = dst;
-    const char *s = src;
-
     /* check that we don't overlap (should use memmove()) */
     assert((src < dst && (char *)src + len <= (char *)dst)
            || (dst < src && (char *)dst + len <= (char *)src));
 
-    while (len--)
-        *d++ = *s++;
-
-    return dst;
+    // memmove() has the optimised copy loop; without overlap it is equivalent
+    return memmove(dst, src, len);
 }
 
 char *
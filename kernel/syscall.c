@@ -231,12 +231,14 @@ sys_dispatcher_properties(struct capability *to,
  * \param dest_cnode_cptr       Destination cnode cptr
  * \param dest_slot             Destination slot number
  * \param dest_cnode_level      Level/depth of destination cnode
+ * \param skip_zero             Source memory is known to be zero (Frame only)
  */
 struct sysret
 sys_retype(struct capability *root, capaddr_t source_croot, capaddr_t source_cptr,
            gensize_t offset, enum objtype type, gensize_t objsize, size_t count,
            capaddr_t dest_cspace_cptr, capaddr_t dest_cnode_cptr,
-           uint8_t dest_cnode_level, cslot_t dest_slot, bool from_monitor)
+           uint8_t dest_cnode_level, cslot_t dest_slot, bool from_monitor,
+           bool skip_zero)
 {
     errval_t err;
 
@@ -290,7 +292,7 @@ sys_retype(struct capability *root, capaddr_t source_croot, capaddr_t source_cpt
     }
 
     return SYSRET(caps_retype(type, objsize, count, dest_cnode_cap, dest_slot,
-                              source_cte, offset, from_monitor));
+                              source_cte, offset, from_monitor, skip_zero));
 }
 
 struct sysret sys_create(struct capability *root, enum objtype type,
@@ -15,79 +15,840 @@
 #include <aos/aos.h>
 #include <aos/aos_rpc.h>
 #include <aos/deferred.h>
+#include <aos/waitset_chan.h>
+#include <aos/inthandler.h>
+#include <aos/kernel_cap_invocations.h>
 #include <grading/grading.h>
 #include <barrelfish_kpi/startup_arm.h>
 #include <barrelfish_kpi/asm_inlines_arch.h>
 
 #include <proc_mgmt/proc_mgmt.h>
 
-domainid_t global_pid;
-char global_retchar;
-struct capref global_retcap;
-size_t global_retbytes;
-
 struct aos_rpc *global_rpc;
 
 genvaddr_t global_urpc_frames[4];
+genvaddr_t global_ump_mesh_frames[UMP_MAX_CORES];
+
+/// bytes of inline payload that fit into the first message after header, argument and length
+#define AOS_RPC_INLINE_HEAD ((LMP_MSG_LENGTH - 3) * sizeof(uintptr_t))
+STATIC_ASSERT(3 + DIVIDE_ROUND_UP(AOS_RPC_INLINE_MAX, sizeof(uintptr_t)) <= LMP_LONG_MSG_LENGTH,
+              "inline payload does not fit into an extended message");
+
+/// flags of every RPC message: a full receiver gets our time slice to drain its buffer
+#define AOS_RPC_LMP_FLAGS (LMP_FLAG_YIELD | LMP_FLAG_NOTIFY)
+
+/// flags of the last message of a request or reply: the receiver runs on the rest of our
+/// time slice, as it is about to answer or waiting for the answer
+#define AOS_RPC_LMP_FLAGS_HANDOFF (AOS_RPC_LMP_FLAGS | LMP_FLAG_SYNC)
+
+/// how long a sender waits for the receiver's wakeup before it retries on its own
+#define AOS_RPC_LMP_RETRY_US 1000
+
+// marks the wait for room in the receiver's buffer as over
+static void aos_rpc_lmp_send_ready(void *arg)
+{
+    *(bool *)arg = true;
+}
+
+// send one message without waiting, an extended one is taken from the channel's long buffer
+static errval_t aos_rpc_lmp_try_send(struct lmp_chan *lc, lmp_send_flags_t flags,
+                                     struct capref cap, size_t nwords, const uintptr_t *w)
+{
+    if (nwords > LMP_MSG_LENGTH) {
+        uintptr_t *lw = lmp_chan_long_buf(lc);
+        if (lw == NULL) {
+            return LIB_ERR_MALLOC_FAIL;
+        }
+        if (lw != w) {
+            memcpy(lw, w, nwords * sizeof(uintptr_t));
+        }
+        return lmp_ep_send_long(lc->remote_cap, flags, cap, lw, nwords);
+    }
+    return lmp_ep_send(lc->remote_cap, flags, cap, nwords, w[0], w[1], w[2], w[3], w[4], w[5],
+                       w[6], w[7]);
+}
+
+// send one message, sleeping while the receiver's buffer is full
+static errval_t aos_rpc_lmp_send(struct lmp_chan *lc, lmp_send_flags_t flags, struct capref cap,
+                                 size_t nwords, const uintptr_t *w)
+{
+    struct deferred_event retry;
+    struct waitset ws;
+    bool ready;
+    errval_t err, err2;
+
+    waitset_init(&ws);
+    deferred_event_init(&retry);
+    do {
+        // register before sending, the receiver's wakeup may arrive before the send returns
+        ready = false;
+        err = lmp_chan_register_send(lc, &ws, MKCLOSURE(aos_rpc_lmp_send_ready, &ready));
+        if (err_is_fail(err)) {
+            break;
+        }
+
+        err = aos_rpc_lmp_try_send(lc, flags, cap, nwords, w);
+        if (err_no(err) != SYS_ERR_LMP_BUF_OVERFLOW) {
+            lmp_chan_deregister_send(lc);
+            if (lmp_err_is_transient(err)) {
+                // the receiver is not told when it has a new slot for a capability
+                thread_yield();
+            }
+            continue;
+        }
+
+        // the receiver sends an empty message once it drained enough, any message wakes us;
+        // that wakeup is not guaranteed to arrive, so retry after a while in any case
+        err2 = deferred_event_register(&retry, &ws, AOS_RPC_LMP_RETRY_US,
+                                       MKCLOSURE(aos_rpc_lmp_send_ready, &ready));
+        while (!ready && err_is_ok(err2)) {
+            err2 = event_dispatch(&ws);
+        }
+        lmp_chan_deregister_send(lc);
+        deferred_event_cancel(&retry);
+        if (err_is_fail(err2)) {
+            err = err2;
+        }
+    } while (lmp_err_is_transient(err));
+    waitset_destroy(&ws);
+
+    if (err_is_fail(err)) {
+        return err_push(err, LIB_ERR_LMP_CHAN_SEND);
+    }
+    return SYS_ERR_OK;
+}
+
+static void aos_rpc_txq_retry(void *arg);
+
+// send queued replies in order until the client's buffer is full again, send_mutex held
+static void aos_rpc_txq_flush(struct aos_rpc *rpc)
+{
+    struct aos_rpc_txq_msg *m;
+    errval_t err;
+
+    while ((m = rpc->txq_head) != NULL) {
+        err = aos_rpc_lmp_try_send(rpc->lmp_chan, m->flags, m->cap, m->nwords, m->words);
+        if (lmp_err_is_transient(err)) {
+            // retried on every run of the dispatcher, like any other LMP send event
+            err = lmp_chan_register_send(rpc->lmp_chan, get_default_waitset(),
+                                         MKCLOSURE(aos_rpc_txq_retry, rpc));
+            if (err_is_fail(err)) {
+                DEBUG_ERR(err, "can't retry the replies to %u", rpc->pid);
+            }
+            return;
+        }
+        if (err_is_fail(err)) {
+            DEBUG_ERR(err, "dropping a reply to %u", rpc->pid);
+        }
+
+        rpc->txq_head = m->next;
+        if (!capref_is_null(m->cap)) {
+            cap_destroy(m->cap);
+        }
+        free(m);
+    }
+    rpc->txq_tail = NULL;
+}
 
-void setup_send_handler(void *arg)
+static void aos_rpc_txq_retry(void *arg)
 {
-    // debug_printf("sending setup message\n");
     struct aos_rpc *rpc = arg;
+
+    thread_mutex_lock(&rpc->send_mutex);
+    aos_rpc_txq_flush(rpc);
+    thread_mutex_unlock(&rpc->send_mutex);
+}
+
+// send a reply without waiting for the client, send_mutex held: if its buffer is full the
+// reply is queued behind the ones before it and sent from the default waitset
+static errval_t aos_rpc_reply_send(struct aos_rpc *rpc, lmp_send_flags_t flags,
+                                   struct capref cap, size_t nwords, const uintptr_t *w)
+{
+    struct aos_rpc_txq_msg *m;
     errval_t err;
 
-    err = lmp_chan_register_recv(rpc->lmp_chan, get_default_waitset(), MKCLOSURE(ack_recv_handler, arg));
-    // debug_printf("sending msg (not ack)\n");
-    err = lmp_chan_send1(rpc->lmp_chan, 0, rpc->lmp_chan->local_cap, SETUP_MSG);
-    if (err_is_fail(err)) {
-        DEBUG_ERR(err, "sending setup message");
-        abort();
+    if (rpc->txq_head == NULL) {
+        err = aos_rpc_lmp_try_send(rpc->lmp_chan, flags, cap, nwords, w);
+        if (err_is_ok(err)) {
+            return SYS_ERR_OK;
+        }
+        if (!lmp_err_is_transient(err)) {
+            return err_push(err, LIB_ERR_LMP_CHAN_SEND);
+        }
+    }
+
+    m = malloc(sizeof(*m) + nwords * sizeof(uintptr_t));
+    if (m == NULL) {
+        return LIB_ERR_MALLOC_FAIL;
+    }
+    m->next = NULL;
+    m->flags = flags;
+    m->nwords = nwords;
+    memcpy(m->words, w, nwords * sizeof(uintptr_t));
+
+    // the caller may delete its capability once we return
+    m->cap = NULL_CAP;
+    if (!capref_is_null(cap)) {
+        err = slot_alloc(&m->cap);
+        if (err_is_ok(err)) {
+            err = cap_copy(m->cap, cap);
+        }
+        if (err_is_fail(err)) {
+            free(m);
+            return err_push(err, LIB_ERR_CAP_COPY);
+        }
     }
 
-    // debug_printf("sent setup message\n");
+    if (rpc->txq_head == NULL) {
+        rpc->txq_head = m;
+        rpc->txq_tail = m;
+        aos_rpc_txq_flush(rpc);
+    } else {
+        rpc->txq_tail->next = m;
+        rpc->txq_tail = m;
+    }
+    return SYS_ERR_OK;
 }
 
+// send one message of a request, or of a reply without ever waiting for the client
+static errval_t aos_rpc_lmp_put(struct aos_rpc *rpc, bool reply, lmp_send_flags_t flags,
+                                struct capref cap, size_t nwords, const uintptr_t *w)
+{
+    if (reply) {
+        return aos_rpc_reply_send(rpc, flags, cap, nwords, w);
+    }
+    return aos_rpc_lmp_send(rpc->lmp_chan, flags, cap, nwords, w);
+}
 
-void ack_recv_handler(void *arg) {
-    // debug_printf("received ack message\n");
-    struct lmp_recv_msg msg = LMP_RECV_MSG_INIT;
-    struct aos_rpc *rpc = arg;
+// send a payload inline, the first message carries the header, the argument and the length
+static errval_t aos_rpc_lmp_send_inline(struct aos_rpc *rpc, bool reply, uintptr_t hdr,
+                                        uintptr_t arg, const void *data, size_t len)
+{
+    uintptr_t w[LMP_MSG_LENGTH] = { 0 };
+    const char *p = data;
+    size_t chunk;
     errval_t err;
-    
-    struct capref retcap;
-    err = lmp_chan_recv(rpc->lmp_chan, &msg, &retcap);
-    
-    // debug_printf("ack recv handler: msg words[0]: %d\n", msg.words[0]);
-    err = lmp_chan_register_recv(rpc->lmp_chan, get_default_waitset(), MKCLOSURE(ack_recv_handler, arg));
-
-    if (msg.words[0] == PID_ACK) {
-        err = lmp_chan_alloc_recv_slot(rpc->lmp_chan);
-        // debug_printf("heres the pid: %d\n", msg.words[1]);
-        global_pid = msg.words[1];
+
+    assert(len <= AOS_RPC_INLINE_MAX);
+
+    // in one piece if it doesn't fit into a single message, the receiver takes it as it is;
+    // behind queued replies we can't find out whether it fits, so send the pieces then
+    uintptr_t *lw = len > AOS_RPC_INLINE_HEAD && (!reply || rpc->txq_head == NULL)
+                        ? lmp_chan_long_buf(rpc->lmp_chan) : NULL;
+    if (lw != NULL) {
+        lw[0] = hdr | AOS_RPC_HDR_INLINE;
+        lw[1] = arg;
+        lw[2] = len;
+        lw[2 + DIVIDE_ROUND_UP(len, sizeof(uintptr_t))] = 0;
+        memcpy(&lw[3], p, len);
+        err = aos_rpc_lmp_put(rpc, reply, AOS_RPC_LMP_FLAGS_HANDOFF, NULL_CAP,
+                              3 + DIVIDE_ROUND_UP(len, sizeof(uintptr_t)), lw);
+        // otherwise the receiver's endpoint is too small for it, fall back to pieces
+        if (err_no(err_pop(err)) != SYS_ERR_LMP_MSG_TOO_LONG) {
+            return err;
+        }
+    }
+
+    w[0] = hdr | AOS_RPC_HDR_INLINE;
+    w[1] = arg;
+    w[2] = len;
+    chunk = MIN(len, AOS_RPC_INLINE_HEAD);
+    memcpy(&w[3], p, chunk);
+    // only hand off with the last chunk, the receiver can't do anything with the others
+    err = aos_rpc_lmp_put(rpc, reply, chunk == len ? AOS_RPC_LMP_FLAGS_HANDOFF : AOS_RPC_LMP_FLAGS,
+                          NULL_CAP, 3 + DIVIDE_ROUND_UP(chunk, sizeof(uintptr_t)), w);
+    p += chunk;
+    len -= chunk;
+
+    while (len > 0 && err_is_ok(err)) {
+        chunk = MIN(len, sizeof(w));
+        memset(w, 0, sizeof(w));
+        memcpy(w, p, chunk);
+        err = aos_rpc_lmp_put(rpc, reply, chunk == len ? AOS_RPC_LMP_FLAGS_HANDOFF : AOS_RPC_LMP_FLAGS,
+                              NULL_CAP, DIVIDE_ROUND_UP(chunk, sizeof(uintptr_t)), w);
+        p += chunk;
+        len -= chunk;
+    }
+
+    return err;
+}
+
+bool aos_rpc_inline_recv(struct aos_rpc *rpc, struct lmp_recv_long_msg *msg)
+{
+    struct aos_rpc_inline_rx *rx = &rpc->rx;
+    size_t msglen = msg->buf.msglen * sizeof(uintptr_t);
+    size_t chunk;
+
+    if (rx->off < rx->len) {
+        // continuation of the payload being reassembled
+        chunk = MIN(rx->len - rx->off, msglen);
+        memcpy(rx->buf + rx->off, msg->words, chunk);
+        rx->off += chunk;
+    } else if (AOS_RPC_IS_INLINE(msg->words[0])) {
+        // the first message, or all of the payload if it came as an extended one
+        rx->hdr = msg->words[0];
+        rx->arg = msg->words[1];
+        rx->len = MIN(msg->words[2], AOS_RPC_INLINE_MAX);
+        chunk = MIN(rx->len, msglen - MIN(msglen, 3 * sizeof(uintptr_t)));
+        memcpy(rx->buf, &msg->words[3], chunk);
+        rx->off = chunk;
+    } else {
+        return true;
+    }
+
+    if (rx->off < rx->len) {
+        return false;
+    }
+
+    rx->buf[rx->len] = '\0';
+    msg->words[0] = rx->hdr;
+    msg->words[1] = rx->arg;
+    msg->words[2] = rx->len;
+    return true;
+}
+
+static void aos_rpc_recv_handler(void *arg)
+{
+    struct lmp_recv_long_msg msg = LMP_RECV_LONG_MSG_INIT;
+    struct aos_rpc *rpc = arg;
+    struct lmp_chan *lc = rpc->lmp_chan;
+    struct capref cap;
+    errval_t err, recv_err;
+
+    recv_err = lmp_chan_recv_long(lc, &msg, &cap);
+
+    // re-register first: allocating a new receive slot below may itself need an RPC
+    err = lmp_chan_register_recv(lc, &rpc->ws, MKCLOSURE(aos_rpc_recv_handler, arg));
+    if (err_is_fail(err)) {
+        DEBUG_ERR(err, "re-registering rpc receive handler");
         return;
-    } else if (msg.words[0] == RAM_CAP_ACK) {
-        err = lmp_chan_alloc_recv_slot(rpc->lmp_chan);
-        // debug_printf("received ram cap size: %d\n", msg.words[1]);
-        global_retcap = retcap;
-        global_retbytes = msg.words[1];
+    }
+    if (err_is_fail(recv_err)) {
+        if (err_no(recv_err) != LIB_ERR_NO_LMP_MSG) {
+            DEBUG_ERR(recv_err, "receiving rpc reply");
+        }
         return;
-    } else if (msg.words[0] == GETCHAR_ACK) {
-        err = lmp_chan_alloc_recv_slot(rpc->lmp_chan);
-        // debug_printf("received char: %c\n", msg.words[1]);
-        global_retchar = msg.words[1];
+    }
+
+    if (!capref_is_null(cap)) {
+        err = lmp_chan_alloc_recv_slot(lc);
+        if (err_is_fail(err)) {
+            DEBUG_ERR(err, "allocating new rpc receive slot");
+        }
+    }
+
+    if (!aos_rpc_inline_recv(rpc, &msg)) {
         return;
     }
-    // debug_printf("received ack\n");
-        
-   // debug_printf("heres the address of rpc->waiting_on_ack from the ack pov: %p\n", &(rpc->waiting_on_ack));
-    while (err_is_fail(err)) {
-        // debug_printf("\n\n\n\nthis actually ran (ack recv handler)\n\n\n\n\n");
+
+    uint32_t id = AOS_RPC_HDR_ID(msg.words[0]);
+
+    thread_mutex_lock(&rpc->mutex);
+    struct aos_rpc_call *call = rpc->pending[id % AOS_RPC_MAX_PENDING];
+    if (call != NULL && call->id == id) {
+        call->type = AOS_RPC_HDR_TYPE(msg.words[0]);
+        call->val = msg.words[1];
+        call->cap = cap;
+        if (AOS_RPC_IS_INLINE(msg.words[0]) && call->buf != NULL && call->buflen > 0) {
+            call->len = MIN(rpc->rx.len, call->buflen - 1);
+            memcpy(call->buf, rpc->rx.buf, call->len);
+            call->buf[call->len] = '\0';
+        }
+        call->done = true;
+        rpc->pending[id % AOS_RPC_MAX_PENDING] = NULL;
+        if (call->async) {
+            rpc->async_pending--;
+            if (call->done_ws != NULL) {
+                err = waitset_chan_trigger_closure(call->done_ws, &call->done_chan, call->done_cl);
+                if (err_is_fail(err)) {
+                    DEBUG_ERR(err, "delivering rpc completion");
+                }
+            }
+        }
+        thread_cond_broadcast(&rpc->cond);
+    } else {
+        debug_printf("dropping rpc reply for unknown call %u\n", id);
+    }
+    thread_mutex_unlock(&rpc->mutex);
+}
+
+/*
+ * Make progress on the channel. Only one thread dispatches the reply waitset at a time;
+ * the others sleep on rpc->cond until either their reply has been filled in or the
+ * dispatching thread leaves and one of them has to take over. A call made from within a
+ * handler running on the dispatching thread simply dispatches recursively.
+ *
+ * Called and returns with rpc->mutex held.
+ */
+static errval_t aos_rpc_progress(struct aos_rpc *rpc)
+{
+    struct thread *self = thread_self();
+    if (rpc->pump != NULL && rpc->pump != self) {
+        thread_cond_wait(&rpc->cond, &rpc->mutex);
+        return SYS_ERR_OK;
     }
 
-    err = lmp_chan_alloc_recv_slot(rpc->lmp_chan);
+    struct thread *outer = rpc->pump;
+    rpc->pump = self;
+    thread_mutex_unlock(&rpc->mutex);
+
+    errval_t err = event_dispatch(&rpc->ws);
+
+    thread_mutex_lock(&rpc->mutex);
+    rpc->pump = outer;
+    if (outer == NULL) {
+        thread_cond_broadcast(&rpc->cond);
+    }
+    return err;
+}
+
+// reserve a call id and a slot in the pending table, waiting for a reply if all are taken
+static errval_t aos_rpc_call_begin(struct aos_rpc *rpc, struct aos_rpc_call *call)
+{
+    errval_t err;
+
+    call->done = false;
+    call->val = 0;
+    call->cap = NULL_CAP;
+    call->len = 0;
+
+    thread_mutex_lock(&rpc->mutex);
+    int scanned = 0;
+    while (true) {
+        uint32_t id = rpc->next_id++;
+        if (id != 0 && rpc->pending[id % AOS_RPC_MAX_PENDING] == NULL) {
+            call->id = id;
+            rpc->pending[id % AOS_RPC_MAX_PENDING] = call;
+            if (call->async && rpc->async_pending++ == 0) {
+                thread_cond_signal(&rpc->async_cond);
+            }
+            break;
+        }
+        if (++scanned == AOS_RPC_MAX_PENDING) {
+            scanned = 0;
+            err = aos_rpc_progress(rpc);
+            if (err_is_fail(err)) {
+                thread_mutex_unlock(&rpc->mutex);
+                return err;
+            }
+        }
+    }
+    thread_mutex_unlock(&rpc->mutex);
+
+    return SYS_ERR_OK;
+}
+
+// block until the reply to call has arrived, err is the outcome of sending the request
+static errval_t aos_rpc_call_wait(struct aos_rpc *rpc, struct aos_rpc_call *call, errval_t err)
+{
+    thread_mutex_lock(&rpc->mutex);
+    while (err_is_ok(err) && !call->done) {
+        err = aos_rpc_progress(rpc);
+    }
+    if (!call->done) {
+        rpc->pending[call->id % AOS_RPC_MAX_PENDING] = NULL;
+        if (call->async) {
+            rpc->async_pending--;
+        }
+    }
+    thread_mutex_unlock(&rpc->mutex);
+
+    return err;
+}
+
+// reset a call before it is started
+static void aos_rpc_call_prepare(struct aos_rpc_call *call, char *buf, size_t buflen)
+{
+    call->buf = buf;
+    call->buflen = buflen;
+    call->async = false;
+    call->done_ws = NULL;
+}
+
+// send a request of up to two words, the call must have been begun
+static errval_t aos_rpc_send_req(struct aos_rpc *rpc, enum msg_type type, struct capref cap,
+                                 uintptr_t arg1, uintptr_t arg2, struct aos_rpc_call *call)
+{
+    errval_t err;
+    uintptr_t w[LMP_MSG_LENGTH] = { AOS_RPC_HDR(type, call->id), arg1, arg2 };
+
+    thread_mutex_lock(&rpc->send_mutex);
+    err = aos_rpc_lmp_send(rpc->lmp_chan, AOS_RPC_LMP_FLAGS_HANDOFF, cap, 3, w);
+    thread_mutex_unlock(&rpc->send_mutex);
+
+    return err;
+}
+
+// send a request with an inline payload, the call must have been begun
+static errval_t aos_rpc_send_req_inline(struct aos_rpc *rpc, enum msg_type type, uintptr_t arg,
+                                        const void *data, size_t len,
+                                        struct aos_rpc_call *call)
+{
+    errval_t err;
+
+    thread_mutex_lock(&rpc->send_mutex);
+    err = aos_rpc_lmp_send_inline(rpc, false, AOS_RPC_HDR(type, call->id), arg, data, len);
+    thread_mutex_unlock(&rpc->send_mutex);
+
+    return err;
+}
+
+/*
+ * Perform a call whose reply may carry an inline payload, which is stored NUL-terminated
+ * in buf. Any number of threads may have calls outstanding on the same channel; each one
+ * only returns once the reply carrying its own call id has been received.
+ */
+static errval_t aos_rpc_call_buf(struct aos_rpc *rpc, enum msg_type type, struct capref cap,
+                                 uintptr_t arg1, uintptr_t arg2, char *buf, size_t buflen,
+                                 struct aos_rpc_call *call)
+{
+    errval_t err;
+
+    aos_rpc_call_prepare(call, buf, buflen);
+    err = aos_rpc_call_begin(rpc, call);
+    if (err_is_fail(err)) {
+        return err;
+    }
+
+    err = aos_rpc_send_req(rpc, type, cap, arg1, arg2, call);
+    return aos_rpc_call_wait(rpc, call, err);
+}
+
+/**
+ * @brief Perform a call on an RPC channel and block until its reply has arrived.
+ *
+ * @param[in]  rpc   the RPC channel to use
+ * @param[in]  type  message type of the request
+ * @param[in]  cap   capability to send with the request, or NULL_CAP
+ * @param[in]  arg1  first payload word of the request
+ * @param[in]  arg2  second payload word of the request
+ * @param[out] call  filled in with the reply
+ *
+ * @returns SYS_ERR_OK on success, or error value on failure
+ */
+static errval_t aos_rpc_call(struct aos_rpc *rpc, enum msg_type type, struct capref cap,
+                             uintptr_t arg1, uintptr_t arg2, struct aos_rpc_call *call)
+{
+    return aos_rpc_call_buf(rpc, type, cap, arg1, arg2, NULL, 0, call);
+}
+
+/**
+ * @brief Perform a call whose request carries a payload inline instead of in a frame.
+ *
+ * @param[in]  rpc   the RPC channel to use
+ * @param[in]  type  message type of the request
+ * @param[in]  arg   argument word of the request
+ * @param[in]  data  the payload, at most AOS_RPC_INLINE_MAX bytes
+ * @param[in]  len   length of the payload in bytes
+ * @param[out] call  filled in with the reply
+ *
+ * @returns SYS_ERR_OK on success, or error value on failure
+ *
+ * The send mutex is held across all messages of the payload so that they arrive back to
+ * back, which is what lets the receiver reassemble it without any per-message framing.
+ */
+static errval_t aos_rpc_call_inline(struct aos_rpc *rpc, enum msg_type type, uintptr_t arg,
+                                    const void *data, size_t len, struct aos_rpc_call *call)
+{
+    errval_t err;
+
+    aos_rpc_call_prepare(call, NULL, 0);
+    err = aos_rpc_call_begin(rpc, call);
+    if (err_is_fail(err)) {
+        return err;
+    }
+
+    err = aos_rpc_send_req_inline(rpc, type, arg, data, len, call);
+    return aos_rpc_call_wait(rpc, call, err);
+}
+
+// claim a bulk slot, waiting while all of them are used by outstanding calls
+static size_t aos_rpc_bulk_slot_get(struct aos_rpc *rpc)
+{
+    thread_mutex_lock(&rpc->bulk_mutex);
+    while (rpc->bulk_busy == (1U << AOS_RPC_BULK_SLOTS) - 1) {
+        thread_cond_wait(&rpc->bulk_cond, &rpc->bulk_mutex);
+    }
+    size_t slot = __builtin_ctz(~rpc->bulk_busy);
+    rpc->bulk_busy |= 1U << slot;
+    thread_mutex_unlock(&rpc->bulk_mutex);
+
+    return slot;
+}
+
+static void aos_rpc_bulk_slot_put(struct aos_rpc *rpc, size_t slot)
+{
+    thread_mutex_lock(&rpc->bulk_mutex);
+    rpc->bulk_busy &= ~(1U << slot);
+    thread_cond_signal(&rpc->bulk_cond);
+    thread_mutex_unlock(&rpc->bulk_mutex);
+}
+
+/**
+ * @brief Perform a call whose request payload is passed in the bulk frame shared with init.
+ *
+ * @param[in]  rpc     the RPC channel to use
+ * @param[in]  type    message type of the request
+ * @param[in]  cap     capability to send with the request, or NULL_CAP
+ * @param[in]  arg     argument word of the request
+ * @param[in]  data    the payload, at most AOS_RPC_BULK_SIZE bytes, or NULL
+ * @param[in]  len     length of the payload in bytes
+ * @param[out] out     receives the start of the response area, or NULL
+ * @param[in]  outlen  number of bytes to copy into out
+ * @param[out] call    filled in with the reply
+ *
+ * @returns SYS_ERR_OK on success, or error value on failure
+ *
+ * The call owns one of the AOS_RPC_BULK_SLOTS slots of the frame from filling in its
+ * request area until its response has been copied out, so other bulk calls on the
+ * channel only wait for it if all slots are in use.
+ */
+static errval_t aos_rpc_call_bulk(struct aos_rpc *rpc, enum msg_type type, struct capref cap,
+                                  uintptr_t arg, const void *data, size_t len, void *out,
+                                  size_t outlen, struct aos_rpc_call *call)
+{
+    errval_t err;
+
+    if (rpc->bulk_req == NULL) {
+        return AOS_ERR_BULK_FRAME_INVALID;
+    }
+    if (len > AOS_RPC_BULK_SIZE || outlen > AOS_RPC_BULK_SIZE) {
+        return AOS_ERR_BULK_ARGS_INVALID;
+    }
+
+    size_t slot = aos_rpc_bulk_slot_get(rpc);
+
+    aos_rpc_call_prepare(call, NULL, 0);
+    err = aos_rpc_call_begin(rpc, call);
+    if (err_is_fail(err)) {
+        aos_rpc_bulk_slot_put(rpc, slot);
+        return err;
+    }
+
+    uintptr_t w[LMP_MSG_LENGTH] = { AOS_RPC_HDR(type, call->id) | AOS_RPC_HDR_BULK
+                                        | AOS_RPC_HDR_WITH_SLOT(slot), arg, len };
+    if (data != NULL) {
+        memcpy(aos_rpc_bulk_req(rpc, w[0]), data, len);
+    }
+
+    thread_mutex_lock(&rpc->send_mutex);
+    err = aos_rpc_lmp_send(rpc->lmp_chan, AOS_RPC_LMP_FLAGS_HANDOFF, cap, 3, w);
+    thread_mutex_unlock(&rpc->send_mutex);
+
+    err = aos_rpc_call_wait(rpc, call, err);
+    if (err_is_ok(err) && out != NULL) {
+        memcpy(out, aos_rpc_bulk_resp(rpc, w[0]), outlen);
+    }
+    aos_rpc_bulk_slot_put(rpc, slot);
+
+    return err;
+}
+
+errval_t aos_rpc_call_msg(struct aos_rpc *rpc, enum msg_type type, struct capref cap,
+                          const void *data, size_t len, void *out, size_t *outlen,
+                          struct aos_rpc_call *call)
+{
+    errval_t err;
+    char buf[AOS_RPC_INLINE_MAX + 1];
+
+    if (rpc->bulk_req == NULL) {
+        return AOS_ERR_BULK_FRAME_INVALID;
+    }
+    if (len > AOS_RPC_BULK_SIZE) {
+        return AOS_ERR_BULK_ARGS_INVALID;
+    }
+
+    // the reply may come back through the response area as well
+    size_t slot = aos_rpc_bulk_slot_get(rpc);
+
+    aos_rpc_call_prepare(call, buf, sizeof(buf));
+    err = aos_rpc_call_begin(rpc, call);
+    if (err_is_fail(err)) {
+        aos_rpc_bulk_slot_put(rpc, slot);
+        return err;
+    }
+
+    uintptr_t hdr = AOS_RPC_HDR(type, call->id) | AOS_RPC_HDR_WITH_SLOT(slot);
+    thread_mutex_lock(&rpc->send_mutex);
+    if (len <= AOS_RPC_INLINE_MAX && capref_is_null(cap)) {
+        err = aos_rpc_lmp_send_inline(rpc, false, hdr, 0, data, len);
+    } else {
+        memcpy(aos_rpc_bulk_req(rpc, hdr), data, len);
+        uintptr_t w[LMP_MSG_LENGTH] = { hdr | AOS_RPC_HDR_BULK, 0, len };
+        err = aos_rpc_lmp_send(rpc->lmp_chan, AOS_RPC_LMP_FLAGS_HANDOFF, cap, 3, w);
+    }
+    thread_mutex_unlock(&rpc->send_mutex);
+
+    // the reply word is the length of its payload, which only was inline if it all arrived
+    err = aos_rpc_call_wait(rpc, call, err);
+    if (err_is_ok(err)) {
+        *outlen = MIN(call->val, AOS_RPC_BULK_SIZE);
+        memcpy(out, call->len == *outlen ? buf : aos_rpc_bulk_resp(rpc, hdr), *outlen);
+    }
+    call->buf = NULL;
+    aos_rpc_bulk_slot_put(rpc, slot);
+
+    return err;
+}
+
+/*
+ * Body of the thread collecting replies to asynchronous calls. It takes part in the usual
+ * dispatch hand-off, so synchronous callers on other threads are served along the way.
+ */
+static int aos_rpc_async_pump(void *arg)
+{
+    struct aos_rpc *rpc = arg;
+    errval_t err;
+
+    thread_mutex_lock(&rpc->mutex);
+    while (true) {
+        if (rpc->async_pending == 0) {
+            thread_cond_wait(&rpc->async_cond, &rpc->mutex);
+            continue;
+        }
+        err = aos_rpc_progress(rpc);
+        if (err_is_fail(err)) {
+            DEBUG_ERR(err, "dispatching rpc replies");
+        }
+    }
+
+    return 0;
+}
+
+// turn call into an asynchronous one and make sure its reply will be collected
+static errval_t aos_rpc_async_prepare(struct aos_rpc *rpc, struct waitset *ws,
+                                      struct event_closure cl, struct aos_rpc_call *call)
+{
+    aos_rpc_call_prepare(call, NULL, 0);
+    call->async = true;
+    call->done_ws = ws;
+    call->done_cl = cl;
+    if (ws != NULL) {
+        waitset_chanstate_init(&call->done_chan, CHANTYPE_OTHER);
+    }
+
+    thread_mutex_lock(&rpc->mutex);
+    if (rpc->async_pump == NULL) {
+        rpc->async_pump = thread_create(aos_rpc_async_pump, rpc);
+        if (rpc->async_pump == NULL) {
+            thread_mutex_unlock(&rpc->mutex);
+            return LIB_ERR_THREAD_CREATE;
+        }
+    }
+    thread_mutex_unlock(&rpc->mutex);
+
+    return SYS_ERR_OK;
+}
+
+errval_t aos_rpc_call_async(struct aos_rpc *rpc, enum msg_type type, struct capref cap,
+                            uintptr_t arg1, uintptr_t arg2, struct waitset *ws,
+                            struct event_closure cl, struct aos_rpc_call *call)
+{
+    errval_t err;
+
+    err = aos_rpc_async_prepare(rpc, ws, cl, call);
+    if (err_is_fail(err)) {
+        return err;
+    }
+    err = aos_rpc_call_begin(rpc, call);
+    if (err_is_fail(err)) {
+        return err;
+    }
+
+    err = aos_rpc_send_req(rpc, type, cap, arg1, arg2, call);
+    if (err_is_fail(err)) {
+        // drops the call again
+        return aos_rpc_call_wait(rpc, call, err);
+    }
+    return SYS_ERR_OK;
+}
+
+errval_t aos_rpc_call_async_inline(struct aos_rpc *rpc, enum msg_type type, uintptr_t arg,
+                                   const void *data, size_t len, struct waitset *ws,
+                                   struct event_closure cl, struct aos_rpc_call *call)
+{
+    errval_t err;
+
+    if (len > AOS_RPC_INLINE_MAX) {
+        return LIB_ERR_STRING_TOO_LONG;
+    }
+
+    err = aos_rpc_async_prepare(rpc, ws, cl, call);
+    if (err_is_fail(err)) {
+        return err;
+    }
+    err = aos_rpc_call_begin(rpc, call);
+    if (err_is_fail(err)) {
+        return err;
+    }
+
+    err = aos_rpc_send_req_inline(rpc, type, arg, data, len, call);
+    if (err_is_fail(err)) {
+        // drops the call again
+        return aos_rpc_call_wait(rpc, call, err);
+    }
+    return SYS_ERR_OK;
+}
+
+bool aos_rpc_call_test(struct aos_rpc *rpc, struct aos_rpc_call *call)
+{
+    thread_mutex_lock(&rpc->mutex);
+    bool done = call->done;
+    thread_mutex_unlock(&rpc->mutex);
+
+    return done;
+}
+
+errval_t aos_rpc_call_await(struct aos_rpc *rpc, struct aos_rpc_call *call)
+{
+    return aos_rpc_call_wait(rpc, call, SYS_ERR_OK);
+}
+
+errval_t aos_rpc_reply(struct aos_rpc *rpc, uintptr_t req_hdr, enum msg_type type,
+                       struct capref cap, uintptr_t val)
+{
+    errval_t err;
+    uintptr_t w[LMP_MSG_LENGTH] = { AOS_RPC_HDR(type, AOS_RPC_HDR_ID(req_hdr)), val };
+
+    thread_mutex_lock(&rpc->send_mutex);
+    err = aos_rpc_reply_send(rpc, AOS_RPC_LMP_FLAGS_HANDOFF, cap, 2, w);
+    thread_mutex_unlock(&rpc->send_mutex);
+
+    return err;
+}
+
+errval_t aos_rpc_reply_inline(struct aos_rpc *rpc, uintptr_t req_hdr, enum msg_type type,
+                              uintptr_t val, const void *data, size_t len)
+{
+    errval_t err;
+
+    thread_mutex_lock(&rpc->send_mutex);
+    err = aos_rpc_lmp_send_inline(rpc, true, AOS_RPC_HDR(type, AOS_RPC_HDR_ID(req_hdr)),
+                                  val, data, MIN(len, AOS_RPC_INLINE_MAX));
+    thread_mutex_unlock(&rpc->send_mutex);
+
+    return err;
+}
+
+errval_t aos_rpc_reply_msg(struct aos_rpc *rpc, uintptr_t req_hdr, struct capref cap,
+                           const void *data, size_t len)
+{
+    if (len <= AOS_RPC_INLINE_MAX && capref_is_null(cap)) {
+        return aos_rpc_reply_inline(rpc, req_hdr, ACK_MSG, len, data, len);
+    }
+
+    if (rpc->bulk_resp == NULL) {
+        return AOS_ERR_BULK_FRAME_INVALID;
+    }
+    if (len > AOS_RPC_BULK_SIZE) {
+        return AOS_ERR_BULK_ARGS_INVALID;
+    }
+    memcpy(aos_rpc_bulk_resp(rpc, req_hdr), data, len);
+    return aos_rpc_reply(rpc, req_hdr, ACK_MSG, cap, len);
 }
 
 
+
 /*
  * ===============================================================================================
  * Generic RPCs
@@ -108,10 +869,95 @@ errval_t aos_rpc_init(struct aos_rpc *rpc) {
         return LIB_ERR_MALLOC_FAIL;
     }
     lmp_chan_init(rpc->lmp_chan);
+    rpc->pid = 0;
+
+    waitset_init(&rpc->ws);
+    thread_mutex_init(&rpc->mutex);
+    thread_cond_init(&rpc->cond);
+    thread_mutex_init(&rpc->send_mutex);
+    memset(rpc->pending, 0, sizeof(rpc->pending));
+    rpc->next_id = 1;
+    rpc->pump = NULL;
+    rpc->rx.len = 0;
+    rpc->rx.off = 0;
+    rpc->txq_head = NULL;
+    rpc->txq_tail = NULL;
+
+    rpc->bulk_req = NULL;
+    rpc->bulk_resp = NULL;
+    thread_mutex_init(&rpc->bulk_mutex);
+    thread_cond_init(&rpc->bulk_cond);
+    rpc->bulk_busy = 0;
+
+    rpc->async_pump = NULL;
+    thread_cond_init(&rpc->async_cond);
+    rpc->async_pending = 0;
+
+    return SYS_ERR_OK;
+}
+
+errval_t aos_rpc_bulk_map(struct aos_rpc *rpc, struct capref frame)
+{
+    errval_t err;
+    void *buf;
+
+    err = paging_map_frame_attr(get_current_paging_state(), &buf, AOS_RPC_BULK_FRAME_SIZE,
+                                frame, VREGION_FLAGS_READ_WRITE);
+    if (err_is_fail(err)) {
+        return err_push(err, LIB_ERR_VSPACE_MAP);
+    }
 
+    rpc->bulk_req = buf;
+    rpc->bulk_resp = (char *)buf + AOS_RPC_BULK_SLOTS * AOS_RPC_BULK_SIZE;
     return SYS_ERR_OK;
 }
 
+errval_t aos_rpc_bind(struct aos_rpc *rpc, struct capref ep)
+{
+    errval_t err;
+    struct aos_rpc_call call;
+
+    err = aos_rpc_init(rpc);
+    if (err_is_fail(err)) {
+        return err;
+    }
+    err = lmp_chan_accept(rpc->lmp_chan, AOS_RPC_LMP_BUF_WORDS, ep);
+    if (err_is_fail(err)) {
+        return err_push(err, LIB_ERR_LMP_CHAN_ACCEPT);
+    }
+    err = lmp_chan_alloc_recv_slot(rpc->lmp_chan);
+    if (err_is_fail(err)) {
+        return err_push(err, LIB_ERR_LMP_ALLOC_RECV_SLOT);
+    }
+    err = lmp_chan_register_recv(rpc->lmp_chan, &rpc->ws,
+                                 MKCLOSURE(aos_rpc_recv_handler, (void *)rpc));
+    if (err_is_fail(err)) {
+        return err_push(err, LIB_ERR_CHAN_REGISTER_RECV);
+    }
+
+    // the listening endpoint is shared by all clients, the channel moves to the server's
+    // endpoint for it
+    err = aos_rpc_call(rpc, NS_BIND_LMP, rpc->lmp_chan->local_cap, 0, 0, &call);
+    if (err_is_fail(err)) {
+        return err;
+    }
+    if (capref_is_null(call.cap)) {
+        return LIB_ERR_LMP_CHAN_BIND;
+    }
+    rpc->lmp_chan->remote_cap = call.cap;
+
+    struct capref frame;
+    err = frame_alloc(&frame, AOS_RPC_BULK_FRAME_SIZE, NULL);
+    if (err_is_fail(err)) {
+        return err_push(err, LIB_ERR_FRAME_ALLOC);
+    }
+    err = aos_rpc_bulk_map(rpc, frame);
+    if (err_is_fail(err)) {
+        return err;
+    }
+    return aos_rpc_call(rpc, NS_BIND_BULK, frame, 0, 0, &call);
+}
+
 // get the correct struct ump_chan on the monitor
 // direction == 0: core -> monitor
 // direction == 1: monitor -> core
@@ -125,28 +971,107 @@ struct ump_chan *get_ump_chan_mon(coreid_t core, int direction) {
 // direction == 0: core -> monitor
 // direction == 1: monitor -> core
 struct ump_chan *get_ump_chan_core(int direction) {
+    // mapped by init on this core, the kernel's mapping does not cover all of it
+    genvaddr_t frame = global_urpc_frames[disp_get_core_id()];
+    assert(frame != 0);
+
     // BASE_PAGE_SIZE / 2 should be enough for bootinfo...
-    return (struct ump_chan *)(MON_URPC_VBASE + 
-            BASE_PAGE_SIZE / 2 + direction * sizeof(struct ump_chan));
+    return (struct ump_chan *)(frame + BASE_PAGE_SIZE / 2 + direction * sizeof(struct ump_chan));
+}
+
+bool ump_peer_connected(coreid_t core) {
+    coreid_t me = disp_get_core_id();
+    if (core >= UMP_MAX_CORES || core == me) {
+        return false;
+    }
+    if (me == 0) {
+        return global_urpc_frames[core] != 0;
+    }
+    if (core == 0) {
+        return global_urpc_frames[me] != 0;
+    }
+    return global_ump_mesh_frames[core] != 0;
+}
+
+// get the channel between this core and another, on any core
+// direction == 0: this core -> core
+// direction == 1: core -> this core
+struct ump_chan *get_ump_chan_peer(coreid_t core, int direction) {
+    coreid_t me = disp_get_core_id();
+    assert(ump_peer_connected(core));
+
+    if (me == 0) {
+        return get_ump_chan_mon(core, !direction);
+    }
+    if (core == 0) {
+        return get_ump_chan_core(direction);
+    }
+
+    // direction 0 of the frame goes from the lower core id to the higher one
+    int chan = me < core ? direction : !direction;
+    return (struct ump_chan *)(global_ump_mesh_frames[core] + BASE_PAGE_SIZE / 2
+                               + chan * sizeof(struct ump_chan));
+}
+
+/// payload bytes carried by each slot of a UMP channel
+#define UMP_FRAG_SIZE sizeof(((struct cache_line *)0)->payload)
+
+// the slot that the n-th message fragment sent on the channel goes to
+static inline struct cache_line *ump_slot(struct ump_chan *chan, size_t n)
+{
+    size_t nslots = chan->size / sizeof(struct cache_line);
+    return (struct cache_line *)((genvaddr_t)chan + chan->base) + (n % nslots);
 }
 
 // reset pointers and zero out a struct ump_chan
-errval_t ump_chan_init(struct ump_chan *chan, size_t base) {
+errval_t ump_chan_init(struct ump_chan *chan, size_t base, size_t size, size_t data_base,
+                       size_t data_size) {
+    assert(size % sizeof(struct cache_line) == 0);
     chan->base = base;
+    chan->size = size;
+    chan->data_base = data_base;
+    chan->data_size = data_size;
     chan->head = 0;
+    chan->acked_cache = 0;
+    chan->data_head = 0;
+    chan->data_acked_cache = 0;
+    chan->acked = 0;
     chan->tail = 0;
-    chan->size = BASE_PAGE_SIZE;
-    memset((void *)((genvaddr_t)chan + (genvaddr_t)chan->base), 0, BASE_PAGE_SIZE);
+    chan->data_acked = 0;
+    chan->data_seen = 0;
+    chan->sleeping = 0;
+    thread_mutex_init(&chan->send_mutex);
+    thread_mutex_init(&chan->release_mutex);
+    memset((void *)((genvaddr_t)chan + (genvaddr_t)chan->base), 0, chan->size);
+    dmb();
     return SYS_ERR_OK;
 }
 
+struct ump_chan *ump_frame_chan(void *frame, int direction)
+{
+    return (struct ump_chan *)((genvaddr_t)frame + BASE_PAGE_SIZE / 2
+                               + direction * sizeof(struct ump_chan));
+}
+
+void ump_frame_init(void *frame)
+{
+    for (int direction = 0; direction < 2; direction++) {
+        struct ump_chan *chan = ump_frame_chan(frame, direction);
+        ump_chan_init(chan, (genvaddr_t)frame + UMP_URPC_RING_OFFSET(direction) - (genvaddr_t)chan,
+                      UMP_RING_PAGES * BASE_PAGE_SIZE,
+                      (genvaddr_t)frame + UMP_URPC_DATA_OFFSET(direction) - (genvaddr_t)chan,
+                      UMP_DATA_PAGES * BASE_PAGE_SIZE);
+    }
+}
+
 void ump_print(struct ump_chan *chan) {
-    debug_printf("circular buffer with base %d\n", chan->base);
+    debug_printf("circular buffer with base %zu, head %zu, tail %zu, acked %zu\n", chan->base,
+                 chan->head, chan->tail, chan->acked);
     for (int i = 0; i < 10; i++) {
         // get the current cache line
-        struct cache_line *cl = (struct cache_line *)((genvaddr_t)chan + chan->base + 64 * i);
+        struct cache_line *cl = ump_slot(chan, chan->tail + i);
 
-        if (cl->valid) {
+        if (cl->seq == (uint32_t)(chan->tail + i + 1)) {
             dmb();
             debug_printf("line of type %d\n", ((struct ump_payload *)(cl->payload))->type);
         } else {
@@ -155,359 +1080,557 @@ void ump_print(struct ump_chan *chan) {
     }
 }
 
-// add a message to the ump channel
-errval_t ump_send(struct ump_chan *chan, char *buf, size_t size) {
-    if (size > 256 * 58) {
-        return LIB_ERR_UMP_BUFSIZE_INVALID;
+// hand the slots consumed so far back to the producer
+static void ump_publish_acks(struct ump_chan *chan)
+{
+    if (chan->acked != chan->tail) {
+        // the slots must have been read before the producer may overwrite them
+        dmb();
+        chan->acked = chan->tail;
     }
-    
-    int total_frags = size % 58 == 0 ? size / 58 : (size / 58) + 1;
+}
 
-    dmb();
+// add a message to the ump channel, called with the send mutex held
+static errval_t ump_try_send_locked(struct ump_chan *chan, char *buf, size_t size) {
+    size_t nslots = chan->size / sizeof(struct cache_line);
+    size_t total_frags = DIVIDE_ROUND_UP(size, UMP_FRAG_SIZE);
+    if (total_frags == 0 || total_frags > nslots || total_frags > UINT8_MAX) {
+        return LIB_ERR_UMP_BUFSIZE_INVALID;
+    }
 
-    for (int frag_num = 0; frag_num < total_frags; frag_num++) {
-        struct cache_line *cl = (struct cache_line *)((genvaddr_t)chan + chan->base + chan->head);
-        if (!cl->valid) {
-            // zero out valid bytes in cache line
-            memset((void *)cl, 0, sizeof(struct cache_line));
+    // only look at the consumer's side once our cached copy says the ring is full
+    if (chan->head + total_frags - chan->acked_cache > nslots) {
+        chan->acked_cache = chan->acked;
+        dmb();
+        if (chan->head + total_frags - chan->acked_cache > nslots) {
+            return LIB_ERR_UMP_CHAN_FULL;
+        }
+    }
 
-            // copy data into cache line
-            memcpy((void *)cl, buf + frag_num * 58, MIN(58, size - frag_num * 58));
+    for (size_t frag_num = 0; frag_num < total_frags; frag_num++) {
+        struct cache_line *cl = ump_slot(chan, chan->head);
+        size_t off = frag_num * UMP_FRAG_SIZE;
 
-            // set other cache line fields
-            cl->frag_num = frag_num;
-            cl->total_frags = total_frags;
+        // copy data into cache line and set the other fields
+        memcpy(cl->payload, buf + off, MIN(UMP_FRAG_SIZE, size - off));
+        cl->frag_num = frag_num;
+        cl->total_frags = total_frags;
 
-            // make a memory barrier and set valid flag
-            dmb();
-            cl->valid = 1;
+        // the sequence number makes the slot visible, it has to be written last
+        dmb();
+        ((volatile struct cache_line *)cl)->seq = (uint32_t)(chan->head + 1);
+        chan->head++;
+    }
 
-            // advance head to next cache line
-            chan->head = (chan->head + sizeof(struct cache_line)) % chan->size;
-        } else {
-            // full, panic for now
-            USER_PANIC("ump channel full");
-            return LIB_ERR_UMP_CHAN_FULL;
+    // the receiver stopped polling, wake it up. It clears the flag itself once it is awake,
+    // so it may get more than one of these but never misses one.
+    dmb();
+    uint32_t sleeping = chan->sleeping;
+    if (sleeping != 0) {
+        errval_t err = invoke_ipi_notify(sleeping - 1);
+        if (err_is_fail(err)) {
+            // it will still see the message on its timer
+            DEBUG_ERR(err, "couldn't notify core %u", sleeping - 1);
         }
     }
 
     return SYS_ERR_OK;
 }
 
-errval_t ump_receive(struct ump_chan *chan, enum msg_type type, void *buf) {
-    // if tail == head, there are no messages
-    if (chan->tail == chan->head) {
-        return LIB_ERR_NO_UMP_MSG;
+// add a message to the ump channel, unless there is no room for all of its fragments
+errval_t ump_try_send(struct ump_chan *chan, char *buf, size_t size) {
+    // the fragments of messages sent by different threads must not interleave
+    thread_mutex_lock_nested(&chan->send_mutex);
+    errval_t err = ump_try_send_locked(chan, buf, size);
+    thread_mutex_unlock(&chan->send_mutex);
+    return err;
+}
+
+// add a message to the ump channel, yielding until the consumer has made room for it
+errval_t ump_send(struct ump_chan *chan, char *buf, size_t size) {
+    errval_t err, err2;
+
+    while ((err = ump_try_send(chan, buf, size)) == LIB_ERR_UMP_CHAN_FULL) {
+        // the consumer may itself be stuck sending to us, drain what it sent meanwhile
+        err2 = ump_demux_poll_peers();
+        if (err_is_fail(err2)) {
+            return err2;
+        }
+        thread_yield();
     }
+    return err;
+}
 
-    // if the tail msg type is not the type we're looking for, return
-    struct cache_line *cl = (struct cache_line *)((genvaddr_t)chan + chan->base + chan->tail);
-    if (!cl->valid) {
-        return LIB_ERR_NO_UMP_MSG;
+// the first slot of the next message if all of its fragments have arrived, NULL otherwise
+static struct cache_line *ump_next_msg(struct ump_chan *chan)
+{
+    size_t nslots = chan->size / sizeof(struct cache_line);
+    volatile struct cache_line *first = ump_slot(chan, chan->tail);
+
+    if (first->seq != (uint32_t)(chan->tail + 1)) {
+        // running dry, let the producer know about everything freed so far
+        ump_publish_acks(chan);
+        return NULL;
     }
+    dmb();
 
+    size_t total_frags = first->total_frags;
+    if (total_frags == 0 || total_frags > nslots) {
+        return NULL;
+    }
+    volatile struct cache_line *last = ump_slot(chan, chan->tail + total_frags - 1);
+    if (last->seq != (uint32_t)(chan->tail + total_frags)) {
+        ump_publish_acks(chan);
+        return NULL;
+    }
     dmb();
 
+    return (struct cache_line *)first;
+}
+
+// copy out the next message, at most one struct ump_payload
+static void ump_copy_msg(struct ump_chan *chan, struct cache_line *cl, void *buf)
+{
+    for (size_t frag_num = 0; frag_num < cl->total_frags; frag_num++) {
+        size_t off = frag_num * UMP_FRAG_SIZE;
+        if (off >= sizeof(struct ump_payload)) {
+            break;
+        }
+        memcpy((char *)buf + off, ump_slot(chan, chan->tail + frag_num)->payload,
+               MIN(UMP_FRAG_SIZE, sizeof(struct ump_payload) - off));
+    }
+}
+
+// copy out the received message and dequeue it
+static void ump_dequeue(struct ump_chan *chan, struct cache_line *cl, void *buf)
+{
+    size_t total_frags = cl->total_frags;
+    ump_copy_msg(chan, cl, buf);
+    chan->tail += total_frags;
+    if (chan->tail - chan->acked >= UMP_ACK_BATCH) {
+        ump_publish_acks(chan);
+    }
+}
+
+errval_t ump_receive(struct ump_chan *chan, enum msg_type type, void *buf) {
+    struct cache_line *cl = ump_next_msg(chan);
+    if (cl == NULL) {
+        return LIB_ERR_NO_UMP_MSG;
+    }
+
+    // if the next msg type is not the type we're looking for, return
     if (((struct ump_payload *)cl->payload)->type != type) {
         // need to wait for another message to be dequeued first
+        ump_publish_acks(chan);
         return LIB_ERR_UMP_CHAN_RECV;
     }
 
-    // copy out the received message and dequeue
-    for (int frag_num = cl->frag_num; frag_num < cl->total_frags; frag_num++) {
-        memcpy(buf + (58 * cl->frag_num), cl->payload, cl->frag_num == cl->total_frags - 1 ? sizeof(struct ump_payload) % 58 : 58);
-
-        // invalidate this cache line
-        cl->valid = 0;
-        dmb();
-
-        // advance to the next cache line
-        cl++;
+    ump_dequeue(chan, cl, buf);
+    return SYS_ERR_OK;
+}
 
-        // move up tail
-        chan->tail = (chan->tail + sizeof(struct cache_line)) % chan->size;
+errval_t ump_peek(struct ump_chan *chan, void *buf) {
+    struct cache_line *cl = ump_next_msg(chan);
+    if (cl == NULL) {
+        return LIB_ERR_NO_UMP_MSG;
     }
 
+    ump_copy_msg(chan, cl, buf);
     return SYS_ERR_OK;
 }
 
-static void send_num_handler(void *arg)
-{
-    // debug_printf("got into send num handler\n");
-    
-    errval_t err;
-    struct aos_rpc_num_payload *payload = (struct aos_rpc_num_payload *) arg;
-    struct aos_rpc *rpc = payload->rpc;
-    struct lmp_chan *lc = rpc->lmp_chan;
-    uintptr_t num = payload->val;
+/*
+ * Every block in the data area starts with this header. Blocks are allocated in order, a
+ * block that would wrap around is preceded by a padding block up to the end of the area.
+ */
+struct ump_data_hdr {
+    uint32_t          size;      // of the whole block including this header
+    volatile uint32_t released;  // set by the consumer once it is done with the data
+};
 
+#define UMP_DATA_ALIGN sizeof(struct ump_data_hdr)
 
-    err = lmp_chan_send2(lc, 0, NULL_CAP, NUM_MSG, num);
-    while (lmp_err_is_transient(err)) {
-        err = lmp_chan_send2(lc, 0, NULL_CAP, NUM_MSG, num);
-    }
-    if (err_is_fail(err)) {
-        DEBUG_ERR(err, "sending num in handler\n");
-        abort();
+static inline struct ump_data_hdr *ump_data_hdr(struct ump_chan *chan, size_t pos)
+{
+    return (struct ump_data_hdr *)((genvaddr_t)chan + chan->data_base + pos % chan->data_size);
+}
+
+errval_t ump_send_data(struct ump_chan *chan, struct ump_payload *msg, const void *data,
+                       size_t len) {
+    size_t need = ROUND_UP(sizeof(struct ump_data_hdr) + len, UMP_DATA_ALIGN);
+    if (len == 0 || len > UINT32_MAX || need > chan->data_size) {
+        return LIB_ERR_UMP_BUFSIZE_INVALID;
     }
 
-    // debug_printf("number sent!\n");
-}
+    // the descriptors have to go out in the order the data was allocated in
+    thread_mutex_lock_nested(&chan->send_mutex);
 
-static void send_string_handler(void *arg)
-{
-    // debug_printf("got into send string handler\n");
-    
-    errval_t err;
+    // keep the block in one piece, skipping what is left until the end of the area
+    size_t off = chan->data_head % chan->data_size;
+    size_t pad = off + need > chan->data_size ? chan->data_size - off : 0;
 
-    // unpack the provided string and length
-    struct aos_rpc_string_payload *payload = (struct aos_rpc_string_payload *) arg;
-    struct aos_rpc *rpc = payload->rpc;
-    struct capref frame = payload->frame;
-    size_t len = payload->len;
-    struct lmp_chan *lc = rpc->lmp_chan;
-    // debug_printf("printing frame:\n");
-    // debug_print_cap_at_capref(frame);
+    while (chan->data_head + pad + need - chan->data_acked_cache > chan->data_size) {
+        chan->data_acked_cache = chan->data_acked;
+        dmb();
+        if (chan->data_head + pad + need - chan->data_acked_cache > chan->data_size) {
+            thread_yield();
+        }
+    }
 
-    err = lmp_chan_send2(lc, 0, frame, STRING_MSG, len);
-    if (err_is_fail(err)) {
-        DEBUG_ERR(err, "sending string in handler\n");
-        abort();
+    if (pad > 0) {
+        struct ump_data_hdr *hdr = ump_data_hdr(chan, chan->data_head);
+        hdr->size = pad;
+        hdr->released = 1;
+        chan->data_head += pad;
     }
 
-    // debug_printf("string sent!\n");
-}
+    struct ump_data_hdr *hdr = ump_data_hdr(chan, chan->data_head);
+    hdr->size = need;
+    hdr->released = 0;
+    memcpy(hdr + 1, data, len);
 
-static void send_get_name_handler(void *arg)
-{
-    // debug_printf("got into send string handler\n");
-    
-    errval_t err;
+    msg->data_pos = chan->data_head;
+    msg->data_len = len;
+    chan->data_head += need;
 
-    // unpack the provided string and length
-    struct aos_rpc_string_payload *payload = (struct aos_rpc_string_payload *) arg;
-    struct aos_rpc *rpc = payload->rpc;
-    struct capref frame = payload->frame;
-    size_t len = payload->len;
-    struct lmp_chan *lc = rpc->lmp_chan;
-    // debug_printf("printing frame:\n");
-    // debug_print_cap_at_capref(frame);
+    // the data is made visible together with the descriptor
+    errval_t err = ump_send(chan, (char *)msg, sizeof(*msg));
+    thread_mutex_unlock(&chan->send_mutex);
+    return err;
+}
 
-    err = lmp_chan_send2(lc, 0, frame, NAME_MSG, len);
-    if (err_is_fail(err)) {
-        DEBUG_ERR(err, "sending name request in handler\n");
-        abort();
+void *ump_msg_data(struct ump_chan *chan, struct ump_payload *msg) {
+    if (msg->data_len == 0 || chan->data_size == 0) {
+        return NULL;
     }
-
-    // debug_printf("string sent!\n");
+    return ump_data_hdr(chan, msg->data_pos) + 1;
 }
 
-static void send_getchar_handler(void *arg)
-{
-    // debug_printf("got into send char handler\n");
-    
-    errval_t err;
-    struct aos_rpc *rpc = arg;
-    struct lmp_chan *lc = rpc->lmp_chan;
+void ump_msg_release(struct ump_chan *chan, struct ump_payload *msg) {
+    if (msg->data_len == 0 || chan->data_size == 0) {
+        return;
+    }
 
-    err = lmp_chan_send1(lc, 0, NULL_CAP, GETCHAR);
-    while (err_is_fail(err)) {
-        DEBUG_ERR(err, "sending getchar in handler\n");
-        abort();
+    thread_mutex_lock(&chan->release_mutex);
+    struct ump_data_hdr *hdr = ump_data_hdr(chan, msg->data_pos);
+    hdr->released = 1;
+    if (msg->data_pos + hdr->size > chan->data_seen) {
+        chan->data_seen = msg->data_pos + hdr->size;
     }
 
-    // debug_printf("char sent!\n");
+    // data may be released out of order, only the blocks up to the first one still in use
+    // can be handed back
+    size_t freed = chan->data_acked;
+    while (freed < chan->data_seen) {
+        hdr = ump_data_hdr(chan, freed);
+        if (!hdr->released) {
+            break;
+        }
+        freed += hdr->size;
+    }
+    if (freed != chan->data_acked) {
+        dmb();
+        chan->data_acked = freed;
+    }
+    thread_mutex_unlock(&chan->release_mutex);
 }
 
-static void send_putchar_handler(void *arg) {
-    // debug_printf("got into send putchar handler\n");
-    
-    errval_t err;
-    struct aos_rpc_num_payload *payload = (struct aos_rpc_num_payload *) arg;
-    struct aos_rpc *rpc = payload->rpc;
-    struct lmp_chan *lc = rpc->lmp_chan;
-    uintptr_t c = payload->val;
+void ump_demux_init(struct ump_demux *dm, struct ump_chan *chan)
+{
+    memset(dm, 0, sizeof(*dm));
+    dm->chan = chan;
+    thread_mutex_init(&dm->mutex);
+    thread_mutex_init(&dm->call_mutex);
+}
 
-    err = lmp_chan_send2(lc, 0, NULL_CAP, PUTCHAR, c);
-    while (err_is_fail(err)) {
-        DEBUG_ERR(err, "sending putchar in handler\n");
-        abort();
+void ump_demux_register(struct ump_demux *dm, enum msg_type type, ump_handler_fn fn, void *arg)
+{
+    assert(type < MSG_TYPE_COUNT);
+    thread_mutex_lock(&dm->mutex);
+    dm->handlers[type] = fn;
+    dm->handler_args[type] = arg;
+    thread_mutex_unlock(&dm->mutex);
+}
+
+// append a node to the queue of its message type, called with the mutex held
+static void ump_demux_enqueue(struct ump_demux *dm, struct ump_msg_node *node)
+{
+    struct ump_msg_queue *q = &dm->queues[node->msg.type];
+    node->next = NULL;
+    if (q->tail == NULL) {
+        q->head = node;
+    } else {
+        q->tail->next = node;
     }
+    q->tail = node;
 }
 
-static void send_spawn_with_caps_handler(void * arg) {
-    // debug_printf("got into spawn with caps request send handler\n");
-    
-    errval_t err;
+errval_t ump_demux_poll(struct ump_demux *dm)
+{
+    thread_mutex_lock(&dm->mutex);
+    while (true) {
+        struct cache_line *cl = ump_next_msg(dm->chan);
+        if (cl == NULL) {
+            break;
+        }
 
-    // unpack the provided string and length
-    struct aos_rpc_string_payload *payload = (struct aos_rpc_string_payload *) arg;
-    struct aos_rpc *rpc = payload->rpc;
-    struct capref frame = payload->frame;
-    size_t len = payload->len;
-    struct lmp_chan *lc = rpc->lmp_chan;
+        struct ump_msg_node *node = dm->free;
+        if (node != NULL) {
+            dm->free = node->next;
+        } else {
+            node = malloc(sizeof(*node));
+            if (node == NULL) {
+                // the message stays on the channel until we have room for it
+                thread_mutex_unlock(&dm->mutex);
+                return LIB_ERR_MALLOC_FAIL;
+            }
+        }
+        ump_dequeue(dm->chan, cl, &node->msg);
+
+        enum msg_type type = node->msg.type;
+        if (type >= MSG_TYPE_COUNT) {
+            debug_printf("dropping UMP message of unknown type %d\n", type);
+            node->next = dm->free;
+            dm->free = node;
+            continue;
+        }
 
-    err = lmp_chan_send2(lc, 0, frame, SPAWN_WITH_CAPS_MSG, len);
-    while (err_is_fail(err)) {
-        DEBUG_ERR(err, "sending spawn with caps request in handler\n");
-        abort();
+        ump_handler_fn fn = dm->handlers[type];
+        if (fn != NULL) {
+            // handlers may block on this channel themselves, so don't hold the lock
+            thread_mutex_unlock(&dm->mutex);
+            bool handled = fn(&node->msg, dm->handler_args[type]);
+            thread_mutex_lock(&dm->mutex);
+            if (handled) {
+                node->next = dm->free;
+                dm->free = node;
+                continue;
+            }
+        }
+        ump_demux_enqueue(dm, node);
     }
+    thread_mutex_unlock(&dm->mutex);
 
-    // debug_printf("spawn with caps request sent!\n");
+    return SYS_ERR_OK;
 }
 
-static void send_cmdline_handler(void* arg) {
-    // debug_printf("got into send cmdline handler\n");
-    
-    errval_t err;
+errval_t ump_demux_recv(struct ump_demux *dm, enum msg_type type, struct ump_payload *msg)
+{
+    assert(type < MSG_TYPE_COUNT);
 
-    // unpack the provided string and length
-    struct aos_rpc_cmdline_payload *payload = (struct aos_rpc_cmdline_payload *) arg;
-    struct aos_rpc *rpc = payload->rpc;
-    struct capref frame = payload->frame;
-    size_t len = payload->len;
-    struct lmp_chan *lc = rpc->lmp_chan;
+    errval_t err = ump_demux_poll(dm);
+    if (err_is_fail(err)) {
+        return err;
+    }
 
-    err = lmp_chan_send3(lc, 0, frame, SPAWN_CMDLINE, len, payload->core);
-    while (err_is_fail(err)) {
-        DEBUG_ERR(err, "sending cmdline in handler\n");
-        abort();
+    thread_mutex_lock(&dm->mutex);
+    struct ump_msg_queue *q = &dm->queues[type];
+    struct ump_msg_node *node = q->head;
+    if (node == NULL) {
+        thread_mutex_unlock(&dm->mutex);
+        return LIB_ERR_NO_UMP_MSG;
     }
+    q->head = node->next;
+    if (q->head == NULL) {
+        q->tail = NULL;
+    }
+    *msg = node->msg;
+    node->next = dm->free;
+    dm->free = node;
+    thread_mutex_unlock(&dm->mutex);
 
-    // debug_printf("cmdline sent!\n");
+    return SYS_ERR_OK;
 }
 
-static void send_ram_cap_req_handler(void* arg) {
-    // debug_printf("got into send ram cap req handler\n");
-    
+errval_t ump_demux_wait(struct ump_demux *dm, enum msg_type type, struct ump_payload *msg)
+{
     errval_t err;
 
-    struct aos_rpc_ram_cap_req_payload *payload = (struct aos_rpc_ram_cap_req_payload *) arg;
-    struct aos_rpc *rpc = payload->rpc;
-    struct lmp_chan *lc = rpc->lmp_chan;
-
-    err = lmp_chan_send3(lc, 0, NULL_CAP, GET_RAM_CAP, payload->bytes, payload->alignment);
-    while (err_is_fail(err)) {
-        DEBUG_ERR(err, "sending ram cap req in handler\n");
-        abort();
+    // replies usually come quickly, don't give up the core for them right away
+    for (int i = 0; i < UMP_POLL_SPIN; i++) {
+        err = ump_demux_recv(dm, type, msg);
+        if (err != LIB_ERR_NO_UMP_MSG) {
+            return err;
+        }
     }
 
-    // debug_printf("ram cap request sent!\n");
+    // requests from other cores are handled in the meantime, they may be waiting on us as well
+    while ((err = ump_demux_recv(dm, type, msg)) == LIB_ERR_NO_UMP_MSG) {
+        err = ump_demux_poll_peers();
+        if (err_is_fail(err)) {
+            return err;
+        }
+        thread_yield();
+    }
+    return err;
 }
 
-static void send_get_all_pids_handler(void* arg) {
-    // debug_printf("got into send get all pids handler\n");
-    
-    errval_t err;
-
-    // unpack the provided string and length
-    struct aos_rpc_string_payload *payload = (struct aos_rpc_string_payload *) arg;
-    struct aos_rpc *rpc = payload->rpc;
-    struct capref frame = payload->frame;
-    size_t len = payload->len;
-    struct lmp_chan *lc = rpc->lmp_chan;
-    // debug_printf("printing frame:\n");
-    // debug_print_cap_at_capref(frame);
+bool ump_demux_poll_disabled(struct waitset_chanstate *chan)
+{
+    struct ump_demux *dm = (struct ump_demux *)((char *)chan
+                                                - offsetof(struct ump_demux, waitset_state));
+    if (dm->skip > 0) {
+        dm->skip--;
+        return false;
+    }
 
-    err = lmp_chan_send2(lc, 0, frame, GET_ALL_PIDS, len);
-    while (err_is_fail(err)) {
-        DEBUG_ERR(err, "sending get all pids request in handler\n");
-        abort();
+    // only look at the next slot, the handler does the rest
+    struct ump_chan *uc = dm->chan;
+    volatile struct cache_line *cl = ump_slot(uc, uc->tail);
+    if (cl->seq == (uint32_t)(uc->tail + 1)) {
+        dm->empty_polls = 0;
+        return true;
     }
 
-    // debug_printf("get_all_pids request sent!\n");
+    dm->empty_polls++;
+    if (dm->empty_polls >= UMP_POLL_PARK) {
+        // let the handler take the channel off the polled list
+        dm->parked = true;
+        return true;
+    }
+    if (dm->empty_polls > UMP_POLL_SPIN) {
+        dm->skip = MIN(dm->empty_polls - UMP_POLL_SPIN, UMP_POLL_MAX_SKIP);
+    }
+    return false;
 }
 
-static void send_get_elf_mod_names_handler(void* arg) {
-    // debug_printf("got into send get elf mod names handler\n");
-    
-    errval_t err;
-
-    // unpack the provided string and length
-    struct aos_rpc_string_payload *payload = (struct aos_rpc_string_payload *) arg;
-    struct aos_rpc *rpc = payload->rpc;
-    struct capref frame = payload->frame;
-    size_t len = payload->len;
-    struct lmp_chan *lc = rpc->lmp_chan;
-    // debug_printf("printing frame:\n");
-    // debug_print_cap_at_capref(frame);
+static void ump_demux_event(void *arg);
 
-    err = lmp_chan_send2(lc, 0, frame, GET_MOD_NAMES, len);
-    while (err_is_fail(err)) {
-        DEBUG_ERR(err, "sending get elf mod names request in handler\n");
-        abort();
-    }
+/// whether senders notify receivers on this core that stopped polling
+static bool ump_notify_enabled;
 
-    // debug_printf("get_elf_mod_names request sent!\n");
+// go back to polling the channel on every dispatch
+static void ump_demux_unpark(void *arg)
+{
+    struct ump_demux *dm = arg;
+    dm->asleep = false;
+    dm->chan->sleeping = 0;
+    dm->empty_polls = 0;
+    dm->skip = 0;
+    ump_demux_event(dm);
 }
 
-static void send_get_pid_handler(void *arg) {
-    // debug_printf("got into send get pid handler\n");
-    
+static void ump_demux_event(void *arg)
+{
+    struct ump_demux *dm = arg;
     errval_t err;
 
-    // unpack the provided string and length
-    struct aos_rpc_string_payload *payload = (struct aos_rpc_string_payload *) arg;
-    struct aos_rpc *rpc = payload->rpc;
-    struct capref frame = payload->frame;
-    size_t len = payload->len;
-    struct lmp_chan *lc = rpc->lmp_chan;
-    // debug_printf("printing frame:\n");
-    // debug_print_cap_at_capref(frame);
+    if (dm->parked) {
+        // nothing for a long time, check back on a timer instead
+        dm->parked = false;
+        delayus_t delay = UMP_POLL_PARK_US;
+        if (ump_notify_enabled) {
+            // and have the sender tell us, unless it has already sent something meanwhile
+            dm->chan->sleeping = disp_get_core_id() + 1;
+            dmb();
+            delay = UMP_POLL_PARK_NOTIFY_US;
+        }
+        if (ump_next_msg(dm->chan) != NULL) {
+            dm->chan->sleeping = 0;
+        } else {
+            err = deferred_event_register(&dm->park_timer, dm->ws, delay,
+                                          MKCLOSURE(ump_demux_unpark, dm));
+            if (err_is_fail(err)) {
+                DEBUG_ERR(err, "parking UMP channel");
+                dm->chan->sleeping = 0;
+            } else {
+                dm->asleep = true;
+                return;
+            }
+        }
+    }
 
-    err = lmp_chan_send2(lc, 0, frame, GET_PID, len);
-    while (err_is_fail(err)) {
-        DEBUG_ERR(err, "sending get pid request in handler\n");
-        abort();
+    err = waitset_chan_register_polled(dm->ws, &dm->waitset_state,
+                                       MKCLOSURE(ump_demux_event, dm));
+    if (err_is_fail(err)) {
+        DEBUG_ERR(err, "re-registering UMP channel");
     }
 
-    // debug_printf("get pid request sent!\n");
+    err = ump_demux_poll(dm);
+    if (err_is_fail(err)) {
+        DEBUG_ERR(err, "polling UMP channel");
+    }
 }
 
-static void send_exit_handler(void * arg) {
-    // debug_printf("got into send exit handler\n");
-    
-    errval_t err;
+errval_t ump_demux_register_waitset(struct ump_demux *dm, struct waitset *ws)
+{
+    waitset_chanstate_init(&dm->waitset_state, CHANTYPE_UMP_IN);
+    deferred_event_init(&dm->park_timer);
+    dm->ws = ws;
+    dm->empty_polls = 0;
+    dm->skip = 0;
+    dm->parked = false;
+
+    return waitset_chan_register_polled(ws, &dm->waitset_state, MKCLOSURE(ump_demux_event, dm));
+}
 
-    // unpack the provided string and length
-    struct aos_rpc_string_payload *payload = (struct aos_rpc_string_payload *) arg;
-    struct aos_rpc *rpc = payload->rpc;
-    struct capref frame = payload->frame;
-    size_t len = payload->len;
-    struct lmp_chan *lc = rpc->lmp_chan;
-    // debug_printf("printing frame:\n");
-    // debug_print_cap_at_capref(frame);
+static struct ump_demux ump_demux_peer[UMP_MAX_CORES];
 
-    err = lmp_chan_send2(lc, 0, frame, EXIT_MSG, len);
-    while (err_is_fail(err)) {
-        DEBUG_ERR(err, "sending exit request in handler\n");
-        abort();
-    }
+// another core posted a message to one of our channels while we were not polling it
+static void ump_notify_handler(void *arg)
+{
+    (void)arg;
 
-    // debug_printf("exit request sent!\n");
+    for (coreid_t core = 0; core < UMP_MAX_CORES; core++) {
+        struct ump_demux *dm = &ump_demux_peer[core];
+        if (dm->chan == NULL || !dm->asleep) {
+            continue;
+        }
+        errval_t err = deferred_event_cancel(&dm->park_timer);
+        if (err_is_fail(err)) {
+            // the timer has just fired and will wake it up
+            continue;
+        }
+        ump_demux_unpark(dm);
+    }
 }
 
-static void send_wait_handler(void *arg) {
-    // debug_printf("got into send wait handler\n");
-    
+errval_t ump_notify_init(struct waitset *ws)
+{
     errval_t err;
 
-    // unpack the provided string and length
-    struct aos_rpc_string_payload *payload = (struct aos_rpc_string_payload *) arg;
-    struct aos_rpc *rpc = payload->rpc;
-    struct capref frame = payload->frame;
-    size_t len = payload->len;
-    struct lmp_chan *lc = rpc->lmp_chan;
-    // debug_printf("printing frame:\n");
-    // debug_print_cap_at_capref(frame);
+    struct capref dest;
+    err = inthandler_alloc_dest_irq_cap(IPI_NOTIFY_SGI, &dest);
+    if (err_is_fail(err)) {
+        return err;
+    }
+    err = inthandler_setup(dest, ws, MKCLOSURE(ump_notify_handler, NULL));
+    if (err_is_fail(err)) {
+        return err;
+    }
+
+    ump_notify_enabled = true;
+    return SYS_ERR_OK;
+}
 
-    err = lmp_chan_send2(lc, 0, frame, WAIT_MSG, len);
-    while (err_is_fail(err)) {
-        DEBUG_ERR(err, "sending wait request in handler\n");
-        abort();
+// the demultiplexer of the channel returned by get_ump_chan_peer(core, 1)
+struct ump_demux *get_ump_demux_peer(coreid_t core) {
+    assert(core < UMP_MAX_CORES && core != disp_get_core_id());
+    struct ump_demux *dm = &ump_demux_peer[core];
+    if (dm->chan == NULL) {
+        // set up on first use, which may happen on several threads at once
+        static struct thread_mutex init_mutex = THREAD_MUTEX_INITIALIZER;
+        thread_mutex_lock(&init_mutex);
+        if (dm->chan == NULL) {
+            ump_demux_init(dm, get_ump_chan_peer(core, 1));
+        }
+        thread_mutex_unlock(&init_mutex);
     }
+    return dm;
+}
 
-    // debug_printf("wait request sent!\n");
+// drain the channels from all connected cores
+errval_t ump_demux_poll_peers(void) {
+    for (coreid_t core = 0; core < UMP_MAX_CORES; core++) {
+        if (!ump_peer_connected(core)) {
+            continue;
+        }
+        errval_t err = ump_demux_poll(get_ump_demux_peer(core));
+        if (err_is_fail(err)) {
+            return err;
+        }
+    }
+    return SYS_ERR_OK;
 }
 
 /**
@@ -522,21 +1645,14 @@ static void send_wait_handler(void *arg) {
  */
 errval_t aos_rpc_send_number(struct aos_rpc *rpc, uintptr_t num)
 {
-    struct lmp_chan *lc = rpc->lmp_chan;
+    struct aos_rpc_call call;
     errval_t err;
 
-    // marshall args into num payload
-    struct aos_rpc_num_payload *payload = malloc(sizeof(struct aos_rpc_num_payload));
-    payload->rpc = rpc;
-    payload->val = num;
-    err = lmp_chan_register_send(lc, get_default_waitset(), MKCLOSURE(send_num_handler, (void *) payload));
-    DEBUG_ERR_ON_FAIL(err, "lmp_chan_send1");
-    
-    // debug_printf("made it to the end of number sending\n");
-    event_dispatch(get_default_waitset());
-    event_dispatch(get_default_waitset());
-    
-    free(payload);
+    err = aos_rpc_call(rpc, NUM_MSG, NULL_CAP, num, 0, &call);
+    if (err_is_fail(err)) {
+        DEBUG_ERR(err, "sending number");
+        return err;
+    }
 
     return SYS_ERR_OK;
 }
@@ -554,43 +1670,28 @@ errval_t aos_rpc_send_number(struct aos_rpc *rpc, uintptr_t num)
  */
 errval_t aos_rpc_send_string(struct aos_rpc *rpc, const char *string)
 {
+    struct aos_rpc_call call;
     errval_t err;
-    
-    // make compiler happy about unused parameters
-    (void)rpc;
-    (void)string;
+    size_t len = strlen(string);
 
-    // debug_printf("sending string\n");
-    struct lmp_chan *lc = rpc->lmp_chan;
+    if (len <= AOS_RPC_INLINE_MAX) {
+        err = aos_rpc_call_inline(rpc, STRING_MSG, 0, string, len, &call);
+        if (err_is_fail(err)) {
+            DEBUG_ERR(err, "sending string");
+            return err;
+        }
+        return SYS_ERR_OK;
+    }
 
-    // allocate and map a frame, copying to it the string contents
-    struct capref frame;
-    void *buf;
-    int len = strlen(string);
-    err = frame_alloc(&frame, len, NULL);
-    DEBUG_ERR_ON_FAIL(err, "couldn't allocate frame for string\n");
-    err = paging_map_frame_attr(get_current_paging_state(), &buf, len, frame, VREGION_FLAGS_READ_WRITE);
-    strcpy(buf, string);
-
-    // pass the string frame and length in the payload
-    struct aos_rpc_string_payload *payload = malloc(sizeof(struct aos_rpc_string_payload));
-    payload->rpc = rpc;
-    // debug_print_cap_at_capref(frame);
-    //err = cap_copy(payload->frame, frame);
-    payload->frame = frame;
-    // debug_print_cap_at_capref(payload->frame);
-    payload->len = len;
-
-    // send the frame and the length on the channel
-    err = lmp_chan_alloc_recv_slot(lc);
-    DEBUG_ERR_ON_FAIL(err, "lmp_chan_alloc_recv_slot");
-    err = lmp_chan_register_send(lc, get_default_waitset(), MKCLOSURE(send_string_handler, (void *)payload));
-    DEBUG_ERR_ON_FAIL(err, "lmp_chan_send1");
-    event_dispatch(get_default_waitset());
-    event_dispatch(get_default_waitset());
-    // check for an ack
-   
-    free(payload);
+    // too long to go inline, pass it through the bulk frame
+    if (len + 1 > AOS_RPC_BULK_SIZE) {
+        return LIB_ERR_STRING_TOO_LONG;
+    }
+    err = aos_rpc_call_bulk(rpc, STRING_MSG, NULL_CAP, 0, string, len + 1, NULL, 0, &call);
+    if (err_is_fail(err)) {
+        DEBUG_ERR(err, "sending string");
+        return err;
+    }
 
     return SYS_ERR_OK;
 }
@@ -619,38 +1720,81 @@ errval_t aos_rpc_send_string(struct aos_rpc *rpc, const char *string)
 errval_t aos_rpc_get_ram_cap(struct aos_rpc *rpc, size_t bytes, size_t alignment,
                              struct capref *ret_cap, size_t *ret_bytes)
 {
-    // debug_printf("made it in to download ram api\n");
-    // debug_printf("here is the size we are trying to request: %d\n", bytes);
-
-    struct lmp_chan *lc = rpc->lmp_chan;
+    struct aos_rpc_call call;
     errval_t err;
-    
-    // marshall args into num payload
-    struct aos_rpc_ram_cap_req_payload payload;
-    payload.rpc = rpc;
-    payload.bytes = bytes;
-    payload.alignment = alignment;
-
-    err = lmp_chan_register_send(lc, get_default_waitset(), MKCLOSURE(send_ram_cap_req_handler, 
-                                 (void *) &payload));
-    DEBUG_ERR_ON_FAIL(err, "lmp_chan_send1");
-    
-    // debug_printf("made it to the end of ram cap request sending\n");
-    event_dispatch(get_default_waitset());
-    event_dispatch(get_default_waitset());
-
-    if (capref_is_null(global_retcap)) {
+
+    err = aos_rpc_call(rpc, GET_RAM_CAP, NULL_CAP, bytes, alignment, &call);
+    if (err_is_fail(err)) {
+        return err;
+    }
+
+    if (capref_is_null(call.cap)) {
         debug_printf("downloading ram failed\n");
         return LIB_ERR_RAM_ALLOC;
     }
 
-    *ret_cap = global_retcap;
-    *ret_bytes = global_retbytes;
+    *ret_cap = call.cap;
+    *ret_bytes = call.val;
     return SYS_ERR_OK;
 }
 
 
 
+/**
+ * @brief Start a request for a RAM capability with >= bytes of size
+ *
+ * @param[in]  chan       the RPC channel to use (memory channel)
+ * @param[in]  bytes      minimum number of bytes to request
+ * @param[in]  alignment  minimum alignment of the requested RAM capability
+ * @param[in]  ws         waitset to run closure on once the reply has arrived, or NULL
+ * @param[in]  cl         completion closure, ignored if ws is NULL
+ * @param[out] call       handle of the request
+ *
+ * @returns SYS_ERR_OK on success, or error value on failure
+ *
+ * Channel: memory
+ */
+errval_t aos_rpc_get_ram_cap_async(struct aos_rpc *rpc, size_t bytes, size_t alignment,
+                                   struct waitset *ws, struct event_closure cl,
+                                   struct aos_rpc_call *call)
+{
+    return aos_rpc_call_async(rpc, GET_RAM_CAP, NULL_CAP, bytes, alignment, ws, cl, call);
+}
+
+
+/**
+ * @brief Request a frame capability whose memory is already zeroed
+ *
+ * @param[in]  chan       the RPC channel to use (memory channel)
+ * @param[in]  bytes      minimum number of bytes to request
+ * @param[out] retcap     received frame capability
+ * @param[out] ret_bytes  size of the received frame in bytes
+ *
+ * @returns SYS_ERR_OK on success, or error value on failure
+ *
+ * Channel: memory
+ */
+errval_t aos_rpc_get_zeroed_frame(struct aos_rpc *rpc, size_t bytes, struct capref *ret_cap,
+                                  size_t *ret_bytes)
+{
+    struct aos_rpc_call call;
+    errval_t err;
+
+    err = aos_rpc_call(rpc, GET_ZEROED_FRAME, NULL_CAP, bytes, 0, &call);
+    if (err_is_fail(err)) {
+        return err;
+    }
+
+    if (capref_is_null(call.cap)) {
+        return LIB_ERR_RAM_ALLOC;
+    }
+
+    *ret_cap = call.cap;
+    *ret_bytes = call.val;
+    return SYS_ERR_OK;
+}
+
+
 /*
  * ===============================================================================================
  * Serial RPCs
@@ -668,17 +1812,16 @@ errval_t aos_rpc_get_ram_cap(struct aos_rpc *rpc, size_t bytes, size_t alignment
  */
 errval_t aos_rpc_serial_getchar(struct aos_rpc *rpc, char *retc)
 {
-    // TODO implement functionality to request a character from
-    // the serial driver.
-    struct lmp_chan *lc = rpc->lmp_chan;
+    struct aos_rpc_call call;
     errval_t err;
 
-    err = lmp_chan_register_send(lc, get_default_waitset(), MKCLOSURE(send_getchar_handler, (void *) rpc));
-    DEBUG_ERR_ON_FAIL(err, "lmp_chan_send1");
-    event_dispatch(get_default_waitset());
-    event_dispatch(get_default_waitset());
-    *retc = global_retchar;
+    err = aos_rpc_call(rpc, GETCHAR, NULL_CAP, 0, 0, &call);
+    if (err_is_fail(err)) {
+        DEBUG_ERR(err, "requesting char");
+        return err;
+    }
 
+    *retc = call.val;
     return SYS_ERR_OK;
 }
 
@@ -694,23 +1837,49 @@ errval_t aos_rpc_serial_getchar(struct aos_rpc *rpc, char *retc)
  */
 errval_t aos_rpc_serial_putchar(struct aos_rpc *rpc, char c)
 {
-    // make compiler happy about unused parameters
-    (void)rpc;
-    (void)c;
-    // TODO: implement functionality to send a number over the channel
-    // given channel and wait until the ack gets returned.
-    struct lmp_chan *lc = rpc->lmp_chan;
+    struct aos_rpc_call call;
+    errval_t err;
+
+    err = aos_rpc_call(rpc, PUTCHAR, NULL_CAP, c, 0, &call);
+    if (err_is_fail(err)) {
+        DEBUG_ERR(err, "sending char");
+        return err;
+    }
+
+    return SYS_ERR_OK;
+}
+
+
+/**
+ * @brief sends a string of characters to the serial
+ *
+ * @param chan  the RPC channel to use (serial channel)
+ * @param buf   the characters to send, need not be NUL-terminated
+ * @param len   number of characters to send
+ *
+ * @return SYS_ERR_OK on success, or error value on failure
+ */
+errval_t aos_rpc_serial_putstring(struct aos_rpc *rpc, const char *buf, size_t len)
+{
+    struct aos_rpc_call call;
     errval_t err;
-    // marshall args into num payload
-    struct aos_rpc_num_payload payload;
-    payload.rpc = rpc;
-    payload.val = c;
-    err = lmp_chan_register_send(lc, get_default_waitset(), MKCLOSURE(send_putchar_handler, (void *)&payload));
-    DEBUG_ERR_ON_FAIL(err, "lmp_chan_send1");
-    
-    // debug_printf("made it to the end of putchar sending\n");
-    event_dispatch(get_default_waitset());
-    event_dispatch(get_default_waitset());
+
+    while (len > 0) {
+        size_t chunk;
+        if (len <= AOS_RPC_INLINE_MAX || rpc->bulk_req == NULL) {
+            chunk = MIN(len, AOS_RPC_INLINE_MAX);
+            err = aos_rpc_call_inline(rpc, PUTSTRING, 0, buf, chunk, &call);
+        } else {
+            chunk = MIN(len, AOS_RPC_BULK_SIZE);
+            err = aos_rpc_call_bulk(rpc, PUTSTRING, NULL_CAP, 0, buf, chunk, NULL, 0, &call);
+        }
+        if (err_is_fail(err)) {
+            DEBUG_ERR(err, "sending string to serial");
+            return err;
+        }
+        buf += chunk;
+        len -= chunk;
+    }
 
     return SYS_ERR_OK;
 }
@@ -742,53 +1911,34 @@ errval_t aos_rpc_serial_putchar(struct aos_rpc *rpc, char c)
 errval_t aos_rpc_proc_spawn_with_caps(struct aos_rpc *rpc, int argc, const char *argv[], int capc,
                                       struct capref cap, coreid_t core, domainid_t *newpid)
 {
-    // make compiler happy about unused parameters
-    (void)rpc;
-    (void)argc;
-    (void)argv;
-    (void)capc;
-    (void)cap;
-    (void)core;
-    (void)newpid;
-
-    for (int i = 0; i < argc; i++) {
-        debug_printf("arg %d: %s\n", i, argv[i]);
-    }
-    struct lmp_chan *lc = rpc->lmp_chan;
     errval_t err;
+    char req[AOS_RPC_BULK_SIZE];
 
-    // allocate and map a frame, copying to it the string contents
-    struct capref frame;
-    void *buf;
-    err = frame_alloc(&frame, BASE_PAGE_SIZE, NULL);
-    DEBUG_ERR_ON_FAIL(err, "couldn't allocate frame for string\n");
-    err = paging_map_frame_attr(get_current_paging_state(), &buf, BASE_PAGE_SIZE, frame, VREGION_FLAGS_READ_WRITE);
-    struct spawn_with_caps_frame_input * input = (struct spawn_with_caps_frame_input *) buf;
-    input->argc = argc;
+    // the arguments are packed back to back behind the header
+    struct spawn_with_caps_frame_input *input = (struct spawn_with_caps_frame_input *)req;
+    size_t len = sizeof(*input);
     for (int i = 0; i < argc; i++) {
-        strcpy(input->argv[i], argv[i]);
+        size_t arglen = strlen(argv[i]) + 1;
+        if (len + arglen > sizeof(req)) {
+            return LIB_ERR_STRING_TOO_LONG;
+        }
+        memcpy(req + len, argv[i], arglen);
+        len += arglen;
     }
+    input->argc = argc;
     input->capc = capc;
-    input->cap = cap;
     input->core = core;
-    
-    // pass the string frame and length in the payload
-    struct aos_rpc_string_payload *payload = malloc(sizeof(struct aos_rpc_string_payload));
-    payload->rpc = rpc;
-    payload->frame = frame;
-    payload->len = BASE_PAGE_SIZE;
-
-    // send the frame and the length on the channel
-    err = lmp_chan_alloc_recv_slot(lc);
-    DEBUG_ERR_ON_FAIL(err, "lmp_chan_alloc_recv_slot");
-    err = lmp_chan_register_send(lc, get_default_waitset(), MKCLOSURE(send_spawn_with_caps_handler, (void *)payload));
-    DEBUG_ERR_ON_FAIL(err, "lmp_chan_send1");
-    event_dispatch(get_default_waitset());
-    event_dispatch(get_default_waitset());
-
-    *newpid = input->pid;
-    // printf("pid of the new process: %d\n", input->pid);
-    free(payload);
+
+    // the capability goes with the message, init replies with the pid
+    struct aos_rpc_call call;
+    err = aos_rpc_call_bulk(rpc, SPAWN_WITH_CAPS_MSG, capc > 0 ? cap : NULL_CAP, 0, req, len,
+                            NULL, 0, &call);
+    if (err_is_fail(err)) {
+        DEBUG_ERR(err, "sending spawn with caps request");
+        return err;
+    }
+
+    *newpid = call.val;
     return SYS_ERR_OK;
 }
 
@@ -807,56 +1957,54 @@ errval_t aos_rpc_proc_spawn_with_caps(struct aos_rpc *rpc, int argc, const char
 errval_t aos_rpc_proc_spawn_with_cmdline(struct aos_rpc *rpc, const char *cmdline, coreid_t core,
                                          domainid_t *newpid)
 {
-    // make compiler happy about unused parameters
-    (void)rpc;
-    (void)cmdline;
-    (void)core;
-    (void)newpid;
-
+    struct aos_rpc_call call;
     errval_t err;
+    size_t len = strlen(cmdline);
+
+    if (len <= AOS_RPC_INLINE_MAX) {
+        // the command line goes inline with the core, the reply carries the pid
+        err = aos_rpc_call_inline(rpc, SPAWN_CMDLINE, core, cmdline, len, &call);
+    } else if (len + 1 <= AOS_RPC_BULK_SIZE) {
+        // too long to go inline, pass it through the bulk frame
+        err = aos_rpc_call_bulk(rpc, SPAWN_CMDLINE, NULL_CAP, core, cmdline, len + 1, NULL, 0,
+                                &call);
+    } else {
+        return LIB_ERR_STRING_TOO_LONG;
+    }
+    if (err_is_fail(err)) {
+        DEBUG_ERR(err, "sending cmdline");
+        return err;
+    }
 
-    // debug_printf("entered api for spawn cmdline\n");
-    // debug_printf("here's the cmdline: %s\n", cmdline);
-    struct lmp_chan *lc = rpc->lmp_chan;
+    // debug_printf("here is the pid we recieved: %d\n", call.val);
+    *newpid = call.val;
 
-    // allocate and map a frame, copying to it the string contents
-    struct capref frame;
-    void *buf;
-    int len = strlen(cmdline);
-    // debug_printf("this is the string len: %d\n", len);
-    err = frame_alloc(&frame, BASE_PAGE_SIZE, NULL);
-    DEBUG_ERR_ON_FAIL(err, "couldn't allocate frame for string\n");
-    err = paging_map_frame_attr(get_current_paging_state(), &buf, BASE_PAGE_SIZE, frame, VREGION_FLAGS_READ_WRITE);
-    DEBUG_ERR_ON_FAIL(err, "couldn't map frame for string\n");
-    strcpy(buf, cmdline);
-
-    // pass the string frame and length in the payload
-    struct aos_rpc_cmdline_payload *payload = malloc(sizeof(struct aos_rpc_cmdline_payload));
-    payload->rpc = rpc;
-    payload->frame = frame;
-    payload->len = len;
-    payload->core = core;
-    // debug_printf("here is the initial value of pid: %d\n", global_pid);
-
-    // send the frame and the length on the channel
-    err = lmp_chan_alloc_recv_slot(lc);
-    DEBUG_ERR_ON_FAIL(err, "lmp_chan_alloc_recv_slot");
-    //err = lmp_chan_register_recv(lc, get_default_waitset(), MKCLOSURE(pid_recv_handler,     (void *)payload));
-    err = lmp_chan_register_send(lc, get_default_waitset(), MKCLOSURE(send_cmdline_handler, (void *)payload));
-    DEBUG_ERR_ON_FAIL(err, "lmp_chan_send1");
-    event_dispatch(get_default_waitset());
-    event_dispatch(get_default_waitset());
-    // check for an ack
-    
-    // debug_printf("here is the pid we recieved: %d\n", global_pid);
-    *newpid = global_pid;
-
-    free(payload);
-    
     return SYS_ERR_OK;
 }
 
 
+/**
+ * @brief starts a request to spawn a new process with the supplied commandline
+ *
+ * @param[in]  chan     the RPC channel to use (process channel)
+ * @param[in]  cmdline  command line of the new process, at most AOS_RPC_INLINE_MAX bytes
+ * @param[in]  core     core on which to spawn the new process on
+ * @param[in]  ws       waitset to run closure on once the reply has arrived, or NULL
+ * @param[in]  cl       completion closure, ignored if ws is NULL
+ * @param[out] call     handle of the request, call->val holds the PID on completion
+ *
+ * @return SYS_ERR_OK on success, or error value on failure
+ */
+errval_t aos_rpc_proc_spawn_with_cmdline_async(struct aos_rpc *rpc, const char *cmdline,
+                                               coreid_t core, struct waitset *ws,
+                                               struct event_closure cl,
+                                               struct aos_rpc_call *call)
+{
+    return aos_rpc_call_async_inline(rpc, SPAWN_CMDLINE, core, cmdline, strlen(cmdline), ws, cl,
+                                     call);
+}
+
+
 /**
  * @brief requests a new process to be spawned with the default arguments
  *
@@ -890,42 +2038,27 @@ errval_t aos_rpc_proc_spawn_with_default_args(struct aos_rpc *chan, const char *
  */
 errval_t aos_rpc_proc_get_all_pids(struct aos_rpc *rpc, domainid_t **pids, size_t *pid_count)
 {
-    // make compiler happy about unused parameters
-    (void)rpc;
-    (void)pids;
-    (void)pid_count;
-    struct lmp_chan *lc = rpc->lmp_chan;
     errval_t err;
 
-    // allocate and map a frame, copying to it the string contents
-    struct capref frame;
-    void *buf;
-    err = frame_alloc(&frame, BASE_PAGE_SIZE, NULL);
-    DEBUG_ERR_ON_FAIL(err, "couldn't allocate frame for string\n");
-    err = paging_map_frame_attr(get_current_paging_state(), &buf, BASE_PAGE_SIZE, frame, VREGION_FLAGS_READ_WRITE);
-
-    // pass the string frame and length in the payload
-    struct aos_rpc_string_payload *payload = malloc(sizeof(struct aos_rpc_string_payload));
-    payload->rpc = rpc;
-    payload->frame = frame;
-    payload->len = BASE_PAGE_SIZE;
-
-    // send the frame and the length on the channel
-    err = lmp_chan_alloc_recv_slot(lc);
-    DEBUG_ERR_ON_FAIL(err, "lmp_chan_alloc_recv_slot");
-    err = lmp_chan_register_send(lc, get_default_waitset(), MKCLOSURE(send_get_all_pids_handler, (void *)payload));
-    DEBUG_ERR_ON_FAIL(err, "lmp_chan_send1");
-    event_dispatch(get_default_waitset());
-    event_dispatch(get_default_waitset());
-
-    // verify contents of frame
-    struct get_all_pids_frame_output* output = (struct get_all_pids_frame_output*) buf;
-    // debug_printf("here is the number of pids: %d\n", output->num_pids);
-    // debug_printf("here are the pids:\n");
-    *pids = output->pids;
-    *pid_count = output->num_pids;
-
-    free(payload);
+    // init fills in the response area of the bulk frame
+    struct get_all_pids_frame_output *output = malloc(sizeof(*output));
+    if (output == NULL) {
+        return LIB_ERR_MALLOC_FAIL;
+    }
+    struct aos_rpc_call call;
+    err = aos_rpc_call_bulk(rpc, GET_ALL_PIDS, NULL_CAP, 0, NULL, 0, output, sizeof(*output),
+                            &call);
+    if (err_is_fail(err)) {
+        DEBUG_ERR(err, "sending get all pids request");
+        free(output);
+        return err;
+    }
+
+    // hand the caller just the array, moved to the start of the allocation
+    *pid_count = MIN(output->num_pids, ARRAY_LENGTH(output->pids));
+    *pids = (domainid_t *)output;
+    memmove(*pids, output->pids, *pid_count * sizeof(domainid_t));
+
     return SYS_ERR_OK;
 }
 
@@ -942,42 +2075,27 @@ errval_t aos_rpc_list_elf_mod_names(struct aos_rpc *rpc,
                                     char (**names)[][MOD_NAME_LEN], 
                                     int *name_count)
 {
-    // make compiler happy about unused parameters
-    (void)rpc;
-    (void)names;
-    (void)name_count;
-    struct lmp_chan *lc = rpc->lmp_chan;
     errval_t err;
 
-    // allocate and map a frame, hijacking the aos string payload
-    struct capref frame;
-    void *buf;
-    err = frame_alloc(&frame, BASE_PAGE_SIZE, NULL);
-    DEBUG_ERR_ON_FAIL(err, "couldn't allocate frame for elf module names array\n");
-    err = paging_map_frame_attr(get_current_paging_state(), &buf, BASE_PAGE_SIZE, frame, VREGION_FLAGS_READ_WRITE);
-
-    struct aos_rpc_string_payload *payload = malloc(sizeof(struct aos_rpc_string_payload));
-    payload->rpc = rpc;
-    payload->frame = frame;
-    payload->len = BASE_PAGE_SIZE;
-
-    // send the frame and the length on the channel
-    err = lmp_chan_alloc_recv_slot(lc);
-    DEBUG_ERR_ON_FAIL(err, "lmp_chan_alloc_recv_slot");
-    err = lmp_chan_register_send(lc, get_default_waitset(), 
-                                 MKCLOSURE(send_get_elf_mod_names_handler, (void *)payload));
-    DEBUG_ERR_ON_FAIL(err, "lmp_chan_send1");
-    event_dispatch(get_default_waitset());
-    event_dispatch(get_default_waitset());
-
-    // verify contents of frame
-    struct get_elf_mod_names_output* output_mod_names = (struct get_elf_mod_names_output*) buf;
-    // debug_printf("here is the number of elf mod names: %d\n", output_mod_names->num_names);
-    // debug_printf("here are the names:\n");
-    *names = &output_mod_names->names;
-    *name_count = output_mod_names->num_names;
-
-    free(payload);
+    // init fills in the response area of the bulk frame
+    struct get_elf_mod_names_output *output = malloc(sizeof(*output));
+    if (output == NULL) {
+        return LIB_ERR_MALLOC_FAIL;
+    }
+    struct aos_rpc_call call;
+    err = aos_rpc_call_bulk(rpc, GET_MOD_NAMES, NULL_CAP, 0, NULL, 0, output, sizeof(*output),
+                            &call);
+    if (err_is_fail(err)) {
+        DEBUG_ERR(err, "sending get elf mod names request");
+        free(output);
+        return err;
+    }
+
+    // hand the caller just the array, moved to the start of the allocation
+    *name_count = MIN(output->num_names, MOD_NAME_MAX_NUM);
+    *names = (char (*)[][MOD_NAME_LEN])output;
+    memmove(*names, output->names, *name_count * MOD_NAME_LEN);
+
     return SYS_ERR_OK;
 }
 
@@ -1023,34 +2141,22 @@ errval_t aos_rpc_proc_get_status(struct aos_rpc *chan, domainid_t pid, coreid_t
  */
 errval_t aos_rpc_proc_get_name(struct aos_rpc *chan, domainid_t pid, char **name)
 {
-    // make compiler happy about unused parameters
-    (void)chan;
-    (void)pid;
-    (void)name;
-
-    struct lmp_chan *lc = chan->lmp_chan;
+    struct aos_rpc_call call;
     errval_t err;
 
-    // allocate and map a frame, copying to it the string contents
-    struct capref frame;
-    void *buf;
-    err = frame_alloc(&frame, BASE_PAGE_SIZE, NULL);
-    DEBUG_ERR_ON_FAIL(err, "couldn't allocate frame for name\n");
-    err = paging_map_frame_attr(get_current_paging_state(), &buf, BASE_PAGE_SIZE, frame, VREGION_FLAGS_READ_WRITE);
-
-    // pass the string frame and length in the payload
-    struct aos_rpc_string_payload *payload = malloc(sizeof(struct aos_rpc_string_payload));
-    payload->rpc = chan;
-    payload->frame = frame;
-    payload->len = pid;
-
-    // send the frame and the length on the channel
-    err = lmp_chan_alloc_recv_slot(lc);
-    DEBUG_ERR_ON_FAIL(err, "lmp_chan_alloc_recv_slot");
-    err = lmp_chan_register_send(lc, get_default_waitset(), MKCLOSURE(send_get_name_handler, (void *)payload));
-    DEBUG_ERR_ON_FAIL(err, "lmp_chan_send1");
-    event_dispatch(get_default_waitset());
-    event_dispatch(get_default_waitset());
+    char *buf = malloc(AOS_RPC_INLINE_MAX + 1);
+    if (buf == NULL) {
+        return LIB_ERR_MALLOC_FAIL;
+    }
+    buf[0] = '\0';
+
+    // the name comes back inline in the reply
+    err = aos_rpc_call_buf(chan, NAME_MSG, NULL_CAP, pid, 0, buf, AOS_RPC_INLINE_MAX + 1, &call);
+    if (err_is_fail(err)) {
+        DEBUG_ERR(err, "sending name request");
+        free(buf);
+        return err;
+    }
 
     // set name and return
     *name = buf;
@@ -1072,40 +2178,32 @@ errval_t aos_rpc_proc_get_name(struct aos_rpc *chan, domainid_t pid, char **name
  */
 errval_t aos_rpc_proc_get_pid(struct aos_rpc *rpc, const char *name, domainid_t *pid)
 {
-    // make compiler happy about unused parameters
-    (void)rpc;
-    (void)name;
-    (void)pid;
-
-    struct lmp_chan *lc = rpc->lmp_chan;
+    struct aos_rpc_call call;
     errval_t err;
+    size_t len = strlen(name);
+
+    if (len <= AOS_RPC_INLINE_MAX) {
+        // the name goes inline, the reply carries the pid
+        err = aos_rpc_call_inline(rpc, GET_PID, 0, name, len, &call);
+        if (err_is_fail(err)) {
+            DEBUG_ERR(err, "sending get pid request");
+            return err;
+        }
+        *pid = call.val;
+        return SYS_ERR_OK;
+    }
 
-    // allocate and map a frame, copying to it the string contents
-    struct capref frame;
-    void *buf;
-    err = frame_alloc(&frame, BASE_PAGE_SIZE, NULL);
-    DEBUG_ERR_ON_FAIL(err, "couldn't allocate frame for string\n");
-    err = paging_map_frame_attr(get_current_paging_state(), &buf, BASE_PAGE_SIZE, frame, VREGION_FLAGS_READ_WRITE);
-    strcpy(buf, name);
-    // pass the string frame and length in the payload
-    struct aos_rpc_string_payload *payload = malloc(sizeof(struct aos_rpc_string_payload));
-    payload->rpc = rpc;
-    payload->frame = frame;
-    payload->len = BASE_PAGE_SIZE;
-
-    // send the frame and the length on the channel
-    err = lmp_chan_alloc_recv_slot(lc);
-    DEBUG_ERR_ON_FAIL(err, "lmp_chan_alloc_recv_slot");
-    err = lmp_chan_register_send(lc, get_default_waitset(), MKCLOSURE(send_get_pid_handler, (void *)payload));
-    DEBUG_ERR_ON_FAIL(err, "lmp_chan_send1");
-    event_dispatch(get_default_waitset());
-    event_dispatch(get_default_waitset());
-
-    // verify contents of frame
-    struct get_pid_frame_output* output = (struct get_pid_frame_output*) buf;
-    *pid = output->pid;
-
-    free(payload);
+    // too long to go inline, pass it through the bulk frame
+    if (len + 1 > AOS_RPC_BULK_SIZE) {
+        return LIB_ERR_STRING_TOO_LONG;
+    }
+    err = aos_rpc_call_bulk(rpc, GET_PID, NULL_CAP, 0, name, len + 1, NULL, 0, &call);
+    if (err_is_fail(err)) {
+        DEBUG_ERR(err, "sending get pid request");
+        return err;
+    }
+
+    *pid = call.val;
     return SYS_ERR_OK;
 }
 
@@ -1162,44 +2260,16 @@ errval_t aos_rpc_proc_resume(struct aos_rpc *chan, domainid_t pid)
  */
 errval_t aos_rpc_proc_exit(struct aos_rpc *rpc, int status)
 {
-    // make compiler happy about unused parameters
-    (void)rpc;
-    (void)status;
-    // TODO: implement the process exit RPC
-
-    // I think this must be bonus becasue it involves killing a process
-    // and we aren't able to do that
-    // debug_printf("made it into aos_rpc_proc_exit\n");
-    
-    struct lmp_chan *lc = rpc->lmp_chan;
     errval_t err;
-    // debug_printf("here's the status we're sending: %d\n", status);
-    // debug_printf("here is our pid: %d\n", disp_get_domain_id());
-    // allocate and map a frame, copying to it the string contents
-    struct capref frame;
-    void *buf;
-    err = frame_alloc(&frame, BASE_PAGE_SIZE, NULL);
-    DEBUG_ERR_ON_FAIL(err, "couldn't allocate frame for string\n");
-    err = paging_map_frame_attr(get_current_paging_state(), &buf, BASE_PAGE_SIZE, frame, VREGION_FLAGS_READ_WRITE);
-    *((int *) buf) = status;
-    ((int *) buf)[1] = disp_get_domain_id();
-    // pass the string frame and length in the payload
-    struct aos_rpc_string_payload *payload = malloc(sizeof(struct aos_rpc_string_payload));
-    payload->rpc = rpc;
-    payload->frame = frame;
-    payload->len = BASE_PAGE_SIZE;
-
-    // send the frame and the length on the channel
-    err = lmp_chan_alloc_recv_slot(lc);
-    DEBUG_ERR_ON_FAIL(err, "lmp_chan_alloc_recv_slot");
-    err = lmp_chan_register_send(lc, get_default_waitset(), MKCLOSURE(send_exit_handler, (void *)payload));
-    DEBUG_ERR_ON_FAIL(err, "lmp_chan_send1");
-    event_dispatch(get_default_waitset());
-    event_dispatch(get_default_waitset());
-
-    // debug_printf("looks like we've been killed alright\n");
-
-    free(payload);
+
+    // status and pid fit into the message itself
+    struct aos_rpc_call call;
+    err = aos_rpc_call(rpc, EXIT_MSG, NULL_CAP, (unsigned int)status, disp_get_domain_id(),
+                       &call);
+    if (err_is_fail(err)) {
+        DEBUG_ERR(err, "sending exit request");
+        return err;
+    }
 
     return SYS_ERR_OK;
 }
@@ -1218,36 +2288,23 @@ errval_t aos_rpc_proc_exit(struct aos_rpc *rpc, int status)
  */
 errval_t aos_rpc_proc_wait(struct aos_rpc *rpc, domainid_t pid, int *status)
 {
+    errval_t err;
+
     bool terminated = false;
     do {
-        struct lmp_chan *lc = rpc->lmp_chan;
-        errval_t err;
-
-        // allocate and map a frame, copying to it the string contents
-        struct capref frame;
-        void *buf;
-        err = frame_alloc(&frame, BASE_PAGE_SIZE, NULL);
-        DEBUG_ERR_ON_FAIL(err, "couldn't allocate frame for string\n");
-        err = paging_map_frame_attr(get_current_paging_state(), &buf, BASE_PAGE_SIZE, frame, VREGION_FLAGS_READ_WRITE);
-        *((domainid_t*) buf) = pid;
-        // pass the string frame and length in the payload
-        struct aos_rpc_string_payload *payload = malloc(sizeof(struct aos_rpc_string_payload));
-        payload->rpc = rpc;
-        payload->frame = frame;
-        payload->len = BASE_PAGE_SIZE;
-
-        // send the frame and the length on the channel
-        err = lmp_chan_alloc_recv_slot(lc);
-        DEBUG_ERR_ON_FAIL(err, "lmp_chan_alloc_recv_slot");
-        err = lmp_chan_register_send(lc, get_default_waitset(), MKCLOSURE(send_wait_handler, (void *)payload));
-        DEBUG_ERR_ON_FAIL(err, "lmp_chan_send1");
-        event_dispatch(get_default_waitset());
-        event_dispatch(get_default_waitset());
+        // the reply carries the exit status, or NOT_TERMINATED_PID while it still runs and
+        // SPAWN_ERR_PID if there is no such process
+        struct aos_rpc_call call;
+        err = aos_rpc_call(rpc, WAIT_MSG, NULL_CAP, pid, 0, &call);
+        if (err_is_fail(err)) {
+            DEBUG_ERR(err, "sending wait request");
+            return err;
+        }
 
-        // verify contents of frame
-        struct wait_frame_output* output = (struct wait_frame_output*) buf;
-        // debug_printf("returned exit code: %d\n", output->status);
-        *status = output->status;
+        *status = (int)call.val;
+        if (*status == SPAWN_ERR_PID) {
+            return SPAWN_ERR_DOMAIN_NOTFOUND;
+        }
 
         if (*status != NOT_TERMINATED_PID) {
             terminated = true;
@@ -1255,7 +2312,6 @@ errval_t aos_rpc_proc_wait(struct aos_rpc *rpc, domainid_t pid, int *status)
             thread_yield();
             barrelfish_usleep(100000);
         }
-        free(payload);
     } while (terminated == false);
     return SYS_ERR_OK;
 }
@@ -1301,6 +2357,116 @@ errval_t aos_rpc_proc_kill_all(struct aos_rpc *chan, const char *name)
 
 
 
+/*
+ * ===============================================================================================
+ * Benchmark RPCs
+ * ===============================================================================================
+ */
+
+
+errval_t aos_rpc_bench_sink(struct aos_rpc *rpc, const void *buf, size_t len)
+{
+    struct aos_rpc_call call;
+
+    if (len <= AOS_RPC_INLINE_MAX) {
+        return aos_rpc_call_inline(rpc, BENCH_SINK, 0, buf, len, &call);
+    }
+    return aos_rpc_call_bulk(rpc, BENCH_SINK, NULL_CAP, 0, buf, len, NULL, 0, &call);
+}
+
+errval_t aos_rpc_bench_ump(struct aos_rpc *rpc, coreid_t from, coreid_t to,
+                           struct ump_bench_result *res)
+{
+    errval_t err;
+
+    STATIC_ASSERT(sizeof(struct ump_bench_result) <= AOS_RPC_BULK_SIZE,
+                  "UMP benchmark result does not fit into the bulk frame");
+
+    // init leaves the result in the response area and its error in the reply word
+    struct aos_rpc_call call;
+    err = aos_rpc_call_bulk(rpc, BENCH_UMP, NULL_CAP, ((uintptr_t)from << 8) | to, NULL, 0,
+                            res, sizeof(*res), &call);
+    if (err_is_fail(err)) {
+        return err;
+    }
+    return (errval_t)call.val;
+}
+
+
+
+/*
+ * ===============================================================================================
+ * Nameservice RPCs
+ * ===============================================================================================
+ */
+
+
+// call init about a name, the error of the request comes back in the reply word
+static errval_t aos_rpc_ns_call(struct aos_rpc *rpc, enum msg_type type, struct capref cap,
+                                uintptr_t arg, const char *name, void *out, size_t outlen)
+{
+    errval_t err;
+
+    size_t len = strlen(name) + 1;
+    if (len > NS_NAME_LEN) {
+        return LIB_ERR_NAMESERVICE_INVALID_NAME;
+    }
+
+    struct aos_rpc_call call;
+    err = aos_rpc_call_bulk(rpc, type, cap, arg, name, len, out, outlen, &call);
+    if (err_is_fail(err)) {
+        return err;
+    }
+    return (errval_t)call.val;
+}
+
+errval_t aos_rpc_ns_register(struct aos_rpc *rpc, const char *name, struct capref ep)
+{
+    return aos_rpc_ns_call(rpc, NS_REGISTER, ep, 0, name, NULL, 0);
+}
+
+errval_t aos_rpc_ns_deregister(struct aos_rpc *rpc, const char *name)
+{
+    return aos_rpc_ns_call(rpc, NS_DEREGISTER, NULL_CAP, 0, name, NULL, 0);
+}
+
+errval_t aos_rpc_ns_lookup(struct aos_rpc *rpc, const char *name, coreid_t *core,
+                           struct capref *ep)
+{
+    errval_t err;
+    struct ns_frame_output out;
+    struct aos_rpc_call call;
+
+    size_t len = strlen(name) + 1;
+    if (len > NS_NAME_LEN) {
+        return LIB_ERR_NAMESERVICE_INVALID_NAME;
+    }
+
+    // the endpoint only comes along if the server is on this core
+    err = aos_rpc_call_bulk(rpc, NS_LOOKUP, NULL_CAP, 0, name, len, &out, sizeof(out), &call);
+    if (err_is_fail(err)) {
+        return err;
+    }
+    if (err_is_fail((errval_t)call.val)) {
+        return (errval_t)call.val;
+    }
+    *core = out.core;
+    *ep = call.cap;
+    return SYS_ERR_OK;
+}
+
+errval_t aos_rpc_ns_enumerate(struct aos_rpc *rpc, const char *query,
+                              struct ns_frame_output *out)
+{
+    return aos_rpc_ns_call(rpc, NS_ENUMERATE, NULL_CAP, 0, query, out, AOS_RPC_BULK_SIZE);
+}
+
+errval_t aos_rpc_ns_bind_ump(struct aos_rpc *rpc, const char *name, coreid_t core,
+                             struct capref frame)
+{
+    return aos_rpc_ns_call(rpc, NS_BIND_UMP, frame, core, name, NULL, 0);
+}
+
 /**
  * \brief Returns the RPC channel to init.
  */
@@ -1319,10 +2485,41 @@ struct aos_rpc *aos_rpc_get_init_channel(void)
         }
         aos_rpc_init(rpc);
 
-        err = lmp_chan_accept(rpc->lmp_chan, DEFAULT_LMP_BUF_WORDS, cap_initep);
+        err = lmp_chan_accept(rpc->lmp_chan, AOS_RPC_LMP_BUF_WORDS, cap_initep);
+        if (err_is_fail(err)) {
+            DEBUG_ERR(err, "accepting init channel");
+            return NULL;
+        }
+
+        err = lmp_chan_alloc_recv_slot(rpc->lmp_chan);
+        if (err_is_fail(err)) {
+            DEBUG_ERR(err, "allocating receive slot for init channel");
+            return NULL;
+        }
+        err = lmp_chan_register_recv(rpc->lmp_chan, &rpc->ws,
+                                     MKCLOSURE(aos_rpc_recv_handler, (void *) rpc));
+        if (err_is_fail(err)) {
+            DEBUG_ERR(err, "registering receive handler for init channel");
+            return NULL;
+        }
+        global_rpc = rpc;
+
+        // the bulk frame was placed in our cspace by init when we were spawned
+        err = aos_rpc_bulk_map(rpc, cap_bulk);
+        if (err_is_fail(err)) {
+            DEBUG_ERR(err, "mapping bulk frame shared with init");
+        }
+
+        // send our local endpoint to init
+        struct aos_rpc_call call;
+        err = aos_rpc_call(rpc, SETUP_MSG, rpc->lmp_chan->local_cap, 0, 0, &call);
+        if (err_is_fail(err)) {
+            DEBUG_ERR(err, "sending setup message");
+            global_rpc = NULL;
+            return NULL;
+        }
     }
 
-    global_rpc = rpc;
     return rpc;
 }
 
@@ -22,6 +22,9 @@
 #include <aos/aos_rpc.h>
 #include <stdio.h>
 
+/// frames of at least this size are requested pre-zeroed from init
+#define FRAME_ALLOC_PREZEROED_MIN_BYTES (1UL << 20)
+
 /// Initializer for the current
 #define ROOT_CNODE_INIT                                                                            \
     {                                                                                              \
@@ -111,6 +114,9 @@ struct capref cap_ipi = { .cnode = TASK_CNODE_INIT, .slot = TASKCN_SLOT_IPI };
 /// Capability for endpoint to init (only in monitor/mem_serv)
 struct capref cap_initep = { .cnode = TASK_CNODE_INIT, .slot = TASKCN_SLOT_INITEP };
 
+/// Capability to the frame shared with init for bulk RPC payloads
+struct capref cap_bulk = { .cnode = TASK_CNODE_INIT, .slot = TASKCN_SLOT_BULK };
+
 /// Capability to the URPC frame
 struct capref cap_urpc = { .cnode = TASK_CNODE_INIT, .slot = TASKCN_SLOT_MON_URPC };
 
@@ -298,6 +304,36 @@ errval_t cap_retype_many(struct capref dest, struct capref src, gensize_t offset
 }
 
 
+/**
+ * @brief Retypes (part of) a Frame that is known to be zeroed into a new Frame
+ *
+ * @param[out] dest    capref to an empty slot in a CSpace to hold the new frame
+ * @param[in]  src     capref to the source Frame capability (contents must be zero)
+ * @param[in]  offset  offset into the source frame
+ * @param[in]  bytes   size of the new frame
+ *
+ * @returns error value indicating success or failure of the operation
+ *
+ * @note The kernel skips clearing the memory, so this is only correct if the caller
+ * knows the range is zero. As the caller can already access the source frame, the
+ * kernel does not need to trust it for anything else.
+ */
+errval_t frame_retype_prezeroed(struct capref dest, struct capref src, gensize_t offset,
+                                gensize_t bytes)
+{
+    capaddr_t       dcs_addr  = get_croot_addr(dest);
+    capaddr_t       dcn_addr  = get_cnode_addr(dest);
+    enum cnode_type dcn_level = get_cnode_level(dest);
+
+    capaddr_t scp_root = get_croot_addr(src);
+    capaddr_t scp_addr = get_cap_addr(src);
+
+    return invoke_cnode_retype_flags(cap_root, scp_root, scp_addr, offset, ObjType_Frame, bytes,
+                                     1, dcs_addr, dcn_addr, dcn_level, dest.slot,
+                                     RETYPE_FLAG_NOZERO);
+}
+
+
 /**
  * @brief creates a new capability with the given size and type (limited )
  *
@@ -721,7 +757,22 @@ errval_t frame_create(struct capref dest, size_t bytes, size_t *retbytes)
  */
 errval_t frame_alloc(struct capref *dest, size_t bytes, size_t *retbytes)
 {
-    errval_t err = slot_alloc(dest);
+    errval_t err;
+
+    // large frames come pre-zeroed from init, if it has some ready
+    struct aos_rpc *init_rpc = get_init_rpc();
+    if (init_rpc != NULL && bytes >= FRAME_ALLOC_PREZEROED_MIN_BYTES) {
+        size_t ret;
+        err = aos_rpc_get_zeroed_frame(init_rpc, bytes, dest, &ret);
+        if (err_is_ok(err)) {
+            if (retbytes != NULL) {
+                *retbytes = ret;
+            }
+            return SYS_ERR_OK;
+        }
+    }
+
+    err = slot_alloc(dest);
     if (err_is_fail(err)) {
         return err_push(err, LIB_ERR_SLOT_ALLOC);
     }
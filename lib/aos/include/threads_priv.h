@@ -50,6 +50,7 @@ struct thread {
     arch_registers_state_t regs  __attribute__ ((aligned (16)));            ///< Register state snapshot
     void                *stack;             ///< Malloced stack area
     void                *stack_top;         ///< Stack bounds
+    size_t              stack_bytes;        ///< Size of the stack area (for the stack pool)
     void                *exception_stack;   ///< Stack for exception handling
     void                *exception_stack_top; ///< Bounds of exception stack
     exception_handler_fn exception_handler; ///< Exception handler, or NULL
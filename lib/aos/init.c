@@ -27,19 +27,30 @@
 #include <barrelfish_kpi/domain_params.h>
 
 #include <aos/aos_rpc.h>
+#include <aos/deferred.h>
 
 #include "threads_priv.h"
 #include "init.h"
 
 #include <grading/grading.h>
 
-#define BUF_LEN 128
-char print_buffer[BUF_LEN];
-int buf_pos = 0;
+/// console output is collected here and sent to init in as few RPCs as possible
+#define BUF_LEN 1024
+/// output not terminated by a newline is flushed after this many microseconds at the latest
+#define BUF_FLUSH_US 20000
+
+static char print_buffer[BUF_LEN];
+static size_t buf_pos = 0;
+static struct thread_mutex print_mutex = THREAD_MUTEX_INITIALIZER;
+static struct deferred_event print_flush_event;
+static bool print_flush_armed = false;
+static bool print_flush_ready = false;
 
 /// Are we the init domain (and thus need to take some special paths)?
 static bool init_domain;
 
+static errval_t aos_terminal_flush(void);
+
 extern size_t (*_libc_terminal_read_func)(char *, size_t);
 extern size_t (*_libc_terminal_write_func)(const char *, size_t);
 extern void (*_libc_exit_func)(int);
@@ -51,6 +62,7 @@ __weak_reference(libc_exit, _exit);
 void libc_exit(int status)
 {
     //debug_printf("exit NYI\n");
+    aos_terminal_flush();
     aos_rpc_proc_exit(aos_rpc_get_process_channel(), status);
 
     thread_exit(status);
@@ -99,6 +111,9 @@ static size_t aos_terminal_read(char *buf, size_t len)
 {
     errval_t err;
 
+    // make sure a prompt is visible before blocking for input
+    aos_terminal_flush();
+
     for (size_t i = 0; i < len; i++) {
         err = aos_rpc_serial_getchar(aos_rpc_get_init_channel(), &buf[i]);
         if (err_is_fail(err)) return i;
@@ -106,33 +121,84 @@ static size_t aos_terminal_read(char *buf, size_t len)
     return len;
 }
 
+// send out everything buffered so far, called with print_mutex held
+static errval_t aos_terminal_flush_locked(void)
+{
+    errval_t err = SYS_ERR_OK;
+
+    if (buf_pos > 0) {
+        err = aos_rpc_serial_putstring(aos_rpc_get_serial_channel(), print_buffer, buf_pos);
+        buf_pos = 0;
+    }
+    return err;
+}
+
+static errval_t aos_terminal_flush(void)
+{
+    thread_mutex_lock(&print_mutex);
+    errval_t err = aos_terminal_flush_locked();
+    thread_mutex_unlock(&print_mutex);
+    return err;
+}
+
+// timeout for output without a trailing newline, e.g. a shell prompt
+static void aos_terminal_flush_timeout(void *arg)
+{
+    (void)arg;
+
+    thread_mutex_lock(&print_mutex);
+    print_flush_armed = false;
+    aos_terminal_flush_locked();
+    thread_mutex_unlock(&print_mutex);
+}
+
+/*
+ * Output is buffered and sent to init as one string when a write completes a line, when the
+ * buffer fills up, or when a short timeout expires. That is a handful of RPCs per write
+ * rather than one per character.
+ */
 __attribute__((__used__))
 static size_t aos_terminal_write(const char *buf, size_t len)
 {
     errval_t err;
-    size_t i = 0;
-
-    while (i < len) {
-        // print the buffer on newline
-        if (buf[i] == '\n' || buf[i] == '\r' || buf[i] == 4) {
-            for (int j = 0; j < buf_pos; j++) {
-                err = aos_rpc_serial_putchar(aos_rpc_get_init_channel(), print_buffer[j]);
-                if (err_is_fail(err)) {
-                    return i;
-                }
+    bool line_done = false;
+    size_t i;
+
+    // init cannot send RPCs to itself
+    if (init_domain) {
+        err = sys_print(buf, len);
+        return err_is_ok(err) ? len : 0;
+    }
+
+    thread_mutex_lock(&print_mutex);
+    for (i = 0; i < len; i++) {
+        bool newline = buf[i] == '\n' || buf[i] == '\r' || buf[i] == 4;
+        if (buf_pos + (newline ? 2 : 1) > BUF_LEN) {
+            err = aos_terminal_flush_locked();
+            if (err_is_fail(err)) {
+                break;
             }
-            aos_rpc_serial_putchar(aos_rpc_get_init_channel(), '\r');
-            aos_rpc_serial_putchar(aos_rpc_get_init_channel(), '\n');
-            buf_pos = 0;
-        } else if (buf_pos >= BUF_LEN) {
-            return i;
+        }
+
+        if (newline) {
+            print_buffer[buf_pos++] = '\r';
+            print_buffer[buf_pos++] = '\n';
+            line_done = true;
         } else {
-            print_buffer[buf_pos] = buf[i];
-            buf_pos++;
+            print_buffer[buf_pos++] = buf[i];
         }
-        i++;
     }
-    return len;
+
+    if (line_done) {
+        err = aos_terminal_flush_locked();
+    } else if (buf_pos > 0 && print_flush_ready && !print_flush_armed) {
+        err = deferred_event_register(&print_flush_event, get_default_waitset(), BUF_FLUSH_US,
+                                      MKCLOSURE(aos_terminal_flush_timeout, NULL));
+        print_flush_armed = err_is_ok(err);
+    }
+    thread_mutex_unlock(&print_mutex);
+
+    return i;
 }
 
 /* Set libc function pointers */
@@ -206,23 +272,19 @@ errval_t barrelfish_init_onthread(struct spawn_domain_params *params)
 
     // MILESTONE 3: register ourselves with init
 
-    /* initialize init RPC client with lmp channel */
+    /* initialize init RPC client with lmp channel and send our local ep to init */
     struct aos_rpc *rpc = aos_rpc_get_init_channel();
-
-    /* set receive handler */
-    err = lmp_chan_alloc_recv_slot(rpc->lmp_chan);
-    DEBUG_ERR_ON_FAIL(err, "allocating receive slot for lmp channel\n");
-
-    /* send local ep to init */
-    err = lmp_chan_register_send(rpc->lmp_chan, get_default_waitset(), MKCLOSURE(setup_send_handler, (void *) rpc));
-    DEBUG_ERR_ON_FAIL(err, "couldn't register send in child\n");
-    err = event_dispatch(get_default_waitset());
-    err = event_dispatch(get_default_waitset());
-    DEBUG_ERR_ON_FAIL(err, "couldn't dispatch event in child\n");
+    if (rpc == NULL) {
+        return LIB_ERR_LMP_CHAN_INIT;
+    }
 
     /* set init RPC client in our program state */
     set_init_rpc(rpc);
 
+    /* unterminated console output may now be flushed from the default waitset */
+    deferred_event_init(&print_flush_event);
+    print_flush_ready = true;
+
     // right now we don't have the nameservice & don't need the terminal
     // and domain spanning, so we return here
     return SYS_ERR_OK;
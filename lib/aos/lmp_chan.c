@@ -30,6 +30,7 @@ void lmp_chan_init(struct lmp_chan *lc)
     lc->connstate = LMP_DISCONNECTED;
     waitset_chanstate_init(&lc->send_waitset, CHANTYPE_LMP_OUT);
     lc->endpoint = NULL;
+    lc->long_buf = NULL;
 #ifndef NDEBUG
     lc->prev = lc->next = NULL;
 #endif
@@ -46,6 +47,13 @@ void lmp_chan_destroy(struct lmp_chan *lc)
         lmp_endpoint_free(lc->endpoint);
     }
 
+    if (lc->long_buf != NULL) {
+        dispatcher_handle_t handle = disp_disable();
+        heap_free(&get_dispatcher_generic(handle)->lmp_endpoint_heap, lc->long_buf);
+        disp_enable(handle);
+        lc->long_buf = NULL;
+    }
+
     // remove from send retry queue on dispatcher
     if (waitset_chan_is_registered(&lc->send_waitset)) {
         assert(lc->prev != NULL && lc->next != NULL);
@@ -152,14 +160,18 @@ errval_t lmp_chan_register_send(struct lmp_chan *lc, struct waitset *ws,
 errval_t lmp_chan_deregister_send(struct lmp_chan *lc)
 {
     assert(lc != NULL);
-    errval_t err = waitset_chan_deregister(&lc->send_waitset);
-    if (err_is_fail(err)) {
+    dispatcher_handle_t handle = disp_disable();
+
+    // a triggered event has already been taken off the retry list
+    bool queued = waitset_chan_is_registered(&lc->send_waitset);
+    errval_t err = waitset_chan_deregister_disabled(&lc->send_waitset, handle);
+    if (err_is_fail(err) || !queued) {
+        disp_enable(handle);
         return err;
     }
 
     // dequeue from list of channels with send events
-    assert(lc->next != NULL && lc->prev != NULL);
-    dispatcher_handle_t handle = disp_disable();
+    assert_disabled(lc->next != NULL && lc->prev != NULL);
     struct dispatcher_generic *dp = get_dispatcher_generic(handle);
     if (lc->next == lc->prev) {
         assert_disabled(dp->lmp_send_events_list == lc);
@@ -213,6 +225,98 @@ errval_t lmp_chan_alloc_recv_slot(struct lmp_chan *lc)
     return SYS_ERR_OK;
 }
 
+// receive into a buffer of any size, skipping wakeups and waking a waiting peer
+static errval_t lmp_chan_recv_buf(struct lmp_chan *lc, struct lmp_recv_buf *buf,
+                                  struct capref *cap)
+{
+    struct capref recv_cap = NULL_CAP;
+    errval_t err;
+
+    do {
+        err = lmp_endpoint_recv(lc->endpoint, buf, &recv_cap);
+        if (err_is_fail(err)) {
+            return err;
+        }
+
+        if (lmp_endpoint_space_drained(lc->endpoint)) {
+            // the peer's buffer may be full in turn, it retries on its next message then;
+            // otherwise ask again with the next message we receive
+            errval_t err2 = lmp_ep_send0(lc->remote_cap, 0, NULL_CAP);
+            if (err_is_fail(err2) && err_no(err2) != SYS_ERR_LMP_BUF_OVERFLOW) {
+                lmp_endpoint_want_space_again(lc->endpoint);
+            }
+        }
+    } while (buf->msglen == 0 && capref_is_null(recv_cap));
+
+    if (cap != NULL) {
+        *cap = recv_cap;
+    }
+    return SYS_ERR_OK;
+}
+
+/**
+ * \brief Receive a message from an LMP channel, if possible
+ *
+ * Non-blocking. May fail if no message is available.
+ *
+ * Empty messages without a capability are wakeups for senders waiting on a full
+ * buffer (see #LMP_FLAG_NOTIFY). They are skipped here, receiving them has already
+ * retried the channel's send events. In turn, a peer waiting on our buffer is woken
+ * once enough of it has been consumed.
+ *
+ * \param lc  LMP channel
+ * \param msg LMP message buffer, to be filled-in
+ * \param cap If non-NULL, filled-in with location of received capability, if any
+ */
+errval_t lmp_chan_recv(struct lmp_chan *lc, struct lmp_recv_msg *msg, struct capref *cap)
+{
+    assert(msg != NULL);
+    assert(msg->buf.buflen == LMP_MSG_LENGTH);
+    return lmp_chan_recv_buf(lc, &msg->buf, cap);
+}
+
+/**
+ * \brief Receive a message from an LMP channel, which may be an extended one
+ *
+ * Same as lmp_chan_recv(), for channels whose peer sends with #LMP_FLAG_LONG.
+ *
+ * \param lc  LMP channel
+ * \param msg LMP message buffer, to be filled-in
+ * \param cap If non-NULL, filled-in with location of received capability, if any
+ */
+errval_t lmp_chan_recv_long(struct lmp_chan *lc, struct lmp_recv_long_msg *msg,
+                            struct capref *cap)
+{
+    assert(msg != NULL);
+    assert(msg->buf.buflen == LMP_LONG_MSG_LENGTH);
+    return lmp_chan_recv_buf(lc, &msg->buf, cap);
+}
+
+/**
+ * \brief Get the buffer extended messages are sent from on an LMP channel
+ *
+ * The kernel only copies payloads out of the dispatcher frame, so the buffer is
+ * taken from the same heap as endpoints on first use. Callers fill it in and pass
+ * it to lmp_ep_send_long(), serialising sends on the channel themselves.
+ *
+ * \param lc LMP channel
+ *
+ * \return The buffer of LMP_LONG_MSG_LENGTH words, or NULL if out of space
+ */
+uintptr_t *lmp_chan_long_buf(struct lmp_chan *lc)
+{
+    assert(lc != NULL);
+
+    if (lc->long_buf == NULL) {
+        dispatcher_handle_t handle = disp_disable();
+        struct dispatcher_generic *dg = get_dispatcher_generic(handle);
+        lc->long_buf = heap_alloc(&dg->lmp_endpoint_heap,
+                                  LMP_LONG_MSG_LENGTH * sizeof(uintptr_t));
+        disp_enable(handle);
+    }
+    return lc->long_buf;
+}
+
 /**
  * \brief Trigger send events for all LMP channels that are registered
  *
@@ -25,6 +25,7 @@
 static void endpoint_init(struct lmp_endpoint *ep)
 {
     ep->k.delivered = ep->k.consumed = 0;
+    ep->k.space_wanted = 0;
     ep->k.recv_cspc = 0;
     ep->k.recv_cptr = 0;
     ep->seen = 0;
@@ -434,6 +435,49 @@ errval_t lmp_endpoint_recv(struct lmp_endpoint *ep, struct lmp_recv_buf *buf,
     return SYS_ERR_OK;
 }
 
+/**
+ * \brief Returns true iff a sender asked to be woken and now fits into the buffer
+ *
+ * The request is cleared when this returns true, so only one caller sends the
+ * wakeup. See lmp_want_space() in the kernel.
+ */
+bool lmp_endpoint_space_drained(struct lmp_endpoint *ep)
+{
+    uint32_t wanted = ep->k.space_wanted;
+    if (wanted == 0) {
+        return false;
+    }
+
+    uint32_t delivered = ep->k.delivered;
+    uint32_t consumed = ep->k.consumed;
+    uint32_t space;
+    if (delivered >= consumed) {
+        space = ep->buflen - (delivered - consumed);
+    } else {
+        space = consumed - delivered;
+    }
+
+    // same rule as the kernel: one word always stays free
+    if (space <= wanted) {
+        return false;
+    }
+
+    // the kernel may have raised the mark for a larger message meanwhile
+    return __sync_bool_compare_and_swap(&ep->k.space_wanted, wanted, 0);
+}
+
+/**
+ * \brief Re-arms a wakeup that lmp_endpoint_space_drained() handed out but that
+ * could not be sent
+ *
+ * The next call to lmp_endpoint_space_drained() returns true again, unless the
+ * kernel has set a new mark meanwhile, which has the same effect.
+ */
+void lmp_endpoint_want_space_again(struct lmp_endpoint *ep)
+{
+    __sync_bool_compare_and_swap(&ep->k.space_wanted, 0, 1);
+}
+
 /**
  * \brief Store a newly-received LRPC message into an endpoint buffer
  *
@@ -9,11 +9,286 @@
 #include <aos/waitset.h>
 #include <aos/nameserver.h>
 #include <aos/aos_rpc.h>
+#include <aos/paging.h>
 
 
 #include <hashtable/hashtable.h>
 
 
+/*
+ * Init only brokers the setup of channels: a server registers the endpoint it listens on,
+ * and a client looking it up either binds to that endpoint directly (same core) or has init
+ * hand a frame to the server that then holds a UMP channel between the two (other core).
+ * All requests after that go straight from the client to the server.
+ */
+
+/// a name this domain serves, with the endpoint new clients bind to
+struct ns_server {
+    char                           name[NS_NAME_LEN];
+    nameservice_receive_handler_t *recv_handler;
+    void                          *st;
+    struct lmp_chan                listen;
+    struct ns_server              *next;
+};
+
+/// server side of a channel from a client on this core
+struct ns_lmp_client {
+    struct ns_server *srv;
+    struct aos_rpc    rpc;
+};
+
+/// server side of a channel from a client on another core
+struct ns_ump_client {
+    struct ns_server *srv;
+    struct ump_demux  dm;    ///< requests from the client
+    struct ump_chan  *send;  ///< replies to it
+};
+
+/// client side of a channel to a server, what nameservice_chan_t points to
+struct ns_chan {
+    enum aos_rpc_transport transport;
+    struct aos_rpc         rpc;   ///< AOS_RPC_LMP
+    struct ump_demux       dm;    ///< AOS_RPC_UMP: replies from the server
+    struct ump_chan       *send;  ///< AOS_RPC_UMP: requests to it
+    char                   resp[AOS_RPC_BULK_SIZE];
+};
+
+static struct ns_server *ns_servers;
+
+// hand a request to the server's handler, the message is NUL-terminated for its convenience
+static void ns_serve(struct ns_server *srv, const void *data, size_t len, struct capref cap,
+                     void **resp, size_t *resp_len, struct capref *resp_cap)
+{
+    char *msg = malloc(len + 1);
+    if (msg == NULL) {
+        DEBUG_ERR(LIB_ERR_MALLOC_FAIL, "copying nameservice request");
+        *resp = NULL;
+        *resp_len = 0;
+        *resp_cap = NULL_CAP;
+        return;
+    }
+    memcpy(msg, data, len);
+    msg[len] = '\0';
+
+    *resp = NULL;
+    *resp_len = 0;
+    *resp_cap = NULL_CAP;
+    srv->recv_handler(srv->st, msg, len, resp, resp_len, cap, resp_cap);
+    free(msg);
+}
+
+// requests of a client on this core, one channel and endpoint per client
+static void ns_lmp_recv_handler(void *arg)
+{
+    struct lmp_recv_long_msg msg = LMP_RECV_LONG_MSG_INIT;
+    struct ns_lmp_client *c = arg;
+    struct aos_rpc *rpc = &c->rpc;
+    struct capref cap = NULL_CAP;
+    errval_t err, recv_err;
+
+    recv_err = lmp_chan_recv_long(rpc->lmp_chan, &msg, &cap);
+
+    err = lmp_chan_register_recv(rpc->lmp_chan, get_default_waitset(),
+                                 MKCLOSURE(ns_lmp_recv_handler, arg));
+    if (err_is_fail(err)) {
+        DEBUG_ERR(err, "re-registering nameservice receive handler");
+        return;
+    }
+    if (err_is_fail(recv_err)) {
+        if (err_no(recv_err) != LIB_ERR_NO_LMP_MSG) {
+            DEBUG_ERR(recv_err, "receiving nameservice request");
+        }
+        return;
+    }
+    if (!capref_is_null(cap)) {
+        err = lmp_chan_alloc_recv_slot(rpc->lmp_chan);
+        if (err_is_fail(err)) {
+            DEBUG_ERR(err, "allocating new nameservice receive slot");
+        }
+    }
+
+    if (!aos_rpc_inline_recv(rpc, &msg)) {
+        return;
+    }
+
+    switch (AOS_RPC_HDR_TYPE(msg.words[0])) {
+    case NS_BIND_BULK:
+        err = aos_rpc_bulk_map(rpc, cap);
+        if (err_is_fail(err)) {
+            DEBUG_ERR(err, "mapping bulk frame of nameservice client");
+        }
+        err = aos_rpc_reply(rpc, msg.words[0], ACK_MSG, NULL_CAP, 0);
+        break;
+
+    case NS_RPC: {
+        const void *data = AOS_RPC_IS_INLINE(msg.words[0]) ? rpc->rx.buf
+                                                            : aos_rpc_bulk_req(rpc, msg.words[0]);
+        size_t len = MIN(msg.words[2], AOS_RPC_IS_INLINE(msg.words[0]) ? AOS_RPC_INLINE_MAX
+                                                                        : AOS_RPC_BULK_SIZE);
+        void *resp;
+        size_t resp_len;
+        struct capref resp_cap;
+        ns_serve(c->srv, data, len, cap, &resp, &resp_len, &resp_cap);
+
+        err = aos_rpc_reply_msg(rpc, msg.words[0], resp_cap, resp, MIN(resp_len,
+                                                                       AOS_RPC_BULK_SIZE));
+        break;
+    }
+
+    default:
+        debug_printf("nameservice: unexpected message type %d\n",
+                     AOS_RPC_HDR_TYPE(msg.words[0]));
+        return;
+    }
+
+    if (err_is_fail(err)) {
+        DEBUG_ERR(err, "replying to nameservice client");
+    }
+}
+
+// requests of a client on another core, polled from the default waitset
+static bool ns_ump_rpc_handler(struct ump_payload *msg, void *arg)
+{
+    struct ns_ump_client *c = arg;
+    errval_t err;
+
+    void *resp;
+    size_t resp_len;
+    struct capref resp_cap;
+    const char *data = ump_msg_data(c->dm.chan, msg);
+    ns_serve(c->srv, data != NULL ? data : "", msg->data_len, NULL_CAP, &resp, &resp_len,
+             &resp_cap);
+    ump_msg_release(c->dm.chan, msg);
+
+    if (!capref_is_null(resp_cap)) {
+        debug_printf("nameservice: capabilities are not passed to other cores, dropped\n");
+    }
+
+    struct ump_payload reply;
+    reply.type = NS_REPLY;
+    reply.send_core = disp_get_core_id();
+    reply.recv_core = msg->send_core;
+    if (resp_len > 0) {
+        err = ump_send_data(c->send, &reply, resp, resp_len);
+    } else {
+        reply.data_len = 0;
+        err = ump_send(c->send, (char *)&reply, sizeof(reply));
+    }
+    if (err_is_fail(err)) {
+        DEBUG_ERR(err, "replying to nameservice client");
+    }
+    return true;
+}
+
+// a client on this core binds to us
+static errval_t ns_accept_lmp(struct ns_server *srv, uintptr_t hdr, struct capref ep)
+{
+    errval_t err;
+
+    struct ns_lmp_client *c = malloc(sizeof(*c));
+    if (c == NULL) {
+        return LIB_ERR_MALLOC_FAIL;
+    }
+    c->srv = srv;
+    struct aos_rpc *rpc = &c->rpc;
+
+    err = aos_rpc_init(rpc);
+    if (err_is_fail(err)) {
+        return err;
+    }
+    err = lmp_chan_accept(rpc->lmp_chan, AOS_RPC_LMP_BUF_WORDS, ep);
+    if (err_is_fail(err)) {
+        return err_push(err, LIB_ERR_LMP_CHAN_ACCEPT);
+    }
+    err = lmp_chan_alloc_recv_slot(rpc->lmp_chan);
+    if (err_is_fail(err)) {
+        return err_push(err, LIB_ERR_LMP_ALLOC_RECV_SLOT);
+    }
+    err = lmp_chan_register_recv(rpc->lmp_chan, get_default_waitset(),
+                                 MKCLOSURE(ns_lmp_recv_handler, c));
+    if (err_is_fail(err)) {
+        return err_push(err, LIB_ERR_CHAN_REGISTER_RECV);
+    }
+
+    // tell the client the endpoint of its own channel
+    return aos_rpc_reply(rpc, hdr, ACK_MSG, rpc->lmp_chan->local_cap, 0);
+}
+
+// init hands us a frame set up by a client on another core
+static errval_t ns_accept_ump(struct ns_server *srv, struct capref frame)
+{
+    errval_t err;
+
+    struct ns_ump_client *c = malloc(sizeof(*c));
+    if (c == NULL) {
+        return LIB_ERR_MALLOC_FAIL;
+    }
+
+    void *buf;
+    err = paging_map_frame_attr(get_current_paging_state(), &buf, UMP_URPC_FRAME_SIZE, frame,
+                                VREGION_FLAGS_READ_WRITE);
+    if (err_is_fail(err)) {
+        free(c);
+        return err_push(err, LIB_ERR_VSPACE_MAP);
+    }
+
+    // direction 0 goes from the client to the server
+    c->srv = srv;
+    c->send = ump_frame_chan(buf, 1);
+    ump_demux_init(&c->dm, ump_frame_chan(buf, 0));
+    ump_demux_register(&c->dm, NS_RPC, ns_ump_rpc_handler, c);
+    return ump_demux_register_waitset(&c->dm, get_default_waitset());
+}
+
+// bind requests of clients, and channels from other cores handed to us by init
+static void ns_listen_handler(void *arg)
+{
+    struct lmp_recv_msg msg = LMP_RECV_MSG_INIT;
+    struct ns_server *srv = arg;
+    struct capref cap = NULL_CAP;
+    errval_t err, recv_err;
+
+    recv_err = lmp_chan_recv(&srv->listen, &msg, &cap);
+
+    err = lmp_chan_register_recv(&srv->listen, get_default_waitset(),
+                                 MKCLOSURE(ns_listen_handler, arg));
+    if (err_is_fail(err)) {
+        DEBUG_ERR(err, "re-registering nameservice listen handler");
+        return;
+    }
+    if (err_is_fail(recv_err)) {
+        if (err_no(recv_err) != LIB_ERR_NO_LMP_MSG) {
+            DEBUG_ERR(recv_err, "receiving nameservice bind request");
+        }
+        return;
+    }
+    if (capref_is_null(cap)) {
+        debug_printf("nameservice: bind request without capability\n");
+        return;
+    }
+    err = lmp_chan_alloc_recv_slot(&srv->listen);
+    if (err_is_fail(err)) {
+        DEBUG_ERR(err, "allocating new nameservice receive slot");
+    }
+
+    switch (AOS_RPC_HDR_TYPE(msg.words[0])) {
+    case NS_BIND_LMP:
+        err = ns_accept_lmp(srv, msg.words[0], cap);
+        break;
+    case NS_BIND_UMP:
+        err = ns_accept_ump(srv, cap);
+        break;
+    default:
+        debug_printf("nameservice: unexpected bind message type %d\n",
+                     AOS_RPC_HDR_TYPE(msg.words[0]));
+        return;
+    }
+    if (err_is_fail(err)) {
+        DEBUG_ERR(err, "accepting nameservice client of '%s'", srv->name);
+    }
+}
+
+
 /**
  * @brief sends a message back to the client who sent us a message
  *
@@ -29,16 +304,76 @@ errval_t nameservice_rpc(nameservice_chan_t chan, void *message, size_t bytes,
                          void **response, size_t *response_bytes,
                          struct capref tx_cap, struct capref rx_cap)
 {
-    // make compiler happy about unused parameters
-    (void)chan;
-    (void)message;
-    (void)bytes;
-    (void)response;
-    (void)response_bytes;
-    (void)tx_cap;
-    (void)rx_cap;
-
-    return LIB_ERR_NOT_IMPLEMENTED;
+    errval_t err;
+    struct ns_chan *c = chan;
+    size_t len;
+
+    if (c == NULL) {
+        return LIB_ERR_NAMESERVICE_NOT_BOUND;
+    }
+    if (bytes > AOS_RPC_BULK_SIZE) {
+        return AOS_ERR_BULK_ARGS_INVALID;
+    }
+
+    if (c->transport == AOS_RPC_LMP) {
+        struct aos_rpc_call call;
+        err = aos_rpc_call_msg(&c->rpc, NS_RPC, tx_cap, message, bytes, c->resp, &len, &call);
+        if (err_is_fail(err)) {
+            return err;
+        }
+        // the capability of the reply goes where the caller asked for it
+        if (!capref_is_null(call.cap)) {
+            if (!capref_is_null(rx_cap)) {
+                err = cap_copy(rx_cap, call.cap);
+            }
+            cap_destroy(call.cap);
+            if (err_is_fail(err)) {
+                return err_push(err, LIB_ERR_CAP_COPY);
+            }
+        }
+    } else {
+        if (!capref_is_null(tx_cap)) {
+            return MON_ERR_CAP_SEND;
+        }
+
+        struct ump_payload msg;
+        msg.type = NS_RPC;
+        msg.send_core = disp_get_core_id();
+        if (bytes > 0) {
+            err = ump_send_data(c->send, &msg, message, bytes);
+        } else {
+            msg.data_len = 0;
+            err = ump_send(c->send, (char *)&msg, sizeof(msg));
+        }
+        if (err_is_fail(err)) {
+            return err;
+        }
+
+        // the server is on another core, it is going to be a moment
+        while ((err = ump_demux_recv(&c->dm, NS_REPLY, &msg)) == LIB_ERR_NO_UMP_MSG) {
+            thread_yield();
+        }
+        if (err_is_fail(err)) {
+            return err;
+        }
+        len = MIN(msg.data_len, AOS_RPC_BULK_SIZE);
+        if (len > 0) {
+            memcpy(c->resp, ump_msg_data(c->dm.chan, &msg), len);
+        }
+        ump_msg_release(c->dm.chan, &msg);
+    }
+
+    // the response outlives the next call on the channel, and is terminated like requests
+    char *resp = malloc(len + 1);
+    if (resp == NULL) {
+        return LIB_ERR_MALLOC_FAIL;
+    }
+    memcpy(resp, c->resp, len);
+    resp[len] = '\0';
+    *response = resp;
+    *response_bytes = len;
+
+    return SYS_ERR_OK;
 }
 
 
@@ -57,12 +392,53 @@ errval_t nameservice_register(const char *name,
 	                              nameservice_receive_handler_t recv_handler,
 	                              void *st)
 {
-    // make compiler happy about unused parameters
-    (void)name;
-    (void)recv_handler;
-    (void)st;
+    errval_t err;
+
+    if (name == NULL || strlen(name) == 0 || strlen(name) >= NS_NAME_LEN) {
+        return LIB_ERR_NAMESERVICE_INVALID_NAME;
+    }
+
+    struct ns_server *srv = malloc(sizeof(*srv));
+    if (srv == NULL) {
+        return LIB_ERR_MALLOC_FAIL;
+    }
+    strncpy(srv->name, name, NS_NAME_LEN);
+    srv->recv_handler = recv_handler;
+    srv->st = st;
+
+    // clients send their bind requests here, each of them then gets a channel of its own
+    lmp_chan_init(&srv->listen);
+    err = lmp_chan_accept(&srv->listen, AOS_RPC_LMP_BUF_WORDS, NULL_CAP);
+    if (err_is_fail(err)) {
+        err = err_push(err, LIB_ERR_LMP_CHAN_ACCEPT);
+        goto fail;
+    }
+    err = lmp_chan_alloc_recv_slot(&srv->listen);
+    if (err_is_fail(err)) {
+        err = err_push(err, LIB_ERR_LMP_ALLOC_RECV_SLOT);
+        goto fail;
+    }
+    err = lmp_chan_register_recv(&srv->listen, get_default_waitset(),
+                                 MKCLOSURE(ns_listen_handler, srv));
+    if (err_is_fail(err)) {
+        err = err_push(err, LIB_ERR_CHAN_REGISTER_RECV);
+        goto fail;
+    }
+
+    err = aos_rpc_ns_register(aos_rpc_get_init_channel(), name, srv->listen.local_cap);
+    if (err_is_fail(err)) {
+        lmp_chan_deregister_recv(&srv->listen);
+        goto fail;
+    }
 
-    return LIB_ERR_NOT_IMPLEMENTED;
+    srv->next = ns_servers;
+    ns_servers = srv;
+    return SYS_ERR_OK;
+
+fail:
+    lmp_chan_destroy(&srv->listen);
+    free(srv);
+    return err;
 }
 
 
@@ -75,8 +451,26 @@ errval_t nameservice_register(const char *name,
  */
 errval_t nameservice_deregister(const char *name)
 {
-    (void)name;
-    return LIB_ERR_NOT_IMPLEMENTED;
+    errval_t err;
+
+    struct ns_server **prev = &ns_servers;
+    while (*prev != NULL && strncmp((*prev)->name, name, NS_NAME_LEN) != 0) {
+        prev = &(*prev)->next;
+    }
+    if (*prev == NULL) {
+        return LIB_ERR_NAMESERVICE_UNKNOWN_NAME;
+    }
+
+    err = aos_rpc_ns_deregister(aos_rpc_get_init_channel(), name);
+    if (err_is_fail(err)) {
+        return err;
+    }
+
+    // no new clients, the ones bound already keep their channels
+    struct ns_server *srv = *prev;
+    *prev = srv->next;
+    lmp_chan_deregister_recv(&srv->listen);
+    return SYS_ERR_OK;
 }
 
 
@@ -90,11 +484,64 @@ errval_t nameservice_deregister(const char *name)
  */
 errval_t nameservice_lookup(const char *name, nameservice_chan_t *nschan)
 {
-    // make compiler happy about unused parameters
-    (void)name;
-    (void)nschan;
+    errval_t err;
+    struct aos_rpc *init_rpc = aos_rpc_get_init_channel();
 
-    return LIB_ERR_NOT_IMPLEMENTED;
+    coreid_t core;
+    struct capref ep;
+    err = aos_rpc_ns_lookup(init_rpc, name, &core, &ep);
+    if (err_is_fail(err)) {
+        return err;
+    }
+
+    struct ns_chan *c = malloc(sizeof(*c));
+    if (c == NULL) {
+        return LIB_ERR_MALLOC_FAIL;
+    }
+
+    if (!capref_is_null(ep)) {
+        // same core: bind to the server's endpoint directly
+        c->transport = AOS_RPC_LMP;
+        err = aos_rpc_bind(&c->rpc, ep);
+        cap_destroy(ep);
+        if (err_is_fail(err)) {
+            free(c);
+            return err;
+        }
+        *nschan = c;
+        return SYS_ERR_OK;
+    }
+
+    // other core: set up a UMP channel in a frame and have init pass it on to the server
+    c->transport = AOS_RPC_UMP;
+    struct capref frame;
+    err = frame_alloc(&frame, UMP_URPC_FRAME_SIZE, NULL);
+    if (err_is_fail(err)) {
+        free(c);
+        return err_push(err, LIB_ERR_FRAME_ALLOC);
+    }
+    void *buf;
+    err = paging_map_frame_attr(get_current_paging_state(), &buf, UMP_URPC_FRAME_SIZE, frame,
+                                VREGION_FLAGS_READ_WRITE);
+    if (err_is_fail(err)) {
+        cap_destroy(frame);
+        free(c);
+        return err_push(err, LIB_ERR_VSPACE_MAP);
+    }
+    ump_frame_init(buf);
+    c->send = ump_frame_chan(buf, 0);
+    ump_demux_init(&c->dm, ump_frame_chan(buf, 1));
+
+    err = aos_rpc_ns_bind_ump(init_rpc, name, core, frame);
+    if (err_is_fail(err)) {
+        paging_unmap(get_current_paging_state(), buf);
+        cap_destroy(frame);
+        free(c);
+        return err;
+    }
+
+    *nschan = c;
+    return SYS_ERR_OK;
 }
 
 
@@ -107,9 +554,33 @@ errval_t nameservice_lookup(const char *name, nameservice_chan_t *nschan)
  */
 errval_t nameservice_enumerate(char *query, size_t *num, char ***result)
 {
-    // make compiler happy about unused parameters
-    (void)query;
-    (void)num;
-    (void)result;
-    return LIB_ERR_NOT_IMPLEMENTED;
+    errval_t err;
+
+    struct ns_frame_output *out = malloc(AOS_RPC_BULK_SIZE);
+    if (out == NULL) {
+        return LIB_ERR_MALLOC_FAIL;
+    }
+    err = aos_rpc_ns_enumerate(aos_rpc_get_init_channel(), query, out);
+    if (err_is_fail(err)) {
+        free(out);
+        return err;
+    }
+
+    char **names = malloc(MAX(out->num, 1) * sizeof(char *));
+    if (names == NULL) {
+        free(out);
+        return LIB_ERR_MALLOC_FAIL;
+    }
+    const char *end = (char *)out + AOS_RPC_BULK_SIZE;
+    const char *name = out->names;
+    size_t n = 0;
+    while (n < out->num && name < end) {
+        names[n++] = strndup(name, end - name);
+        name += strnlen(name, end - name) + 1;
+    }
+    free(out);
+
+    *num = n;
+    *result = names;
+    return SYS_ERR_OK;
 }
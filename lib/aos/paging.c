@@ -101,6 +101,7 @@ errval_t paging_init_state(struct paging_state *st, lvaddr_t start_vaddr, struct
     st->current_vaddr = start_vaddr;
     st->start_vaddr = start_vaddr;
     st->slot_alloc = ca;
+    thread_mutex_init(&st->mutex);
    
     // initialize a slab allocator to give us our memory
     slab_init(&st->ma, sizeof(struct pageTable), NULL);
@@ -145,6 +146,7 @@ errval_t paging_init_state_foreign(struct paging_state *st, lvaddr_t start_vaddr
     st->current_vaddr = start_vaddr;
     st->start_vaddr = start_vaddr;
     st->slot_alloc = ca;
+    thread_mutex_init(&st->mutex);
    
     // initialize a slab allocator to give us our memory
     slab_init(&st->ma, sizeof(struct pageTable), NULL);
@@ -236,7 +238,8 @@ errval_t paging_init_onthread(struct thread *t)
  *
  * @return Either SYS_ERR_OK if no error occured or an error indicating what went wrong otherwise.
  */
-errval_t paging_alloc(struct paging_state *st, void **buf, size_t bytes, size_t alignment)
+static errval_t paging_alloc_locked(struct paging_state *st, void **buf, size_t bytes,
+                                   size_t alignment)
 {
     /**
      * TODO(M1):
@@ -308,6 +311,14 @@ errval_t paging_alloc(struct paging_state *st, void **buf, size_t bytes, size_t
     return SYS_ERR_OK;
 }
 
+errval_t paging_alloc(struct paging_state *st, void **buf, size_t bytes, size_t alignment)
+{
+    thread_mutex_lock_nested(&st->mutex);
+    errval_t err = paging_alloc_locked(st, buf, bytes, alignment);
+    thread_mutex_unlock(&st->mutex);
+    return err;
+}
+
 
 errval_t mapNewPT(struct paging_state *st, capaddr_t slot, 
                   uint64_t offset, uint64_t pte_ct, enum objtype type, struct pageTable *parent) {
@@ -366,8 +377,8 @@ errval_t mapNewPT(struct paging_state *st, capaddr_t slot,
  *
  * @return SYS_ERR_OK on sucecss, LIB_ERR_* on failure.
  */
-errval_t paging_map_frame_attr_offset(struct paging_state *st, void **buf, size_t bytes,
-                                      struct capref frame, size_t offset, int flags)
+static errval_t paging_map_frame_attr_offset_locked(struct paging_state *st, void **buf,
+                                                   size_t bytes, struct capref frame, size_t offset, int flags)
 {
     errval_t err;
     // TODO(M1):
@@ -407,6 +418,15 @@ errval_t paging_map_frame_attr_offset(struct paging_state *st, void **buf, size_
     return SYS_ERR_OK;
 }
 
+errval_t paging_map_frame_attr_offset(struct paging_state *st, void **buf, size_t bytes,
+                                      struct capref frame, size_t offset, int flags)
+{
+    thread_mutex_lock_nested(&st->mutex);
+    errval_t err = paging_map_frame_attr_offset_locked(st, buf, bytes, frame, offset, flags);
+    thread_mutex_unlock(&st->mutex);
+    return err;
+}
+
 /**
  * @brief maps a frame at a user-provided virtual address region
  *
@@ -422,8 +442,9 @@ errval_t paging_map_frame_attr_offset(struct paging_state *st, void **buf, size_
  * The region at which the frame is requested to be mapped must be free (i.e., hasn't been
  * allocated), otherwise the mapping request shoud fail.
  */
-errval_t paging_map_fixed_attr_offset(struct paging_state *st, lvaddr_t vaddr, struct capref frame,
-                                      size_t bytes, size_t offset, int flags)
+static errval_t paging_map_fixed_attr_offset_locked(struct paging_state *st, lvaddr_t vaddr,
+                                                   struct capref frame, size_t bytes,
+                                                   size_t offset, int flags)
 {
     errval_t err;
     int numMapped;
@@ -535,6 +556,15 @@ errval_t paging_map_fixed_attr_offset(struct paging_state *st, lvaddr_t vaddr, s
     return SYS_ERR_OK;
 }
 
+errval_t paging_map_fixed_attr_offset(struct paging_state *st, lvaddr_t vaddr, struct capref frame,
+                                      size_t bytes, size_t offset, int flags)
+{
+    thread_mutex_lock_nested(&st->mutex);
+    errval_t err = paging_map_fixed_attr_offset_locked(st, vaddr, frame, bytes, offset, flags);
+    thread_mutex_unlock(&st->mutex);
+    return err;
+}
+
 
 /**
  * @brief Unmaps the region starting at the supplied pointer.
@@ -546,7 +576,7 @@ errval_t paging_map_fixed_attr_offset(struct paging_state *st, lvaddr_t vaddr, s
  *
  * The supplied `region` must be the start of a previously mapped frame.
  */
-errval_t paging_unmap(struct paging_state *st, const void *region)
+static errval_t paging_unmap_locked(struct paging_state *st, const void *region)
 {
     // make compiler happy about unused parameters
     (void)st;
@@ -602,3 +632,11 @@ errval_t paging_unmap(struct paging_state *st, const void *region)
     }
     return SYS_ERR_OK;
 }
+
+errval_t paging_unmap(struct paging_state *st, const void *region)
+{
+    thread_mutex_lock_nested(&st->mutex);
+    errval_t err = paging_unmap_locked(st, region);
+    thread_mutex_unlock(&st->mutex);
+    return err;
+}
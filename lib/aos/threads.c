@@ -66,6 +66,36 @@ static struct slab_allocator thread_slabs;
 static spinlock_t thread_slabs_spinlock;
 static struct thread_mutex thread_slabs_mutex = THREAD_MUTEX_INITIALIZER;
 
+/// Number of distinct stack sizes cached by the stack pool
+#define STACK_POOL_BUCKETS 4
+
+/// Default maximum number of cached stacks per bucket
+#define STACK_POOL_DEFAULT_CAP 16
+
+/// Maximum number of recycled TCB slab blocks kept around
+#define TCB_RECYCLE_MAX 32
+
+/// A free stack in the pool; the link lives in the (unused) stack memory itself
+struct stack_pool_entry {
+    struct stack_pool_entry *next;
+};
+
+/// Free list of stacks of one particular size
+struct stack_pool_bucket {
+    size_t                   stacksize;     ///< Stack size of this bucket, 0 if unused
+    size_t                   count;         ///< Number of stacks on the free list
+    struct stack_pool_entry *free;          ///< Free list of stacks
+};
+
+/// Pool of reusable thread stacks, bucketed by size
+static struct stack_pool_bucket stack_pool[STACK_POOL_BUCKETS];
+static size_t stack_pool_cap = STACK_POOL_DEFAULT_CAP;
+static spinlock_t stack_pool_spinlock;
+
+/// Recycled TCB + TLS slab blocks (chained through thread->next)
+static struct thread *tcb_recycle_list;
+static size_t tcb_recycle_count;
+
 /// Base and size of the original ("pristine") thread-local storage init data
 static void *tls_block_init_base;
 static size_t tls_block_init_len;
@@ -298,6 +328,179 @@ void thread_run_disabled(dispatcher_handle_t handle)
     }
 }
 
+/// Returns the pool bucket for stacks of the given size, creating it if needed
+static struct stack_pool_bucket *stack_pool_bucket(size_t stacksize, bool create)
+{
+    struct stack_pool_bucket *unused = NULL;
+    for (int i = 0; i < STACK_POOL_BUCKETS; i++) {
+        if (stack_pool[i].stacksize == stacksize) {
+            return &stack_pool[i];
+        }
+        if (unused == NULL && stack_pool[i].stacksize == 0) {
+            unused = &stack_pool[i];
+        }
+    }
+    if (create && unused != NULL) {
+        unused->stacksize = stacksize;
+        unused->count = 0;
+        unused->free = NULL;
+        return unused;
+    }
+    return NULL;
+}
+
+/// Takes a stack of the given size from the pool, falls back to malloc()
+static void *stack_pool_alloc(size_t stacksize)
+{
+    void *stack = NULL;
+
+    acquire_spinlock(&stack_pool_spinlock);
+    struct stack_pool_bucket *b = stack_pool_bucket(stacksize, false);
+    if (b != NULL && b->free != NULL) {
+        stack = b->free;
+        b->free = b->free->next;
+        b->count--;
+    }
+    release_spinlock(&stack_pool_spinlock);
+
+    if (stack == NULL) {
+        stack = malloc(stacksize);
+    }
+    return stack;
+}
+
+/// Returns a stack to the pool, or frees it if its bucket is full
+static void stack_pool_free(void *stack, size_t stacksize)
+{
+    if (stack == NULL) {
+        return;
+    }
+
+    acquire_spinlock(&stack_pool_spinlock);
+    struct stack_pool_bucket *b = stack_pool_bucket(stacksize, true);
+    if (b != NULL && b->count < stack_pool_cap) {
+        struct stack_pool_entry *e = stack;
+        e->next = b->free;
+        b->free = e;
+        b->count++;
+        stack = NULL;
+    }
+    release_spinlock(&stack_pool_spinlock);
+
+    if (stack != NULL) {
+        free(stack);
+    }
+}
+
+/**
+ * \brief Sets the maximum number of cached stacks per stack size
+ *
+ * Stacks beyond the new cap are released back to the heap.
+ *
+ * \param cap  maximum number of stacks kept per bucket, 0 disables the pool
+ */
+void thread_stack_pool_set_cap(size_t cap)
+{
+    struct stack_pool_entry *release = NULL;
+
+    acquire_spinlock(&stack_pool_spinlock);
+    stack_pool_cap = cap;
+    for (int i = 0; i < STACK_POOL_BUCKETS; i++) {
+        struct stack_pool_bucket *b = &stack_pool[i];
+        while (b->count > cap) {
+            struct stack_pool_entry *e = b->free;
+            b->free = e->next;
+            b->count--;
+            e->next = release;
+            release = e;
+        }
+    }
+    release_spinlock(&stack_pool_spinlock);
+
+    while (release != NULL) {
+        struct stack_pool_entry *e = release;
+        release = e->next;
+        free(e);
+    }
+}
+
+/**
+ * \brief Pre-allocates stacks so that later thread creation avoids the heap
+ *
+ * \param stacksize  size of the stacks to allocate, in bytes
+ * \param count      number of stacks to add to the pool (bounded by the cap)
+ *
+ * \returns SYS_ERR_OK on success, LIB_ERR_MALLOC_FAIL if a stack could not be allocated
+ */
+errval_t thread_stack_pool_prewarm(size_t stacksize, size_t count)
+{
+    assert((stacksize % sizeof(uintptr_t)) == 0);
+
+    for (size_t i = 0; i < count; i++) {
+        acquire_spinlock(&stack_pool_spinlock);
+        struct stack_pool_bucket *b = stack_pool_bucket(stacksize, true);
+        bool full = (b == NULL || b->count >= stack_pool_cap);
+        release_spinlock(&stack_pool_spinlock);
+        if (full) {
+            break;
+        }
+
+        void *stack = malloc(stacksize);
+        if (stack == NULL) {
+            return LIB_ERR_MALLOC_FAIL;
+        }
+        stack_pool_free(stack, stacksize);
+    }
+
+    return SYS_ERR_OK;
+}
+
+/// Takes a recycled TCB slab block, or allocates a new one from the thread slab
+static void *tcb_alloc(struct tls_dtv **dtv)
+{
+    void *space = NULL;
+    *dtv = NULL;
+
+    // no mutex as it may deadlock: see comment for thread_slabs_spinlock
+    acquire_spinlock(&thread_slabs_spinlock);
+    if (tcb_recycle_list != NULL) {
+        struct thread *old = tcb_recycle_list;
+        tcb_recycle_list = old->next;
+        tcb_recycle_count--;
+        space = old->slab;
+        *dtv = old->tls_dtv;
+    } else {
+        space = slab_alloc(&thread_slabs);
+    }
+    release_spinlock(&thread_slabs_spinlock);
+
+    return space;
+}
+
+/// Returns a TCB to the recycle list, or its slab block to the thread slab
+static void tcb_free(struct thread *thread)
+{
+    struct tls_dtv *dtv = thread->tls_dtv;
+
+    thread_mutex_lock(&thread_slabs_mutex);
+    acquire_spinlock(&thread_slabs_spinlock);
+    if (tcb_recycle_count < TCB_RECYCLE_MAX) {
+        // the recycled TCB keeps its own heap-allocated TLS vector for the next thread
+        thread->next = tcb_recycle_list;
+        tcb_recycle_list = thread;
+        tcb_recycle_count++;
+        dtv = NULL;
+    } else {
+        slab_free(&thread_slabs, thread->slab); // frees thread itself
+    }
+    release_spinlock(&thread_slabs_spinlock);
+    thread_mutex_unlock(&thread_slabs_mutex);
+
+    if (dtv != NULL) {
+        free(dtv);
+    }
+}
+
 /** Free all heap/slab-allocated state associated with a thread */
 static void free_thread(struct thread *thread)
 {
@@ -317,16 +520,10 @@ static void free_thread(struct thread *thread)
     ldt_free_segment(thread->thread_seg_selector);
 #endif
 
-    free(thread->stack);
-    if (thread->tls_dtv != NULL) {
-        free(thread->tls_dtv);
-    }
+    stack_pool_free(thread->stack, thread->stack_bytes);
+    thread->stack = NULL;
 
-    thread_mutex_lock(&thread_slabs_mutex);
-    acquire_spinlock(&thread_slabs_spinlock);
-    slab_free(&thread_slabs, thread->slab); // frees thread itself
-    release_spinlock(&thread_slabs_spinlock);
-    thread_mutex_unlock(&thread_slabs_mutex);
+    tcb_free(thread);
 }
 
 #define ALIGN_PTR(ptr, alignment) ((((uintptr_t)(ptr)) + (alignment) - 1) & ~((alignment) - 1))
@@ -343,22 +540,18 @@ static void free_thread(struct thread *thread)
 struct thread *thread_create_unrunnable(thread_func_t start_func, void *arg,
                                         size_t stacksize)
 {
-    // allocate stack
+    // allocate stack, preferably from the stack pool
     assert((stacksize % sizeof(uintptr_t)) == 0);
-    void *stack = malloc(stacksize);
+    void *stack = stack_pool_alloc(stacksize);
     if (stack == NULL) {
         return NULL;
     }
 
-    // allocate space for TCB + initial TLS data
-    // no mutex as it may deadlock: see comment for thread_slabs_spinlock
-    // thread_mutex_lock(&thread_slabs_mutex);
-    acquire_spinlock(&thread_slabs_spinlock);
-    void *space = slab_alloc(&thread_slabs);
-    release_spinlock(&thread_slabs_spinlock);
-    // thread_mutex_unlock(&thread_slabs_mutex);
+    // allocate space for TCB + initial TLS data, preferably a recycled one
+    struct tls_dtv *recycled_dtv;
+    void *space = tcb_alloc(&recycled_dtv);
     if (space == NULL) {
-        free(stack);
+        stack_pool_free(stack, stacksize);
         return NULL;
     }
 
@@ -381,8 +574,11 @@ struct thread *thread_create_unrunnable(thread_func_t start_func, void *arg,
         memset((char *)tls_data + tls_block_init_len, 0,
                tls_block_total_len - tls_block_init_len);
 
-        // create a TLS thread vector
-        struct tls_dtv *dtv = malloc(sizeof(struct tls_dtv) + 1 * sizeof(void *));
+        // create a TLS thread vector, unless the recycled TCB still has one
+        struct tls_dtv *dtv = recycled_dtv;
+        if (dtv == NULL) {
+            dtv = malloc(sizeof(struct tls_dtv) + 1 * sizeof(void *));
+        }
         assert(dtv != NULL);
 
         dtv->gen = 0;
@@ -396,14 +592,16 @@ struct thread *thread_create_unrunnable(thread_func_t start_func, void *arg,
     errval_t err = ldt_alloc_segment(newthread, &newthread->thread_seg_selector);
     if (err_is_fail(err)) {
         DEBUG_ERR(err, "error allocating LDT segment for new thread");
+        newthread->stack = stack;
+        newthread->stack_bytes = stacksize;
         free_thread(newthread);
-        free(stack);
         return NULL;
     }
 #endif
 
     // init stack
     newthread->stack = stack;
+    newthread->stack_bytes = stacksize;
     newthread->stack_top = (char *)stack + stacksize;
 
     // waste space for alignment, if malloc gave us an unaligned stack
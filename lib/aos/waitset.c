@@ -23,6 +23,7 @@
 #include <aos/waitset_chan.h>
 #include <aos/threads.h>
 #include <aos/dispatch.h>
+#include <aos/aos_rpc.h>
 #include "threads_priv.h"
 #include "waitset_chan_priv.h"
 #include <stdio.h>
@@ -217,8 +218,7 @@ void poll_channels_disabled(dispatcher_handle_t handle) {
         bool chan_ready = false;
         switch (chan->chantype) {
             case CHANTYPE_UMP_IN:
-                // TODO: To add UMP channel support to waitsets,
-                // set chan_ready to true here if channel has a message ready
+                chan_ready = ump_demux_poll_disabled(chan);
                 break;
             default:
                 assert_disabled(!ws_chantype_is_polled(chan->chantype));
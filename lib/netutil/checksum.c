@@ -1,48 +1,283 @@
+#include <stddef.h>
+#include <string.h>
+
 #include <netutil/checksum.h>
 #include <netutil/htons.h>
 
+/*
+ * All sums below are Internet (ones' complement) sums of 16-bit words taken
+ * in host byte order. RFC 1071 shows such a sum is the byte-swapped network
+ * order sum, so the folded result can be stored into a header as is, which
+ * is what the original byte-at-a-time lwIP code achieved with its final
+ * htons(). Summing in host order lets us add whole machine words: every
+ * 2^16 carry out of a 16-bit lane is worth exactly 1 in ones' complement
+ * arithmetic, so a 32- or 64-bit accumulator only needs folding at the end.
+ */
+
+/* Fold a 64-bit accumulator into 16 bits with end-around carry. */
+static inline uint32_t
+csum_fold64(uint64_t acc)
+{
+  acc = (acc >> 32) + (acc & 0xffffffffUL);
+  acc = (acc >> 32) + (acc & 0xffffffffUL);
+  acc = (acc >> 16) + (acc & 0xffffUL);
+  acc = (acc >> 16) + (acc & 0xffffUL);
+  return (uint32_t)acc;
+}
+
+static inline uint16_t
+csum_swap16(uint32_t sum)
+{
+  return (uint16_t)(((sum & 0xff) << 8) | ((sum >> 8) & 0xff));
+}
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+
+typedef uint32_t csum_u32x4 __attribute__((vector_size(16)));
+typedef uint64_t csum_u64x2 __attribute__((vector_size(16)));
+
+/* Bytes per iteration of the SIMD loop */
+#define CSUM_SIMD_BLOCK     64
+/* Iterations before the 32-bit lanes are widened (each grows <= 2^18) */
+#define CSUM_SIMD_FLUSH     8192
+
+/*
+ * Sum len (a multiple of CSUM_SIMD_BLOCK) bytes with UADALP, which adds
+ * adjacent 16-bit lanes into 32-bit accumulators. Uses the vector extension
+ * types with inline assembly, as no arm_neon.h is available to us.
+ */
+static uint64_t
+csum_simd(const uint8_t *p, size_t len)
+{
+  csum_u64x2 wide = { 0, 0 };
+
+  while (len > 0) {
+    csum_u32x4 a0 = { 0, 0, 0, 0 };
+    csum_u32x4 a1 = { 0, 0, 0, 0 };
+    size_t iters = len / CSUM_SIMD_BLOCK;
+    if (iters > CSUM_SIMD_FLUSH) {
+      iters = CSUM_SIMD_FLUSH;
+    }
+    len -= iters * CSUM_SIMD_BLOCK;
+
+    __asm volatile(
+        "1:\n"
+        "ld1    {v16.8h, v17.8h, v18.8h, v19.8h}, [%[p]], #64\n"
+        "uadalp %[a0].4s, v16.8h\n"
+        "uadalp %[a1].4s, v17.8h\n"
+        "uadalp %[a0].4s, v18.8h\n"
+        "uadalp %[a1].4s, v19.8h\n"
+        "subs   %[n], %[n], #1\n"
+        "b.ne   1b\n"
+        "uadalp %[w].2d, %[a0].4s\n"
+        "uadalp %[w].2d, %[a1].4s\n"
+        : [p] "+r" (p), [n] "+r" (iters), [a0] "+w" (a0), [a1] "+w" (a1),
+          [w] "+w" (wide)
+        :
+        : "v16", "v17", "v18", "v19", "cc", "memory");
+  }
+
+  /* Lanes are below 2^35, so the sum of both cannot overflow */
+  return wide[0] + wide[1];
+}
+
+#endif
+
+/*
+ * Host-order Internet sum of len bytes at p, added to acc. The result is
+ * not folded. Reads are aligned so this is safe under -mstrict-align.
+ */
+static uint64_t
+csum_words(const uint8_t *p, size_t len, uint64_t acc)
+{
+  int odd = (uintptr_t)p & 1;
+  uint64_t sum = 0;
+
+  if (len == 0) {
+    return acc;
+  }
 
-static uint16_t
-lwip_standard_chksum(void *dataptr, uint16_t len)
-{
-  uint32_t acc;
-  uint16_t src;
-  uint8_t *octetptr;
-
-  acc = 0;
-  /* dataptr may be at odd or even addresses */
-  octetptr = (uint8_t*)dataptr;
-  while (len > 1) {
-    /* declare first octet as most significant
-       thus assume network order, ignoring host order */
-    src = (*octetptr) << 8;
-    octetptr++;
-    /* declare second octet as least significant */
-    src |= (*octetptr);
-    octetptr++;
-    acc += src;
+  /*
+   * Start on an odd address: that byte is the high half of the aligned
+   * host-order word it lives in. Sum everything from here on in that
+   * alignment and swap the two halves of the folded result at the end.
+   */
+  if (odd) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    sum += (uint32_t)*p << 8;
+#else
+    sum += *p;
+#endif
+    p++;
+    len--;
+  }
+
+  /* Up to 8-byte alignment in 16-bit steps */
+  while (len >= 2 && ((uintptr_t)p & 7) != 0) {
+    sum += *(const uint16_t *)p;
+    p += 2;
+    len -= 2;
+  }
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+  if (len >= CSUM_SIMD_BLOCK) {
+    size_t bulk = len & ~(size_t)(CSUM_SIMD_BLOCK - 1);
+    sum += csum_simd(p, bulk);
+    p += bulk;
+    len -= bulk;
+  }
+#endif
+
+  /*
+   * 32 bytes per iteration, split into 32-bit halves so the accumulator
+   * cannot overflow for any realistic length.
+   */
+  while (len >= 32) {
+    const uint64_t *w = (const uint64_t *)p;
+    sum += (uint32_t)w[0];
+    sum += w[0] >> 32;
+    sum += (uint32_t)w[1];
+    sum += w[1] >> 32;
+    sum += (uint32_t)w[2];
+    sum += w[2] >> 32;
+    sum += (uint32_t)w[3];
+    sum += w[3] >> 32;
+    p += 32;
+    len -= 32;
+  }
+  while (len >= 8) {
+    uint64_t w = *(const uint64_t *)p;
+    sum += (uint32_t)w;
+    sum += w >> 32;
+    p += 8;
+    len -= 8;
+  }
+  while (len >= 2) {
+    sum += *(const uint16_t *)p;
+    p += 2;
     len -= 2;
   }
+
+  /* A trailing odd byte is the first half of a zero-padded word */
   if (len > 0) {
-    /* accumulate remaining octet */
-    src = (*octetptr) << 8;
-    acc += src;
-  }
-  /* add deferred carry bits */
-  acc = (acc >> 16) + (acc & 0x0000ffffUL);
-  if ((acc & 0xffff0000UL) != 0) {
-    acc = (acc >> 16) + (acc & 0x0000ffffUL);
-  }
-  /* This maybe a little confusing: reorder sum using htons()
-     instead of ntohs() since it has a little less call overhead.
-     The caller must invert bits for Internet sum ! */
-  return htons((uint16_t)acc);
-};
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    sum += *p;
+#else
+    sum += (uint32_t)*p << 8;
+#endif
+  }
+
+  if (odd) {
+    return acc + csum_swap16(csum_fold64(sum));
+  }
+  return acc + csum_fold64(sum);
+}
 
 /**
  * Calculate a short such that ret + dataptr[..] becomes 0
  */
 uint16_t inet_checksum(void *dataptr, uint16_t len)
 {
-  return ~lwip_standard_chksum(dataptr, len);
+  return inet_checksum_fold(inet_checksum_partial(dataptr, len, 0));
 };
+
+uint32_t inet_checksum_partial(const void *data, size_t len, uint32_t sum)
+{
+  return csum_fold64(csum_words(data, len, sum));
+}
+
+uint16_t inet_checksum_fold(uint32_t sum)
+{
+  return (uint16_t)~csum_fold64(sum);
+}
+
+/*
+ * RFC 1624, eqn. 3: HC' = ~(~HC + ~m + m'). Unlike the RFC 1141 form this
+ * never produces 0x0000 from a non-zero field.
+ */
+uint16_t inet_checksum_update16(uint16_t check, uint16_t old_word,
+                                uint16_t new_word)
+{
+  uint32_t sum = (uint16_t)~check;
+  sum += (uint16_t)~old_word;
+  sum += new_word;
+  return (uint16_t)~csum_fold64(sum);
+}
+
+uint16_t inet_checksum_update32(uint16_t check, uint32_t old_word,
+                                uint32_t new_word)
+{
+  uint32_t sum = (uint16_t)~check;
+  sum += (uint16_t)~old_word;
+  sum += (uint16_t)~(old_word >> 16);
+  sum += new_word & 0xffff;
+  sum += new_word >> 16;
+  return (uint16_t)~csum_fold64(sum);
+}
+
+uint32_t inet_checksum_copy_partial(void *dst, const void *src, size_t len,
+                                    uint32_t sum)
+{
+  const uint8_t *s = src;
+  uint8_t *d = dst;
+  uint64_t acc = 0;
+
+  /*
+   * The single-pass loop needs source and destination to share their
+   * alignment; otherwise copy first and sum the (now cache-hot) copy.
+   */
+  if ((((uintptr_t)s ^ (uintptr_t)d) & 7) != 0 || len < 64) {
+    memcpy(dst, src, len);
+    return inet_checksum_partial(dst, len, sum);
+  }
+
+  /* Bring both to 8-byte alignment, summing the head separately */
+  size_t head = (8 - ((uintptr_t)s & 7)) & 7;
+  if (head > 0) {
+    memcpy(d, s, head);
+    acc = csum_words(s, head, 0);
+    s += head;
+    d += head;
+    len -= head;
+  }
+
+  uint64_t body = 0;
+  while (len >= 32) {
+    const uint64_t *sw = (const uint64_t *)s;
+    uint64_t *dw = (uint64_t *)d;
+    uint64_t w0 = sw[0], w1 = sw[1], w2 = sw[2], w3 = sw[3];
+    dw[0] = w0;
+    dw[1] = w1;
+    dw[2] = w2;
+    dw[3] = w3;
+    body += (uint32_t)w0;
+    body += w0 >> 32;
+    body += (uint32_t)w1;
+    body += w1 >> 32;
+    body += (uint32_t)w2;
+    body += w2 >> 32;
+    body += (uint32_t)w3;
+    body += w3 >> 32;
+    s += 32;
+    d += 32;
+    len -= 32;
+  }
+  if (len > 0) {
+    memcpy(d, s, len);
+    body = csum_words(s, len, body);
+  }
+
+  /* An odd-length head leaves the body at an odd offset in the packet */
+  if (head & 1) {
+    acc += csum_swap16(csum_fold64(body));
+  } else {
+    acc += body;
+  }
+
+  return csum_fold64(acc + sum);
+}
+
+uint16_t inet_checksum_copy(void *dst, const void *src, uint16_t len)
+{
+  return inet_checksum_fold(inet_checksum_copy_partial(dst, src, len, 0));
+}
@@ -621,7 +621,8 @@ errval_t spawn_setup_ipc(struct spawninfo *si, struct waitset *ws, aos_recv_hand
     }
     err = aos_rpc_init(rpc);
     DEBUG_ERR_ON_FAIL(err, "could not init rpc channel\n");
-    err = lmp_chan_accept(rpc->lmp_chan, DEFAULT_LMP_BUF_WORDS, cap_initep);
+    rpc->pid = si->pid;
+    err = lmp_chan_accept(rpc->lmp_chan, AOS_RPC_LMP_BUF_WORDS, cap_initep);
     DEBUG_ERR_ON_FAIL(err, "could not open channel to accept child's init endpoint\n");
 
     // give the child init's endpoint
@@ -631,6 +632,22 @@ errval_t spawn_setup_ipc(struct spawninfo *si, struct waitset *ws, aos_recv_hand
     err = cap_copy(cap_initep_child, rpc->lmp_chan->local_cap); 
     DEBUG_ERR_ON_FAIL(err, "copying parent's self endpoint to INITEP slot in child taskcnode\n");
 
+    // set up the bulk frame shared with the child, mapped once on either side for its lifetime
+    struct capref bulk_frame;
+    err = frame_alloc(&bulk_frame, AOS_RPC_BULK_FRAME_SIZE, NULL);
+    if (err_is_fail(err)) {
+        return err_push(err, LIB_ERR_FRAME_ALLOC);
+    }
+    err = aos_rpc_bulk_map(rpc, bulk_frame);
+    if (err_is_fail(err)) {
+        return err;
+    }
+    struct capref cap_bulk_child;
+    cap_bulk_child.cnode = si->child_selfep.cnode;  // child_task_cnode
+    cap_bulk_child.slot = TASKCN_SLOT_BULK;
+    err = cap_copy(cap_bulk_child, bulk_frame);
+    DEBUG_ERR_ON_FAIL(err, "copying bulk frame to BULK slot in child taskcnode\n");
+
     // initialize the messaging channel for the process
     err = lmp_chan_alloc_recv_slot(rpc->lmp_chan);
     DEBUG_ERR_ON_FAIL(err, "allocating receive slot for lmp channel\n");
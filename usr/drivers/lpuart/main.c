@@ -119,3 +119,16 @@ errval_t lpuart_putchar(struct lpuart_s *s, char c)
     lpuart_txdata_wr(u, c);
     return SYS_ERR_OK;
 }
+
+errval_t lpuart_write(struct lpuart_s *s, const char *buf, size_t len)
+{
+    lpuart_t *u = &s->dev;
+    assert(u->base != 0);
+
+    for (size_t i = 0; i < len; i++) {
+        while (lpuart_stat_tdre_rdf(u) == 0)
+            ;
+        lpuart_txdata_wr(u, buf[i]);
+    }
+    return SYS_ERR_OK;
+}
@@ -130,3 +130,17 @@ errval_t pl011_putchar(struct pl011_s *s, char c)
 
     return SYS_ERR_OK;
 }
+
+errval_t pl011_write(struct pl011_s *s, const char *buf, size_t len)
+{
+    pl011_uart_t *u = &s->dev;
+    assert(u->base != 0);
+
+    for (size_t i = 0; i < len; i++) {
+        while (pl011_uart_FR_txff_rdf(u) == 1)
+            ;
+        pl011_uart_DR_rawwr(u, buf[i]);
+    }
+
+    return SYS_ERR_OK;
+}
@@ -406,16 +406,19 @@ errval_t coreboot_boot_core(hwid_t mpid, const char *boot_driver, const char *cp
     init_mem.base = init_cap.u.ram.base;
     init_mem.length = init_cap.u.ram.bytes;
 
-    // allocate space (3 pages) for the URPC frame
+    // allocate space for the URPC frame, bootinfo and the UMP channels to the new core
     struct armv8_coredata_memreg urpc_mem;
     struct capref urpc_frame;
-    err = frame_alloc(&urpc_frame, 3 * BASE_PAGE_SIZE, NULL);
+    err = frame_alloc(&urpc_frame, UMP_URPC_FRAME_SIZE, NULL);
     DEBUG_ERR_ON_FAIL(err, "couldn't allocate space to urpc frame\n");
     struct capability urpc_cap;
     void *urpc_buf;
-    err = paging_map_frame_attr(get_current_paging_state(), &urpc_buf, 3 * BASE_PAGE_SIZE, urpc_frame, VREGION_FLAGS_READ_WRITE);
+    err = paging_map_frame_attr(get_current_paging_state(), &urpc_buf, UMP_URPC_FRAME_SIZE, urpc_frame, VREGION_FLAGS_READ_WRITE);
     DEBUG_ERR_ON_FAIL(err, "couldn't map urpc frame\n");
     global_urpc_frames[(uint64_t)mpid] = (genvaddr_t)urpc_buf;
+
+    // the core waits for the bsp to set this up, make sure it doesn't see anything stale
+    memset(urpc_buf + UMP_URPC_MESH_OFFSET, 0, sizeof(struct ump_mesh_info));
     err = cap_direct_identify(urpc_frame, &urpc_cap);
     urpc_mem.base = urpc_cap.u.frame.base;
     urpc_mem.length = urpc_cap.u.frame.bytes;
@@ -0,0 +1,119 @@
+/**
+ * \file
+ * \brief Sending capabilities to init on another core
+ *
+ * Follows the monitor's captx code in Barrelfish, but synchronously, as the caller already
+ * waits for the reply of the other core.
+ */
+
+/*
+ * Copyright (c) 2023, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#include <string.h>
+
+#include <aos/aos.h>
+#include "distops/captx.h"
+#include "distops/invocations.h"
+#include "distops/debug.h"
+#include "distops/domcap.h"
+
+errval_t captx_prepare_send(struct capref cap, coreid_t dest, struct ump_cap *tx)
+{
+    errval_t err;
+
+    assert(tx != NULL);
+    DEBUG_CAPOPS("captx_prepare_send to core %d\n", dest);
+
+    memset(tx, 0, sizeof(*tx));
+    tx->raw.type = ObjType_Null;
+    if (capref_is_null(cap)) {
+        return SYS_ERR_OK;
+    }
+
+    // a cap that is being deleted or revoked can't be copied meanwhile
+    distcap_state_t state;
+    err = dom_cnode_get_state(get_cap_domref(cap), &state);
+    if (err_is_fail(err)) {
+        return err_push(err, MON_ERR_CAP_SEND);
+    }
+    if (distcap_state_is_busy(state)) {
+        return MON_ERR_REMOTE_CAP_RETRY;
+    }
+
+    err = monitor_cap_identify(cap, &tx->raw);
+    if (err_is_fail(err)) {
+        return err_push(err, MON_ERR_CAP_IDENTIFY);
+    }
+    if (!monitor_can_send_cap(&tx->raw)) {
+        return MON_ERR_CAP_SEND;
+    }
+
+    err = monitor_get_cap_owner(cap_root, get_cap_addr(cap), get_cap_level(cap), &tx->owner);
+    if (err_is_fail(err)) {
+        return err_push(err, MON_ERR_CAP_SEND);
+    }
+
+    // the owner has to know about every copy on another core
+    if (tx->owner == disp_get_core_id() && tx->owner != dest) {
+        err = monitor_remote_relations(cap, RRELS_COPY_BIT, RRELS_COPY_BIT, NULL);
+        if (err_is_fail(err)) {
+            return err_push(err, MON_ERR_CAP_SEND);
+        }
+    }
+
+    return SYS_ERR_OK;
+}
+
+errval_t captx_handle_recv(struct ump_cap *tx, struct capref *cap)
+{
+    errval_t err;
+
+    assert(tx != NULL && cap != NULL);
+    DEBUG_CAPOPS("captx_handle_recv from owner %d\n", tx->owner);
+
+    if (tx->raw.type == ObjType_Null) {
+        *cap = NULL_CAP;
+        return SYS_ERR_OK;
+    }
+
+    err = slot_alloc(cap);
+    if (err_is_fail(err)) {
+        return err_push(err, LIB_ERR_SLOT_ALLOC);
+    }
+
+    // join the copies that already exist here, if any
+    err = monitor_copy_if_exists(&tx->raw, *cap);
+    if (err_is_ok(err)) {
+        return SYS_ERR_OK;
+    }
+    if (err_no(err) != SYS_ERR_CAP_NOT_FOUND) {
+        goto out_free;
+    }
+    if (tx->owner == disp_get_core_id()) {
+        // all copies on the owning core have been deleted since the cap was sent
+        goto out_free;
+    }
+
+    err = monitor_cap_create(*cap, &tx->raw, tx->owner);
+    if (err_is_fail(err)) {
+        goto out_free;
+    }
+
+    // the first copy on this core, the others are elsewhere
+    err = monitor_remote_relations(*cap, RRELS_COPY_BIT, RRELS_COPY_BIT, NULL);
+    if (err_is_fail(err)) {
+        DEBUG_ERR(err, "setting remote relations of a received cap");
+    }
+    return SYS_ERR_OK;
+
+out_free:
+    slot_free(*cap);
+    *cap = NULL_CAP;
+    return err_push(err, MON_ERR_CAP_CREATE);
+}
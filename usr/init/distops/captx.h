@@ -0,0 +1,43 @@
+/**
+ * \file
+ * \brief Sending capabilities to init on another core
+ */
+
+/*
+ * Copyright (c) 2023, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#ifndef DISTOPS_CAPTX_H
+#define DISTOPS_CAPTX_H
+
+#include <aos/aos_rpc.h>
+
+/**
+ * \brief Serialise a capability to send it to another core.
+ *
+ * \param cap   The capability to send, may be NULL_CAP
+ * \param dest  The core it is sent to
+ * \param tx    Filled in with the raw capability and its owner
+ *
+ * If this core owns the capability, it is marked as having copies on other cores, so
+ * deleting or revoking it involves them from now on.
+ */
+errval_t captx_prepare_send(struct capref cap, coreid_t dest, struct ump_cap *tx);
+
+/**
+ * \brief Recreate a capability received from another core.
+ *
+ * \param tx   The capability as it was serialised by the sender
+ * \param cap  Returns a new slot holding a copy of it, or NULL_CAP if none was sent
+ *
+ * If there is a copy of the capability on this core already, the new one joins it,
+ * otherwise it is created through the kernel as a copy owned by the sender's owner.
+ */
+errval_t captx_handle_recv(struct ump_cap *tx, struct capref *cap);
+
+#endif
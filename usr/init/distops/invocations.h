@@ -46,20 +46,31 @@ invoke_monitor_create_cap(uint64_t *raw, capaddr_t caddr, int level, capaddr_t s
 
 STATIC_ASSERT(ObjType_Num < 0xFFFF, "retype invocation argument packing does not truncate enum objtype");
 static inline errval_t
-invoke_monitor_remote_cap_retype(capaddr_t src_root, capaddr_t src, gensize_t offset,
-                                 enum objtype newtype, gensize_t objsize, size_t count,
-                                 capaddr_t to_cspace, capaddr_t to, capaddr_t slot,
-                                 int level)
+invoke_monitor_remote_cap_retype_flags(capaddr_t src_root, capaddr_t src, gensize_t offset,
+                                       enum objtype newtype, gensize_t objsize, size_t count,
+                                       capaddr_t to_cspace, capaddr_t to, capaddr_t slot,
+                                       int level, uint32_t flags)
 {
     DEBUG_INVOCATION("%s: called from %p\n", __FUNCTION__, __builtin_return_address(0));
     assert(newtype < ObjType_Num);
-    assert(level <= 0xFF);
+    assert(level <= 0xF);
     assert(slot <= 0xFFFF);
+    assert((flags & 0xFFFFF) == 0);
     return cap_invoke10(cap_kernel, KernelCmd_Retype,
-                        src_root, src, offset, ((uint32_t)level << 16) | newtype,
+                        src_root, src, offset, flags | ((uint32_t)level << 16) | newtype,
                         objsize, count, to_cspace, to, slot).error;
 }
 
+static inline errval_t
+invoke_monitor_remote_cap_retype(capaddr_t src_root, capaddr_t src, gensize_t offset,
+                                 enum objtype newtype, gensize_t objsize, size_t count,
+                                 capaddr_t to_cspace, capaddr_t to, capaddr_t slot,
+                                 int level)
+{
+    return invoke_monitor_remote_cap_retype_flags(src_root, src, offset, newtype, objsize,
+                                                  count, to_cspace, to, slot, level, 0);
+}
+
 static inline errval_t
 invoke_monitor_revoke_mark_relations(uint64_t *raw_base)
 {
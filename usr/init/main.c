@@ -29,10 +29,15 @@
 
 #include "coreboot.h"
 #include "mem_alloc.h"
+#include "zero_pool.h"
 //#include <proc_mgmt/proc_mgmt.h>
 #include "proc_mgmt.h"
+#include "nameservice.h"
+#include "worker_pool.h"
+#include "distops/captx.h"
 
 #include <barrelfish_kpi/startup_arm.h>
+#include <barrelfish_kpi/asm_inlines_arch.h>
 
 #include <drivers/lpuart.h>
 #include <drivers/pl011.h>
@@ -48,16 +53,249 @@ struct lpuart_s *lpuart;
 int num_mod_names;
 char mod_names[MOD_NAME_MAX_NUM][MOD_NAME_LEN];
 
+extern genvaddr_t global_urpc_frames[4];
+extern genvaddr_t global_ump_mesh_frames[UMP_MAX_CORES];
+
+static errval_t ump_bench(coreid_t from, coreid_t to, struct ump_bench_result *res);
+
+/*
+ * How init waits for work once it has nothing left to do. INIT_IDLE_BLOCK sleeps in the
+ * waitset until an LMP message, a UMP notification or a timer arrives, which leaves the core
+ * to other domains or lets it idle. INIT_IDLE_POLL keeps checking and yielding instead, for
+ * the lowest latency at the cost of the core. Build with -DINIT_IDLE_POLICY=INIT_IDLE_POLL to
+ * get the latter.
+ */
+#define INIT_IDLE_BLOCK 0
+#define INIT_IDLE_POLL  1
+#ifndef INIT_IDLE_POLICY
+#define INIT_IDLE_POLICY INIT_IDLE_BLOCK
+#endif
+
+/// delay before refilling the zeroed frame pool is retried after a failure, doubled on
+/// every further failure up to ZERO_POOL_RETRY_MAX_US
+#define ZERO_POOL_RETRY_US     (100 * 1000)
+#define ZERO_POOL_RETRY_MAX_US (10 * 1000 * 1000)
+
+// payload of a request passed through the bulk frame, terminated in case the sender did not
+static char *bulk_string(struct aos_rpc *rpc, uintptr_t hdr, size_t len)
+{
+    char *str = aos_rpc_bulk_req(rpc, hdr);
+    str[MIN(len, AOS_RPC_BULK_SIZE - 1)] = '\0';
+    return str;
+}
+
+/// a request served by a worker thread, with copies of what the next message overwrites
+struct slow_request {
+    struct aos_rpc *rpc;
+    uintptr_t       words[LMP_MSG_LENGTH];
+    struct capref   cap;     ///< capability that came along, NULL_CAP if there was none
+    size_t          len;     ///< payload length in bytes
+    char            data[];  ///< payload, NUL-terminated
+};
+
+// the answer to a wait request: the exit status of the process, NOT_TERMINATED_PID while
+// it runs and SPAWN_ERR_PID if there is no such process. It is reaped once it is answered.
+static int wait_reply_status(domainid_t pid)
+{
+    int  status     = NOT_TERMINATED_PID;
+    bool terminated = false;
+    errval_t err = proc_mgmt_try_wait(pid, &status, &terminated);
+    if (err_is_fail(err)) {
+        return SPAWN_ERR_PID;
+    }
+    return terminated ? status : NOT_TERMINATED_PID;
+}
+
+// runs on a worker thread, the client is blocked until the reply finds its call by the id
+// in words[0]. Replies of different requests may overtake each other.
+static void slow_request_serve(void *arg)
+{
+    struct slow_request *req = arg;
+    struct aos_rpc *rpc = req->rpc;
+    struct capref remote_cap = req->cap;
+    errval_t err;
+
+    switch(AOS_RPC_HDR_TYPE(req->words[0])) {
+        case WAIT_MSG: {
+            // words[1] is a pid on another core
+            int status = wait_reply_status(req->words[1]);
+            err = aos_rpc_reply(rpc, req->words[0], ACK_MSG, NULL_CAP, (unsigned int)status);
+            if (err_is_fail(err)) {
+                DEBUG_ERR(err, "sending ack\n");
+            }
+            break;
+        }
+
+        case GET_ALL_PIDS: {
+            // the processes of all cores, the other inits are asked for theirs
+            struct get_all_pids_frame_output *output = aos_rpc_bulk_resp(rpc, req->words[0]);
+            domainid_t *pids;
+            size_t      npids;
+            output->num_pids = 0;
+            errval_t list_err = proc_mgmt_get_proc_list(&pids, &npids);
+            if (err_is_ok(list_err)) {
+                output->num_pids = MIN(npids, ARRAY_LENGTH(output->pids));
+                memcpy(output->pids, pids, output->num_pids * sizeof(domainid_t));
+                free(pids);
+            }
+            err = aos_rpc_reply(rpc, req->words[0], ACK_MSG, NULL_CAP, list_err);
+            if (err_is_fail(err)) {
+                DEBUG_ERR(err, "sending ack\n");
+            }
+            break;
+        }
+
+        case BENCH_UMP: {
+            // words[1] holds the sending core above the answering one
+            errval_t bench_err = ump_bench(req->words[1] >> 8, req->words[1] & 0xff,
+                                           aos_rpc_bulk_resp(rpc, req->words[0]));
+            err = aos_rpc_reply(rpc, req->words[0], ACK_MSG, NULL_CAP, bench_err);
+            if (err_is_fail(err)) {
+                DEBUG_ERR(err, "sending ack\n");
+            }
+            break;
+        }
+
+        case NS_REGISTER: {
+            // the server's endpoint came along, clients on this core get it from us
+            errval_t ns_err = LIB_ERR_NAMESERVICE_NOT_BOUND;
+            if (!capref_is_null(remote_cap)) {
+                ns_err = ns_register(req->data, remote_cap);
+            }
+            err = aos_rpc_reply(rpc, req->words[0], ACK_MSG, NULL_CAP, ns_err);
+            if (err_is_fail(err)) {
+                DEBUG_ERR(err, "sending ack\n");
+            }
+            break;
+        }
+
+        case NS_DEREGISTER: {
+            errval_t ns_err = ns_deregister(req->data);
+            err = aos_rpc_reply(rpc, req->words[0], ACK_MSG, NULL_CAP, ns_err);
+            if (err_is_fail(err)) {
+                DEBUG_ERR(err, "sending ack\n");
+            }
+            break;
+        }
+
+        case NS_LOOKUP: {
+            // the client binds to the endpoint itself if the server is on this core
+            struct ns_frame_output *ns_out = aos_rpc_bulk_resp(rpc, req->words[0]);
+            struct capref ns_ep = NULL_CAP;
+            errval_t ns_err = ns_lookup(req->data, &ns_out->core, &ns_ep);
+            err = aos_rpc_reply(rpc, req->words[0], ACK_MSG, ns_ep, ns_err);
+            if (err_is_fail(err)) {
+                DEBUG_ERR(err, "sending lookup result\n");
+            }
+            break;
+        }
+
+        case NS_ENUMERATE: {
+            errval_t ns_err = ns_enumerate(req->data, aos_rpc_bulk_resp(rpc, req->words[0]),
+                                           AOS_RPC_BULK_SIZE);
+            err = aos_rpc_reply(rpc, req->words[0], ACK_MSG, NULL_CAP, ns_err);
+            if (err_is_fail(err)) {
+                DEBUG_ERR(err, "sending names\n");
+            }
+            break;
+        }
+
+        case NS_BIND_UMP: {
+            // words[1] is the server's core, the frame holding the channel came along
+            errval_t ns_err = LIB_ERR_NAMESERVICE_NOT_BOUND;
+            if (!capref_is_null(remote_cap)) {
+                ns_err = ns_bind_ump(req->data, req->words[1], remote_cap);
+            }
+            err = aos_rpc_reply(rpc, req->words[0], ACK_MSG, NULL_CAP, ns_err);
+            if (err_is_fail(err)) {
+                DEBUG_ERR(err, "sending ack\n");
+            }
+            break;
+        }
+
+        case SPAWN_CMDLINE: {
+            // words[1] is the core, the command line came inline or in the bulk frame
+            coreid_t spawn_core = req->words[1];
+            domainid_t our_pid;
+            err = proc_mgmt_spawn_with_cmdline(req->data, spawn_core, &our_pid);
+            grading_rpc_handler_process_spawn(req->data, spawn_core);
+            err = aos_rpc_reply(rpc, req->words[0], PID_ACK, NULL_CAP, our_pid);
+            if (err_is_fail(err)) {
+                DEBUG_ERR(err, "sending pid\n");
+            }
+            break;
+        }
+
+        case SPAWN_WITH_CAPS_MSG: {
+            // the arguments are packed back to back in the bulk frame, the cap came along
+            struct spawn_with_caps_frame_input *input = (void *)req->data;
+            char *args_end = req->data + req->len;
+            const char *argv[MAX_CMDLINE_ARGS];
+            int spawn_argc = 0;
+            char *arg_str = input->argv;
+            while (spawn_argc < input->argc && spawn_argc < MAX_CMDLINE_ARGS && arg_str < args_end) {
+                argv[spawn_argc++] = arg_str;
+                arg_str += strlen(arg_str) + 1;
+            }
+            domainid_t pid4 = SPAWN_ERR_PID;
+            err = proc_mgmt_spawn_with_caps(spawn_argc, argv, capref_is_null(remote_cap) ? 0 : 1,
+                                            &remote_cap, input->core, &pid4);
+            if (err_is_fail(err)) {
+                debug_printf("spawn with caps failed\n");
+            }
+            err = aos_rpc_reply(rpc, req->words[0], ACK_MSG, NULL_CAP, pid4);
+            if (err_is_fail(err)) {
+                DEBUG_ERR(err, "sending ack\n");
+            }
+            break;
+        }
+
+        default:
+            debug_printf("no worker handles message type %d\n",
+                         AOS_RPC_HDR_TYPE(req->words[0]));
+            break;
+    }
+    free(req);
+}
+
+// copy what is needed to answer a request and leave it to a worker thread
+static errval_t slow_request_submit(struct aos_rpc *rpc, struct lmp_recv_long_msg *msg,
+                                    struct capref cap, bool is_inline)
+{
+    size_t len = 0;
+    if (is_inline) {
+        len = MIN(msg->words[2], AOS_RPC_INLINE_MAX);
+    } else if (AOS_RPC_IS_BULK(msg->words[0])) {
+        len = MIN(msg->words[2], AOS_RPC_BULK_SIZE - 1);
+    }
+
+    struct slow_request *req = malloc(sizeof(*req) + len + 1);
+    if (req == NULL) {
+        return LIB_ERR_MALLOC_FAIL;
+    }
+    req->rpc = rpc;
+    memcpy(req->words, msg->words, sizeof(req->words));
+    req->cap = cap;
+    req->len = len;
+    memcpy(req->data, is_inline ? rpc->rx.buf : (char *)aos_rpc_bulk_req(rpc, msg->words[0]), len);
+    req->data[len] = '\0';
+
+    errval_t err = worker_pool_submit(slow_request_serve, req);
+    if (err_is_fail(err)) {
+        free(req);
+    }
+    return err;
+}
+
 void gen_recv_handler(void *arg)
 {
     // debug_printf("received message\n");
-    struct lmp_recv_msg msg = LMP_RECV_MSG_INIT;
+    struct lmp_recv_long_msg msg = LMP_RECV_LONG_MSG_INIT;
     struct aos_rpc *rpc = arg;
-    errval_t err;
+    errval_t err, recv_err;
     
-    struct capref remote_cap;
-    slot_alloc(&remote_cap);
-    err = lmp_chan_recv(rpc->lmp_chan, &msg, &remote_cap);
+    struct capref remote_cap = NULL_CAP;
+    recv_err = lmp_chan_recv_long(rpc->lmp_chan, &msg, &remote_cap);
     
     // reregister receive handler
     err = lmp_chan_register_recv(rpc->lmp_chan, get_default_waitset(), MKCLOSURE(gen_recv_handler, arg));
@@ -65,9 +303,22 @@ void gen_recv_handler(void *arg)
         DEBUG_ERR(err, err_getstring(err));
         return;
     }
+    // a wakeup for a send of ours leaves nothing to receive
+    if (err_is_fail(recv_err)) {
+        if (err_no(recv_err) != LIB_ERR_NO_LMP_MSG) {
+            DEBUG_ERR(recv_err, "receiving request");
+        }
+        return;
+    }
+
+    // wait for the rest of an inline payload, the whole of it ends up in rpc->rx.buf
+    if (!aos_rpc_inline_recv(rpc, &msg)) {
+        return;
+    }
+    bool is_inline = AOS_RPC_IS_INLINE(msg.words[0]);
         
     // debug_printf("msg words[0]: %d\n", msg.words[0]);
-    switch(msg.words[0]) {
+    switch(AOS_RPC_HDR_TYPE(msg.words[0])) {
         case ACK_MSG:
             // is ack
             debug_printf("why is init receiving acks!?!?\n");
@@ -91,12 +342,11 @@ void gen_recv_handler(void *arg)
                 // err = lmp_chan_recv(rpc->lmp_chan, &msg, &rpc->lmp_chan->remote_cap);
             }
 
-            err = lmp_chan_register_send(rpc->lmp_chan, get_default_waitset(), MKCLOSURE(send_ack_handler, (void *) rpc));
+            err = aos_rpc_reply(rpc, msg.words[0], ACK_MSG, NULL_CAP, 0);
             if (err_is_fail(err)) {
-                DEBUG_ERR(err, "registering send handler\n");
+                DEBUG_ERR(err, "sending ack\n");
                 return;
             }
-            event_dispatch(get_default_waitset());
             break;
 
         case NUM_MSG:
@@ -118,13 +368,11 @@ void gen_recv_handler(void *arg)
             grading_rpc_handle_number(msg.words[1]);
             //debug_printf("here is the number we recieved: %d\n", msg.words[1]);
 
-            err = lmp_chan_register_send(rpc->lmp_chan, get_default_waitset(), MKCLOSURE(send_ack_handler, (void*) rpc));
+            err = aos_rpc_reply(rpc, msg.words[0], ACK_MSG, NULL_CAP, 0);
             if (err_is_fail(err)) {
-                DEBUG_ERR(err, "registering send handler\n");
+                DEBUG_ERR(err, "sending ack\n");
                 return;
             }
-            event_dispatch(get_default_waitset());
-            event_dispatch(get_default_waitset());
             break;
         case STRING_MSG:
             // is string
@@ -145,15 +393,14 @@ void gen_recv_handler(void *arg)
 
             // debug_printf("here is the length we recieved: %d\n", msg.words[1]);
             // debug_print_cap_at_capref(remote_cap);
-            void *buf;
-            err = paging_map_frame_attr(get_current_paging_state(), &buf, msg.words[1], remote_cap, VREGION_FLAGS_READ_WRITE);
+            char *buf = is_inline ? rpc->rx.buf : bulk_string(rpc, msg.words[0], msg.words[2]);
 
             // debug_printf("here is the string we recieved: %s\n", buf);
             grading_rpc_handler_string(buf);
 
-            err = lmp_chan_register_send(rpc->lmp_chan, get_default_waitset(), MKCLOSURE(send_ack_handler, (void*) rpc));
+            err = aos_rpc_reply(rpc, msg.words[0], ACK_MSG, NULL_CAP, 0);
             if (err_is_fail(err)) {
-                DEBUG_ERR(err, "registering send handler\n");
+                DEBUG_ERR(err, "sending ack\n");
                 return;
             }
             break;
@@ -166,15 +413,14 @@ void gen_recv_handler(void *arg)
 
             // debug_printf("here is the length we recieved: %d\n", msg.words[1]);
             // debug_print_cap_at_capref(remote_cap);
-            void *name_buf;
-            err = paging_map_frame_attr(get_current_paging_state(), &name_buf, BASE_PAGE_SIZE, remote_cap, VREGION_FLAGS_READ_WRITE);
-
-            // write process name into frame
-            proc_mgmt_get_name(msg.words[1], (char **)&name_buf, BASE_PAGE_SIZE);
+            // the name is short, send it back inline
+            char name[AOS_RPC_INLINE_MAX + 1] = { 0 };
+            char *name_buf = name;
+            proc_mgmt_get_name(msg.words[1], &name_buf, sizeof(name));
 
-            err = lmp_chan_register_send(rpc->lmp_chan, get_default_waitset(), MKCLOSURE(send_ack_handler, (void*) rpc));
+            err = aos_rpc_reply_inline(rpc, msg.words[0], ACK_MSG, 0, name, strlen(name));
             if (err_is_fail(err)) {
-                DEBUG_ERR(err, "registering send handler\n");
+                DEBUG_ERR(err, "sending name\n");
                 return;
             }
             break;
@@ -201,9 +447,36 @@ void gen_recv_handler(void *arg)
             }
             
             //grading_rpc_handler_serial_putchar(msg.words[1]);
-            err = lmp_chan_register_send(rpc->lmp_chan, get_default_waitset(), MKCLOSURE(send_ack_handler, (void*) rpc));
+            err = aos_rpc_reply(rpc, msg.words[0], ACK_MSG, NULL_CAP, 0);
             if (err_is_fail(err)) {
-                DEBUG_ERR(err, err_getstring(err));
+                DEBUG_ERR(err, "sending ack\n");
+                return;
+            }
+            break;
+
+        case PUTSTRING: {
+            // the whole string goes to the UART in one go, inline or from the bulk frame
+            const char *str = is_inline ? rpc->rx.buf : aos_rpc_bulk_req(rpc, msg.words[0]);
+            size_t str_len = MIN(msg.words[2], is_inline ? AOS_RPC_INLINE_MAX : AOS_RPC_BULK_SIZE);
+            if (qemu) {
+                err = pl011_write(pl011, str, str_len);
+            } else {
+                err = lpuart_write(lpuart, str, str_len);
+            }
+
+            err = aos_rpc_reply(rpc, msg.words[0], ACK_MSG, NULL_CAP, 0);
+            if (err_is_fail(err)) {
+                DEBUG_ERR(err, "sending ack\n");
+                return;
+            }
+            break;
+        }
+
+        case BENCH_SINK:
+            // the payload has been received, which is all that is measured
+            err = aos_rpc_reply(rpc, msg.words[0], ACK_MSG, NULL_CAP, 0);
+            if (err_is_fail(err)) {
+                DEBUG_ERR(err, "sending ack\n");
                 return;
             }
             break;
@@ -225,20 +498,11 @@ void gen_recv_handler(void *arg)
             } while (err == LPUART_ERR_NO_DATA);
             grading_rpc_handler_serial_getchar();
 
-            // build getchar response message payload
-            struct aos_rpc_num_payload *num_payload = malloc(sizeof(struct aos_rpc_num_payload));
-            num_payload->rpc = rpc;
-            num_payload->val = c;
-
-            err = lmp_chan_register_send(rpc->lmp_chan, get_default_waitset(), MKCLOSURE(send_char_handler, (void*) num_payload));
+            err = aos_rpc_reply(rpc, msg.words[0], GETCHAR_ACK, NULL_CAP, c);
             if (err_is_fail(err)) {
-                DEBUG_ERR(err, err_getstring(err));
+                DEBUG_ERR(err, "sending char\n");
                 return;
             }
-
-            event_dispatch(get_default_waitset());
-            event_dispatch(get_default_waitset());
-
             break;
 
         case GET_RAM_CAP:
@@ -261,93 +525,75 @@ void gen_recv_handler(void *arg)
             // debug_printf("here is the request we recieved: bytes: %d alignment: %d\n", msg.words[1],
             //                                                                      msg.words[2]);
 
-            struct aos_rpc_ram_cap_resp_payload* resp = 
-                malloc(sizeof(struct aos_rpc_ram_cap_resp_payload)); 
-            resp->rpc = rpc;
-            resp->ret_cap = NULL_CAP;
-            resp->ret_bytes = 0;
+            struct capref ram_cap = NULL_CAP;
+            size_t ram_bytes = 0;
             
-            // check that process hasn't exceeded mem limit
-            struct spawninfo* curr = root;
-            while (curr->next != NULL) {
-                if (curr->pid == rpc->pid)
-                    break;
-                curr = curr->next;
-            }
-            if (curr->pages_allocated + ROUND_UP(msg.words[1], BASE_PAGE_SIZE) / BASE_PAGE_SIZE <= 
+            // check that process hasn't exceeded mem limit. Every child's channel carries its
+            // PID, a channel without a process on this core has no limit to check and is refused
+            struct spawninfo *si = proc_mgmt_find(rpc->pid);
+            if (si != NULL && si->pages_allocated + ROUND_UP(msg.words[1], BASE_PAGE_SIZE) / BASE_PAGE_SIZE <= 
                 MAX_PROC_PAGES) 
             {
-                err = ram_alloc_aligned(&resp->ret_cap, msg.words[1], msg.words[2]);
+                err = ram_alloc_aligned(&ram_cap, msg.words[1], msg.words[2]);
                 if (err_is_fail(err)) {
                     DEBUG_ERR(err, "failed to allocate ram for child process\n");
-                    return;
+                    ram_cap = NULL_CAP;
+                } else {
+                    ram_bytes = ROUND_UP(msg.words[1], BASE_PAGE_SIZE);
+                    grading_rpc_handler_ram_cap(ram_bytes, msg.words[2]);
                 }
-                resp->ret_bytes = ROUND_UP(msg.words[1], BASE_PAGE_SIZE);
-
-                grading_rpc_handler_ram_cap(resp->ret_bytes, msg.words[2]);
             }
 
-            err = lmp_chan_register_send(rpc->lmp_chan, get_default_waitset(), 
-                                         MKCLOSURE(send_ram_cap_resp_handler, (void*) resp));
+            // a NULL_CAP reply tells the child the request was refused
+            err = aos_rpc_reply(rpc, msg.words[0], RAM_CAP_ACK, ram_cap, ram_bytes);
             if (err_is_fail(err)) {
-                DEBUG_ERR(err, "registering send handler\n");
+                DEBUG_ERR(err, "sending ram cap\n");
                 return;
             }
             
             break;
 
-        case SPAWN_CMDLINE:
-            // debug_printf("recieved spawn cmdline message\n");
-            while (err_is_fail(err)) {
-                debug_printf("not useless\n");
-            }
-            struct aos_rpc_cmdline_payload *payload = malloc(sizeof(struct aos_rpc_cmdline_payload));
-            
-            // debug_printf("here is the length we recieved: %d\n", msg.words[1]);
-            void *buf2;
-            err = paging_map_frame_attr(get_current_paging_state(), &buf2, msg.words[1], remote_cap, VREGION_FLAGS_READ_WRITE);
+        case GET_ZEROED_FRAME: {
+            // frame from the pre-zeroed pool, no clearing on the requester's time
+            struct capref zero_cap = NULL_CAP;
+            size_t zero_bytes = 0;
 
-            // debug_printf("here is the string we recieved: %s\n", buf2);
-            domainid_t our_pid;
-            err = proc_mgmt_spawn_with_cmdline(buf2, msg.words[2], &our_pid);
-            // if (err_is_fail(err)) {
-            //     debug_printf("spawn failed\n");
-            // }
-            payload->pid = our_pid;
-            payload->rpc = rpc;
-            err = lmp_chan_register_send(rpc->lmp_chan, get_default_waitset(), MKCLOSURE(send_pid_handler, (void*) payload));
-            grading_rpc_handler_process_spawn(buf2, msg.words[2]);
-            break;
-        case GET_ALL_PIDS:
-            // debug_printf("is get_all_pids message\n");
-            while (err_is_fail(err)) {
-                debug_printf("\n\n\nlooks like the code ran\n\n\n");
-                // if (!lmp_err_is_transient(err)) {
-                //     DEBUG_ERR(err, "registering receive handler\n");
-                //     return;
-                // }
-                // err = lmp_chan_register_recv(rpc->lmp_chan, get_default_waitset(), MKCLOSURE(gen_recv_handler, arg));
-                // if (err_is_fail(err)) {
-                //     DEBUG_ERR(err, "registering receive handler\n");
-                //     return;
-                // }
-                // err = lmp_chan_recv(rpc->lmp_chan, &msg, &rpc->lmp_chan->remote_cap);
+            err = zero_pool_alloc(msg.words[1], &zero_cap, &zero_bytes);
+            if (err_is_fail(err)) {
+                // the requester falls back to allocating and clearing RAM itself
+                zero_cap = NULL_CAP;
+                zero_bytes = 0;
             }
 
-            void *buf10;
-            err = paging_map_frame_attr(get_current_paging_state(), &buf10, msg.words[1], remote_cap, VREGION_FLAGS_READ_WRITE);
-            struct get_all_pids_frame_output * output = (struct get_all_pids_frame_output*) buf10;
-            domainid_t * intermediate_pids;
-            proc_mgmt_get_proc_list(&intermediate_pids, &output->num_pids);
-            for (size_t i = 0; i < output->num_pids; i++) {
-                output->pids[i] = intermediate_pids[i];
-            }
-            err = lmp_chan_register_send(rpc->lmp_chan, get_default_waitset(), MKCLOSURE(send_ack_handler, (void*) rpc));
+            err = aos_rpc_reply(rpc, msg.words[0], RAM_CAP_ACK, zero_cap, zero_bytes);
             if (err_is_fail(err)) {
-                DEBUG_ERR(err, "registering send handler\n");
+                DEBUG_ERR(err, "sending zeroed frame\n");
                 return;
             }
             break;
+        }
+
+        case SPAWN_CMDLINE:
+        case SPAWN_WITH_CAPS_MSG:
+        case BENCH_UMP:
+        case NS_REGISTER:
+        case NS_DEREGISTER:
+        case NS_LOOKUP:
+        case NS_ENUMERATE:
+        case NS_BIND_UMP:
+        case GET_ALL_PIDS:
+            // these load binaries or wait for other cores, the RAM and terminal requests of
+            // everyone else would be held up meanwhile
+            err = slow_request_submit(rpc, &msg, remote_cap, is_inline);
+            if (err_is_fail(err)) {
+                DEBUG_ERR(err, "queueing request\n");
+                err = aos_rpc_reply(rpc, msg.words[0], ACK_MSG, NULL_CAP, err);
+                if (err_is_fail(err)) {
+                    DEBUG_ERR(err, "sending ack\n");
+                    return;
+                }
+            }
+            break;
         case GET_PID:
             // debug_printf("is get_pid message\n");
             while (err_is_fail(err)) {
@@ -364,15 +610,13 @@ void gen_recv_handler(void *arg)
                 // err = lmp_chan_recv(rpc->lmp_chan, &msg, &rpc->lmp_chan->remote_cap);
             }
 
-            void *buf11;
-            err = paging_map_frame_attr(get_current_paging_state(), &buf11, msg.words[1], remote_cap, VREGION_FLAGS_READ_WRITE);
-            struct get_pid_frame_output * output2 = (struct get_pid_frame_output*) buf11;
+            domainid_t found_pid;
+            char *buf11 = is_inline ? rpc->rx.buf : bulk_string(rpc, msg.words[0], msg.words[2]);
             // debug_printf("heres the string we recieved: %s\n", buf11);
-            proc_mgmt_get_pid_by_name(buf11, &output2->pid);
-            // debug_printf("made it to the end of receiving\n");
-            err = lmp_chan_register_send(rpc->lmp_chan, get_default_waitset(), MKCLOSURE(send_ack_handler, (void*) rpc));
+            proc_mgmt_get_pid_by_name(buf11, &found_pid);
+            err = aos_rpc_reply(rpc, msg.words[0], PID_ACK, NULL_CAP, found_pid);
             if (err_is_fail(err)) {
-                DEBUG_ERR(err, "registering send handler\n");
+                DEBUG_ERR(err, "sending pid\n");
                 return;
             }
             break;
@@ -392,16 +636,15 @@ void gen_recv_handler(void *arg)
                 // err = lmp_chan_recv(rpc->lmp_chan, &msg, &rpc->lmp_chan->remote_cap);
             }
 
-            void *buf12;
-            err = paging_map_frame_attr(get_current_paging_state(), &buf12, msg.words[1], remote_cap, VREGION_FLAGS_READ_WRITE);
-            int status = *((int *) buf12);
-            domainid_t pid8 = ((int*)buf12)[1];
+            // words[1] is the exit status, words[2] the pid
+            int status = (int)msg.words[1];
+            domainid_t pid8 = msg.words[2];
             // debug_printf("heres the status we recieved: %d\n", status);
             proc_mgmt_terminated(pid8, status);
             // debug_printf("made it to the end of receiving\n");
-            err = lmp_chan_register_send(rpc->lmp_chan, get_default_waitset(), MKCLOSURE(send_ack_handler, (void*) rpc));
+            err = aos_rpc_reply(rpc, msg.words[0], ACK_MSG, NULL_CAP, 0);
             if (err_is_fail(err)) {
-                DEBUG_ERR(err, "registering send handler\n");
+                DEBUG_ERR(err, "sending ack\n");
                 return;
             }
             break;
@@ -411,53 +654,20 @@ void gen_recv_handler(void *arg)
                 debug_printf("\n\n\nlooks like the code ran\n\n\n");
             }
 
-            void *buf13;
-            err = paging_map_frame_attr(get_current_paging_state(), &buf13, msg.words[1], remote_cap, VREGION_FLAGS_READ_WRITE);
-            domainid_t pid3 = ((int*)buf13)[0];
-            if (proc_mgmt_has_terminated(pid3)) {
-                proc_mgmt_wait(pid3, (int*)buf13);
-            } else {
-                *(int*)buf13 = NOT_TERMINATED_PID;
-            }
-            err = lmp_chan_register_send(rpc->lmp_chan, get_default_waitset(), MKCLOSURE(send_ack_handler, (void*) rpc));
-            if (err_is_fail(err)) {
-                DEBUG_ERR(err, "registering send handler\n");
-                return;
-            }
-            break;
-        case SPAWN_WITH_CAPS_MSG:
-            // debug_printf("is spawn with caps message\n");
-            while (err_is_fail(err)) {
-                debug_printf("\n\n\nlooks like the code ran\n\n\n");
-                // if (!lmp_err_is_transient(err)) {
-                //     DEBUG_ERR(err, "registering receive handler\n");
-                //     return;
-                // }
-                // err = lmp_chan_register_recv(rpc->lmp_chan, get_default_waitset(), MKCLOSURE(gen_recv_handler, arg));
-                // if (err_is_fail(err)) {
-                //     DEBUG_ERR(err, "registering receive handler\n");
-                //     return;
-                // }
-                // err = lmp_chan_recv(rpc->lmp_chan, &msg, &rpc->lmp_chan->remote_cap);
-            }
-
-            void *buf14;
-            err = paging_map_frame_attr(get_current_paging_state(), &buf14, msg.words[1], remote_cap, VREGION_FLAGS_READ_WRITE);
-            struct spawn_with_caps_frame_input * input = (struct spawn_with_caps_frame_input*) buf14;
-            char ** argv = malloc(4096);
-            for (int i = 0; i < input->argc; i++) {
-                argv[i] = malloc(strlen(input->argv[i] + 1));
-                strcpy(argv[i], input->argv[i]);
-            }
-            domainid_t pid4;
-            err = proc_mgmt_spawn_with_caps(input->argc, (const char **) argv, input->capc, &input->cap, input->core, &pid4);
-            (input->pid) = pid4;
-            if (err_is_fail(err)) {
-                debug_printf("spawn with caps failed\n");
+            // words[1] is the pid, the reply carries the exit status
+            domainid_t pid3 = msg.words[1];
+            if (PROC_PID_CORE(pid3) != my_core_id) {
+                // the init on that core has to be asked, which may take a while
+                err = slow_request_submit(rpc, &msg, remote_cap, is_inline);
+                if (err_is_ok(err)) {
+                    break;
+                }
+                DEBUG_ERR(err, "queueing request\n");
             }
-            err = lmp_chan_register_send(rpc->lmp_chan, get_default_waitset(), MKCLOSURE(send_ack_handler, (void*) rpc));
+            err = aos_rpc_reply(rpc, msg.words[0], ACK_MSG, NULL_CAP,
+                                (unsigned int)wait_reply_status(pid3));
             if (err_is_fail(err)) {
-                DEBUG_ERR(err, "registering send handler\n");
+                DEBUG_ERR(err, "sending ack\n");
                 return;
             }
             break;
@@ -477,9 +687,7 @@ void gen_recv_handler(void *arg)
                 // err = lmp_chan_recv(rpc->lmp_chan, &msg, &rpc->lmp_chan->remote_cap);
             }
 
-            void *buf15;
-            err = paging_map_frame_attr(get_current_paging_state(), &buf15, msg.words[1], remote_cap, VREGION_FLAGS_READ_WRITE);
-            struct get_elf_mod_names_output * output_mod_names = (struct get_elf_mod_names_output*) buf15;
+            struct get_elf_mod_names_output * output_mod_names = aos_rpc_bulk_resp(rpc, msg.words[0]);
 
             for (int i = 0; i < num_mod_names; i++) {
                 strncpy(output_mod_names->names[i], mod_names[i], MOD_NAME_LEN);
@@ -488,9 +696,9 @@ void gen_recv_handler(void *arg)
             output_mod_names->num_names = num_mod_names;
             // debug_printf("number of modules added: %d\n", output_mod_names->num_names);
 
-            err = lmp_chan_register_send(rpc->lmp_chan, get_default_waitset(), MKCLOSURE(send_ack_handler, (void*) rpc));
+            err = aos_rpc_reply(rpc, msg.words[0], ACK_MSG, NULL_CAP, 0);
             if (err_is_fail(err)) {
-                DEBUG_ERR(err, "registering send handler\n");
+                DEBUG_ERR(err, "sending ack\n");
                 return;
             }
             break;
@@ -500,99 +708,488 @@ void gen_recv_handler(void *arg)
             abort();
     }
 
-    // allocate a new slot
-    // TODO: allocate only when needed
-    err = lmp_chan_alloc_recv_slot(rpc->lmp_chan);
+    // the receive slot has been used up if a cap came with the message
+    if (!capref_is_null(remote_cap)) {
+        err = lmp_chan_alloc_recv_slot(rpc->lmp_chan);
+    }
 }
 
-void send_ack_handler(void *arg)
+struct bootinfo *bi;
+coreid_t my_core_id;
+struct platform_info platform_info;
+
+// tell the core that asked for a process its pid
+static void ump_send_pid_ack(struct ump_chan *ack_chan, coreid_t core, domainid_t pid)
+{
+    struct ump_payload ack_msg;
+    ack_msg.type = PID_ACK;
+    ack_msg.data_len = 0;
+    ack_msg.recv_core = core;
+    ack_msg.send_core = my_core_id;
+    memcpy(&ack_msg.payload, &pid, sizeof(pid));
+
+    errval_t err = ump_send(ack_chan, (char *)&ack_msg, sizeof(ack_msg));
+    if (err_is_fail(err)) {
+        DEBUG_ERR(err, "couldn't send an ack");
+    }
+}
+
+// spawn a process asked for by another core and send it back the pid
+static void ump_spawn_and_ack(struct ump_payload *msg, const char *data,
+                              struct ump_chan *ack_chan)
+{
+    // long command lines come through the data area
+    const char *cmdline = msg->payload;
+    if (msg->data_len > 0) {
+        cmdline = data;
+    }
+
+    domainid_t pid;
+    errval_t err = proc_mgmt_spawn_with_cmdline(cmdline, my_core_id, &pid);
+    if (err_is_fail(err)) {
+        DEBUG_ERR(err, "couldn't spawn a process");
+        pid = SPAWN_ERR_PID;
+    }
+    ump_send_pid_ack(ack_chan, msg->send_core, pid);
+}
+
+// spawn a process with capabilities sent along from another core
+static void ump_spawn_caps_and_ack(struct ump_payload *msg, char *data,
+                                   struct ump_chan *ack_chan)
 {
-    // debug_printf("sending ack\n");
-    struct aos_rpc *rpc = arg;
-    struct lmp_chan *chan = rpc->lmp_chan;
     errval_t err;
-    err = lmp_chan_send1(chan, 0, NULL_CAP, ACK_MSG);
-    while (err_is_fail(err)) {
-        debug_printf("\n\n\n\n went into our error while loop\n\n\n\n");
+    domainid_t pid = SPAWN_ERR_PID;
+
+    struct ump_spawn_caps req;
+    memcpy(&req, msg->payload, sizeof(req));
+
+    struct capref capv[UMP_SPAWN_MAX_CAPS];
+    int capc = 0;
+    for (; capc < req.capc && capc < UMP_SPAWN_MAX_CAPS; capc++) {
+        err = captx_handle_recv(&req.capv[capc], &capv[capc]);
+        if (err_is_fail(err)) {
+            DEBUG_ERR(err, "couldn't recreate a capability from core %d", msg->send_core);
+            goto out;
+        }
     }
 
-    // debug_printf("ack sent\n");
+    // the arguments are packed back to back in the data area
+    const char *argv[MAX_CMDLINE_ARGS];
+    int argc = 0;
+    char *arg = msg->data_len > 0 ? data : NULL;
+    char *args_end = arg + msg->data_len;
+    while (arg != NULL && argc < req.argc && argc < MAX_CMDLINE_ARGS && arg < args_end) {
+        argv[argc++] = arg;
+        arg += strnlen(arg, args_end - arg) + 1;
+    }
+
+    err = proc_mgmt_spawn_with_caps(argc, argv, capc, capv, my_core_id, &pid);
+    if (err_is_fail(err)) {
+        DEBUG_ERR(err, "couldn't spawn a process");
+        pid = SPAWN_ERR_PID;
+    }
+
+out:
+    // the child has its own copies now
+    for (int i = 0; i < capc; i++) {
+        if (!capref_is_null(capv[i])) {
+            cap_destroy(capv[i]);
+        }
+    }
+    ump_send_pid_ack(ack_chan, msg->send_core, pid);
+}
+
+/// a spawn request from another core, served by a worker thread
+struct ump_spawn_job {
+    struct ump_payload msg;
+    char               data[];  ///< copy of the message's data, NUL-terminated
+};
+
+static void ump_spawn_job_run(void *arg)
+{
+    struct ump_spawn_job *job = arg;
+    struct ump_chan *ack_chan = get_ump_chan_peer(job->msg.send_core, 0);
+    if (job->msg.type == SPAWN_WITH_CAPS_MSG) {
+        ump_spawn_caps_and_ack(&job->msg, job->data, ack_chan);
+    } else {
+        ump_spawn_and_ack(&job->msg, job->data, ack_chan);
+    }
+    free(job);
+}
+
+// spawn requests from another core, which are always meant for this one. Loading the binary
+// takes a while, so a worker thread does it and the channel is released right away.
+static bool ump_spawn_handler(struct ump_payload *msg, void *arg)
+{
+    struct ump_demux *dm = arg;
+    errval_t err = LIB_ERR_MALLOC_FAIL;
+
+    struct ump_spawn_job *job = malloc(sizeof(*job) + msg->data_len + 1);
+    if (job != NULL) {
+        job->msg = *msg;
+        void *data = ump_msg_data(dm->chan, msg);
+        if (data != NULL) {
+            memcpy(job->data, data, msg->data_len);
+        }
+        job->data[msg->data_len] = '\0';
+        err = worker_pool_submit(ump_spawn_job_run, job);
+    }
+    ump_msg_release(dm->chan, msg);
+
+    if (err_is_fail(err)) {
+        DEBUG_ERR(err, "couldn't queue a spawn request from core %d", msg->send_core);
+        free(job);
+        ump_send_pid_ack(get_ump_chan_peer(msg->send_core, 0), msg->send_core, SPAWN_ERR_PID);
+    }
+    return true;
 }
 
-void send_char_handler(void *arg)
+// time messages to the init on another core, which answers them in ump_bench_ping_handler()
+static errval_t ump_bench_run(coreid_t peer, struct ump_bench_result *res)
 {
-    //debug_printf("sending char\n");
-    struct aos_rpc_num_payload *payload = arg;
-    struct aos_rpc *rpc = payload->rpc;
-    struct lmp_chan *chan = rpc->lmp_chan;
-    char c = payload->val;
     errval_t err;
-    err = lmp_chan_send2(chan, 0, NULL_CAP, GETCHAR_ACK, c);
+
+    if (peer == my_core_id || !ump_peer_connected(peer)) {
+        return MON_ERR_INVALID_CORE_ID;
+    }
+    struct ump_chan *chan = get_ump_chan_peer(peer, 0);
+    struct ump_demux *dm = get_ump_demux_peer(peer);
+
+    // payload[0] asks for an answer
+    struct ump_payload ping, pong;
+    ping.type = UMP_BENCH_PING;
+    ping.send_core = my_core_id;
+    ping.recv_core = peer;
+    ping.data_len = 0;
+    ping.payload[0] = 1;
+    thread_mutex_lock_nested(&dm->call_mutex);
+    for (int i = 0; i < UMP_BENCH_ROUNDS; i++) {
+        cycles_t start = rdccnt();
+        err = ump_send(chan, (char *)&ping, sizeof(ping));
+        if (err_is_fail(err)) {
+            goto out;
+        }
+        err = ump_demux_wait(dm, UMP_BENCH_PONG, &pong);
+        if (err_is_fail(err)) {
+            goto out;
+        }
+        res->rtt[i] = rdccnt() - start;
+    }
+
+    // only the last message of the stream is answered
+    cycles_t start = rdccnt();
+    for (int i = 0; i < UMP_BENCH_STREAM; i++) {
+        ping.payload[0] = (i == UMP_BENCH_STREAM - 1);
+        err = ump_send(chan, (char *)&ping, sizeof(ping));
+        if (err_is_fail(err)) {
+            goto out;
+        }
+    }
+    err = ump_demux_wait(dm, UMP_BENCH_PONG, &pong);
+    if (err_is_fail(err)) {
+        goto out;
+    }
+    res->stream_cycles = rdccnt() - start;
+
+out:
+    thread_mutex_unlock(&dm->call_mutex);
+    return err;
+}
+
+// run the UMP benchmark from core from to core to, through the init on core from
+static errval_t ump_bench(coreid_t from, coreid_t to, struct ump_bench_result *res)
+{
+    errval_t err;
+
+    if (from == my_core_id) {
+        return ump_bench_run(to, res);
+    }
+    if (!ump_peer_connected(from)) {
+        return MON_ERR_INVALID_CORE_ID;
+    }
+
+    struct ump_payload msg;
+    msg.type = UMP_BENCH_RUN;
+    msg.send_core = my_core_id;
+    msg.recv_core = from;
+    msg.data_len = 0;
+    msg.payload[0] = to;
+    struct ump_demux *dm = get_ump_demux_peer(from);
+    thread_mutex_lock_nested(&dm->call_mutex);
+    err = ump_send(get_ump_chan_peer(from, 0), (char *)&msg, sizeof(msg));
+    if (err_is_ok(err)) {
+        // the error comes back in the payload, the result in the data area
+        err = ump_demux_wait(dm, UMP_BENCH_DONE, &msg);
+    }
+    thread_mutex_unlock(&dm->call_mutex);
+    if (err_is_fail(err)) {
+        return err;
+    }
+    memcpy(&err, msg.payload, sizeof(err));
+    void *data = ump_msg_data(dm->chan, &msg);
+    if (err_is_ok(err) && data != NULL) {
+        memcpy(res, data, MIN(msg.data_len, sizeof(*res)));
+    }
+    ump_msg_release(dm->chan, &msg);
+    return err;
+}
+
+static bool ump_bench_ping_handler(struct ump_payload *msg, void *arg)
+{
+    (void)arg;
+    if (msg->payload[0]) {
+        struct ump_payload pong;
+        pong.type = UMP_BENCH_PONG;
+        pong.send_core = my_core_id;
+        pong.recv_core = msg->send_core;
+        pong.data_len = 0;
+        errval_t err = ump_send(get_ump_chan_peer(msg->send_core, 0), (char *)&pong,
+                                sizeof(pong));
+        if (err_is_fail(err)) {
+            DEBUG_ERR(err, "couldn't answer a benchmark message");
+        }
+    }
+    return true;
+}
+
+/// a benchmark run asked for by another core, served by a worker thread
+struct ump_bench_job {
+    coreid_t                requester;
+    coreid_t                peer;
+    struct ump_bench_result res;
+};
+
+// send the result of a benchmark run, or just the error, back to the core that asked for it
+static void ump_bench_send_done(coreid_t requester, errval_t err, struct ump_bench_result *res)
+{
+    struct ump_payload done;
+    done.type = UMP_BENCH_DONE;
+    done.send_core = my_core_id;
+    done.recv_core = requester;
+    memcpy(done.payload, &err, sizeof(err));
+    struct ump_chan *chan = get_ump_chan_peer(requester, 0);
+    if (err_is_ok(err)) {
+        err = ump_send_data(chan, &done, res, sizeof(*res));
+    } else {
+        done.data_len = 0;
+        err = ump_send(chan, (char *)&done, sizeof(done));
+    }
     if (err_is_fail(err)) {
-        USER_PANIC_ERR(err, "failed sending char\n");
+        DEBUG_ERR(err, "couldn't send the benchmark result");
     }
+}
 
-    free(payload);
+static void ump_bench_job_run(void *arg)
+{
+    struct ump_bench_job *job = arg;
+    errval_t err = ump_bench_run(job->peer, &job->res);
+    ump_bench_send_done(job->requester, err, &job->res);
+    free(job);
+}
 
-    //debug_printf("char sent: %c\n", c);
+// another core asks us to run the benchmark from here. The run waits for the other core
+// many times over, so a worker thread does it and the channel is released right away.
+static bool ump_bench_run_handler(struct ump_payload *msg, void *arg)
+{
+    (void)arg;
+    errval_t err = LIB_ERR_MALLOC_FAIL;
+
+    struct ump_bench_job *job = malloc(sizeof(*job));
+    if (job != NULL) {
+        job->requester = msg->send_core;
+        job->peer = msg->payload[0];
+        err = worker_pool_submit(ump_bench_job_run, job);
+    }
+
+    if (err_is_fail(err)) {
+        DEBUG_ERR(err, "couldn't queue a benchmark run from core %d", msg->send_core);
+        free(job);
+        ump_bench_send_done(msg->send_core, err, NULL);
+    }
+    return true;
+}
+
+// handle messages from every core we have channels to as they arrive, whatever else is
+// queued on the channel. They are picked up by the default waitset like LMP messages.
+static void ump_register_handlers(void)
+{
+    for (coreid_t core = 0; core < UMP_MAX_CORES; core++) {
+        if (ump_peer_connected(core)) {
+            struct ump_demux *dm = get_ump_demux_peer(core);
+            ump_demux_register(dm, SPAWN_CMDLINE, ump_spawn_handler, dm);
+            ump_demux_register(dm, SPAWN_WITH_CAPS_MSG, ump_spawn_handler, dm);
+            ump_demux_register(dm, UMP_BENCH_PING, ump_bench_ping_handler, dm);
+            ump_demux_register(dm, UMP_BENCH_RUN, ump_bench_run_handler, dm);
+            ns_register_ump_handlers(dm);
+            proc_mgmt_register_ump_handlers(dm);
+            errval_t err = ump_demux_register_waitset(dm, get_default_waitset());
+            if (err_is_fail(err)) {
+                DEBUG_ERR(err, "couldn't add the channel from core %d to the waitset", core);
+            }
+        }
+    }
 }
 
-void send_pid_handler(void *arg) {
-    // debug_printf("sending our pid\n");
-    struct aos_rpc_cmdline_payload *payload = arg;
-    struct aos_rpc *rpc = payload->rpc;
-    struct lmp_chan *chan = rpc->lmp_chan;
+// set up the channels between two app cores in a frame of their own
+static errval_t ump_mesh_setup_pair(coreid_t lo, coreid_t hi)
+{
     errval_t err;
-    err = lmp_chan_send2(chan, 0, NULL_CAP, PID_ACK, payload->pid);
-    while (err_is_fail(err)) {
-        debug_printf("\n\n\n\n went into our error while loop\n\n\n\n");
-        // if (!lmp_err_is_transient(err)) {
-        //     DEBUG_ERR(err, "failed sending ack\n");
-        //     return;
-        // }
-        // err = lmp_chan_register_send(chan, get_default_waitset(), MKCLOSURE(send_ack_handler, arg));
-        // if (err_is_fail(err)) {
-        //     DEBUG_ERR(err, "registering send handler\n");
-        //     return;
-        // }
-        // err = lmp_chan_send1(chan, LMP_SEND_FLAGS_DEFAULT, NULL_CAP, 0);
-    }
-
-    free(payload);
-
-    // debug_printf("ack sent\n");
+
+    struct capref frame;
+    err = frame_alloc(&frame, UMP_URPC_FRAME_SIZE, NULL);
+    if (err_is_fail(err)) {
+        return err_push(err, LIB_ERR_FRAME_ALLOC);
+    }
+    void *buf;
+    err = paging_map_frame_attr(get_current_paging_state(), &buf, UMP_URPC_FRAME_SIZE, frame,
+                                VREGION_FLAGS_READ_WRITE);
+    if (err_is_fail(err)) {
+        return err_push(err, LIB_ERR_VSPACE_MAP);
+    }
+
+    ump_frame_init(buf);
+
+    struct capability frame_cap;
+    err = cap_direct_identify(frame, &frame_cap);
+    if (err_is_fail(err)) {
+        return err;
+    }
+    ((struct ump_mesh_info *)(global_urpc_frames[lo] + UMP_URPC_MESH_OFFSET))->frames[hi]
+        = frame_cap.u.frame.base;
+    ((struct ump_mesh_info *)(global_urpc_frames[hi] + UMP_URPC_MESH_OFFSET))->frames[lo]
+        = frame_cap.u.frame.base;
+
+    return SYS_ERR_OK;
 }
 
-void send_ram_cap_resp_handler(void *arg) 
+// give every pair of app cores direct channels, so their messages don't go through us
+static void ump_mesh_setup(void)
 {
-    // debug_printf("sending ram cap response\n");
-    struct aos_rpc_ram_cap_resp_payload* resp = arg;
-    struct lmp_chan *chan = resp->rpc->lmp_chan;
-
-    // debug_printf("sent ram cap size: %d\n", resp->ret_bytes);
-    errval_t err = lmp_chan_send2(chan, 0, resp->ret_cap, RAM_CAP_ACK, resp->ret_bytes);
-    while (err_is_fail(err)) {
-        debug_printf("\n\n\n\n went into our error while loop\n\n\n\n");
-        // if (!lmp_err_is_transient(err)) {
-        //     DEBUG_ERR(err, "failed sending ack\n");
-        //     return;
-        // }
-        // err = lmp_chan_register_send(chan, get_default_waitset(), MKCLOSURE(send_ack_handler, arg));
-        // if (err_is_fail(err)) {
-        //     DEBUG_ERR(err, "registering send handler\n");
-        //     return;
-        // }
-        // err = lmp_chan_send1(chan, LMP_SEND_FLAGS_DEFAULT, NULL_CAP, 0);
-    }
-
-    free(resp);
-
-    // debug_printf("ram cap resp sent\n");
+    for (coreid_t lo = 1; lo < UMP_MAX_CORES; lo++) {
+        for (coreid_t hi = lo + 1; hi < UMP_MAX_CORES; hi++) {
+            if (global_urpc_frames[lo] == 0 || global_urpc_frames[hi] == 0) {
+                continue;
+            }
+            errval_t err = ump_mesh_setup_pair(lo, hi);
+            if (err_is_fail(err)) {
+                DEBUG_ERR(err, "couldn't set up channels between core %d and %d", lo, hi);
+            }
+        }
+    }
+
+    // the cores are waiting for this, even if some of the channels could not be set up
+    dmb();
+    for (coreid_t core = 1; core < UMP_MAX_CORES; core++) {
+        if (global_urpc_frames[core] != 0) {
+            ((struct ump_mesh_info *)(global_urpc_frames[core] + UMP_URPC_MESH_OFFSET))->ready = 1;
+        }
+    }
 }
 
-struct bootinfo *bi;
-coreid_t my_core_id;
-struct platform_info platform_info;
+// map the frames with the channels to the other app cores, once the bsp has set them up
+static errval_t ump_mesh_connect(void)
+{
+    errval_t err;
+
+    struct ump_mesh_info *info
+        = (struct ump_mesh_info *)(global_urpc_frames[my_core_id] + UMP_URPC_MESH_OFFSET);
+    while (!info->ready) {
+        thread_yield();
+    }
+    dmb();
+
+    for (coreid_t core = 1; core < UMP_MAX_CORES; core++) {
+        if (core == my_core_id || info->frames[core] == 0) {
+            continue;
+        }
+
+        struct capref frame;
+        err = slot_alloc(&frame);
+        if (err_is_fail(err)) {
+            return err_push(err, LIB_ERR_SLOT_ALLOC);
+        }
+        err = frame_forge(frame, info->frames[core], UMP_URPC_FRAME_SIZE, my_core_id);
+        if (err_is_fail(err)) {
+            return err;
+        }
+        void *buf;
+        err = paging_map_frame_attr(get_current_paging_state(), &buf, UMP_URPC_FRAME_SIZE,
+                                    frame, VREGION_FLAGS_READ_WRITE);
+        if (err_is_fail(err)) {
+            return err_push(err, LIB_ERR_VSPACE_MAP);
+        }
+        global_ump_mesh_frames[core] = (genvaddr_t)buf;
+    }
+
+    return SYS_ERR_OK;
+}
+
+// ends the pause of the zeroed frame pool that a failed refill started
+static void zero_pool_retry_handler(void *arg)
+{
+    *(bool *)arg = false;
+}
+
+/**
+ * @brief handles events on the default waitset, never returns
+ *
+ * @param[in] zero_pool  whether to spend idle time on zeroing frames for later requests
+ *
+ * Once the waitset is empty init waits according to INIT_IDLE_POLICY. Refilling the pool
+ * comes first, a step at a time so that arriving requests are not held up for long.
+ */
+static void serve_forever(bool zero_pool)
+{
+    errval_t err;
+    struct waitset *ws = get_default_waitset();
+
+    // a failed refill pauses the pool until the retry timer fires, more memory may be free then
+    struct deferred_event retry_timer;
+    deferred_event_init(&retry_timer);
+    bool      zero_pool_paused = false;
+    delayus_t retry_delay      = ZERO_POOL_RETRY_US;
+
+    while (true) {
+        err = event_dispatch_non_block(ws);
+        if (err_is_ok(err)) {
+            continue;
+        }
+        if (err != LIB_ERR_NO_EVENT) {
+            DEBUG_ERR(err, "in event_dispatch");
+            abort();
+        }
+
+        // nothing to do, use the time to clear memory for later frame requests. If that
+        // fails we are short on memory, requesters then fall back to clearing frames themselves.
+        if (zero_pool && !zero_pool_paused && zero_pool_needs_refill()) {
+            err = zero_pool_refill_step();
+            if (err_is_ok(err)) {
+                retry_delay = ZERO_POOL_RETRY_US;
+                continue;
+            }
+            DEBUG_ERR(err, "refilling zeroed frame pool, retrying later");
+            err = deferred_event_register(&retry_timer, ws, retry_delay,
+                                          MKCLOSURE(zero_pool_retry_handler, &zero_pool_paused));
+            if (err_is_fail(err)) {
+                DEBUG_ERR(err, "arming zeroed frame pool retry, giving up");
+                zero_pool = false;
+            } else {
+                zero_pool_paused = true;
+                retry_delay      = MIN(2 * retry_delay, ZERO_POOL_RETRY_MAX_US);
+            }
+        }
+
+#if INIT_IDLE_POLICY == INIT_IDLE_POLL
+        thread_yield();
+#else
+        err = event_dispatch(ws);
+        if (err_is_fail(err)) {
+            DEBUG_ERR(err, "in event_dispatch");
+            abort();
+        }
+#endif
+    }
+}
 
 static int
 bsp_main(int argc, char *argv[]) {
@@ -651,11 +1248,16 @@ bsp_main(int argc, char *argv[]) {
 
     // initialize UMP channels
     for (int i = 1; i < 4; i++) {
-        genvaddr_t ump_addr = (genvaddr_t)get_ump_chan_mon(i, 0);
-        ump_chan_init((struct ump_chan *)ump_addr, ROUND_UP(ump_addr, BASE_PAGE_SIZE) - ump_addr);
-        ump_addr = (genvaddr_t)get_ump_chan_mon(i, 1);
-        ump_chan_init((struct ump_chan *)ump_addr, ROUND_UP(ump_addr, BASE_PAGE_SIZE) - ump_addr + BASE_PAGE_SIZE);
+        for (int direction = 0; direction < 2; direction++) {
+            genvaddr_t ump_addr = (genvaddr_t)get_ump_chan_mon(i, direction);
+            ump_chan_init((struct ump_chan *)ump_addr,
+                          global_urpc_frames[i] + UMP_URPC_RING_OFFSET(direction) - ump_addr,
+                          UMP_RING_PAGES * BASE_PAGE_SIZE,
+                          global_urpc_frames[i] + UMP_URPC_DATA_OFFSET(direction) - ump_addr,
+                          UMP_DATA_PAGES * BASE_PAGE_SIZE);
+        }
     }
+    ump_mesh_setup();
 
         // get the devframe passed to init
     struct capref devframe;
@@ -727,6 +1329,17 @@ bsp_main(int argc, char *argv[]) {
         DEBUG_ERR_ON_FAIL(err, "unable to enable lpuart interrupts\n");
     }
 
+    // slow requests are handed to these, so they have to run before any handler does
+    err = worker_pool_init();
+    if (err_is_fail(err)) {
+        USER_PANIC_ERR(err, "couldn't start the worker threads");
+    }
+    err = ump_notify_init(get_default_waitset());
+    if (err_is_fail(err)) {
+        DEBUG_ERR(err, "couldn't set up UMP notifications, receivers will poll");
+    }
+    ump_register_handlers();
+
     // calling late grading tests, required functionality up to here:
     //   - full functionality of the system
     // DO NOT REMOVE THE FOLLOWING LINE!
@@ -749,71 +1362,7 @@ bsp_main(int argc, char *argv[]) {
     proc_mgmt_spawn_with_cmdline("shell", 0, &shell_pid);
 
     // Hang around
-    struct waitset *default_ws = get_default_waitset();
-    while (true) {
-        err = event_dispatch_non_block(default_ws);
-        if (err_is_fail(err) && err != LIB_ERR_NO_EVENT) {
-            DEBUG_ERR(err, "in event_dispatch");
-            abort();
-        }
-
-        // poll for UMP messages
-        for (int core = 1; core <= 3; core++) {
-            struct ump_payload payload;
-            err = ump_receive(get_ump_chan_mon(core, 0), SPAWN_CMDLINE, &payload);
-            if (err == LIB_ERR_UMP_CHAN_RECV) {
-                err = ump_receive(get_ump_chan_mon(core, 0), PID_ACK, &payload);
-
-                // if this ack is for us, put it back, else forward it
-                if (payload.recv_core == my_core_id) {
-                    err = ump_send(get_ump_chan_mon(payload.send_core, 0), (char *)&payload, sizeof(payload));
-                    if (err_is_fail(err)) {
-                        debug_printf("couldn't put an ack back on the queue\n");
-                        abort();
-                    }
-                }
-            }
-            if (err_is_fail(err)) {
-                continue;
-            }
-
-            domainid_t pid;
-
-            // if this core is the recv core, spawn the process and send an ack
-            if (payload.recv_core == my_core_id) {
-                err = proc_mgmt_spawn_with_cmdline(payload.payload, payload.recv_core, &pid);
-                if (err_is_fail(err)) {
-                    debug_printf("couldn't spawn a process\n");
-                    abort();
-                }
-
-                // setup ack
-                struct ump_payload recv_msg;
-                recv_msg.type = PID_ACK;
-                recv_msg.recv_core = payload.send_core;
-                recv_msg.send_core = my_core_id;
-                memcpy(&recv_msg.payload, &pid, sizeof(pid));
-
-                // forward the ack to the correct core
-                err = ump_send(get_ump_chan_mon(recv_msg.recv_core, 1), (char *)&recv_msg, sizeof(recv_msg));
-                if (err_is_fail(err)) {
-                    debug_printf("couldn't send an ack\n");
-                    abort();
-                }
-
-                continue;
-            }
-
-            // else, forward the message to the correct core
-            err = ump_send(get_ump_chan_mon(payload.recv_core, 1), (char *)&payload, sizeof(payload));
-            if (err_is_fail(err)) {
-                debug_printf("couldn't forward a message\n");
-                abort();
-            }
-        }
-
-        thread_yield();
-    }
+    serve_forever(true);
 
     return EXIT_SUCCESS;
 }
@@ -835,10 +1384,11 @@ app_main(int argc, char *argv[]) {
                            ObjType_L2CNode, L2_CNODE_SLOTS);
     DEBUG_ERR_ON_FAIL(err, "failed to create elf module root on new core");
 
-    // Get urpc frame
+    // Get urpc frame, all of it including the UMP rings and data areas
     void* urpc_buf;
-    err = paging_map_frame_attr(get_current_paging_state(), &urpc_buf, BASE_PAGE_SIZE, cap_urpc, VREGION_FLAGS_READ_WRITE);
+    err = paging_map_frame_attr(get_current_paging_state(), &urpc_buf, UMP_URPC_FRAME_SIZE, cap_urpc, VREGION_FLAGS_READ_WRITE);
     DEBUG_ERR_ON_FAIL(err, "app_main: couldn't map urpc frame\n");
+    global_urpc_frames[my_core_id] = (genvaddr_t)urpc_buf;
 
     bi = (struct bootinfo*) urpc_buf;           // janky bootinfo struct with only 1 region
 
@@ -900,6 +1450,20 @@ app_main(int argc, char *argv[]) {
     // TODO(M5): signal the other core that we're up and running
 
     // TODO (M6): initialize URPC
+    err = ump_mesh_connect();
+    if (err_is_fail(err)) {
+        DEBUG_ERR(err, "couldn't connect to the other app cores");
+    }
+    // slow requests are handed to these, so they have to run before any handler does
+    err = worker_pool_init();
+    if (err_is_fail(err)) {
+        USER_PANIC_ERR(err, "couldn't start the worker threads");
+    }
+    err = ump_notify_init(get_default_waitset());
+    if (err_is_fail(err)) {
+        DEBUG_ERR(err, "couldn't set up UMP notifications, receivers will poll");
+    }
+    ump_register_handlers();
 
     // calling late grading tests, required functionality up to here:
     //   - full functionality of the system
@@ -907,50 +1471,7 @@ app_main(int argc, char *argv[]) {
     grading_test_late();
 
     // Hang around
-    struct waitset *default_ws = get_default_waitset();
-    while (true) {
-        err = event_dispatch_non_block(default_ws);
-
-        if (err_is_fail(err) && err != LIB_ERR_NO_EVENT) {
-            DEBUG_ERR(err, "in event_dispatch");
-            abort();
-        }
-
-        // check for a UMP message
-        struct ump_payload payload;
-        err = ump_receive(get_ump_chan_core(1), SPAWN_CMDLINE, &payload);
-        if (err_is_fail(err)) {
-            continue;
-        }
-
-        // if this core is the recv core, spawn the process and send an ack
-        if (payload.recv_core == my_core_id) {
-            domainid_t pid;
-            err = proc_mgmt_spawn_with_cmdline(payload.payload, payload.recv_core, &pid);
-            if (err_is_fail(err)) {
-                debug_printf("couldn't spawn a process\n");
-                abort();
-            }
-
-            // setup ack
-            struct ump_payload recv_msg;
-            recv_msg.type = PID_ACK;
-            recv_msg.recv_core = payload.send_core;
-            recv_msg.send_core = my_core_id;
-            memcpy(&recv_msg.payload, &pid, sizeof(pid));
-
-            // forward the ack to the correct core
-            err = ump_send(get_ump_chan_core(recv_msg.recv_core), (char *)&recv_msg, sizeof(recv_msg));
-            if (err_is_fail(err)) {
-                debug_printf("couldn't send an ack\n");
-                abort();
-            }
-
-            continue;
-        }
-
-        thread_yield();
-    }
+    serve_forever(false);
 
     return EXIT_SUCCESS;
 }
@@ -19,6 +19,9 @@ static struct mm aos_mm;
 /// slot allocator instance used by MM
 static struct slot_prealloc init_slot_alloc;
 
+/// serializes the threads of init allocating memory, refilling the slabs may recurse into MM
+static struct thread_mutex aos_mm_mutex = THREAD_MUTEX_INITIALIZER;
+
 /**
  * @brief wrapper around the slot allocator refill function
  *
@@ -153,7 +156,10 @@ errval_t initialize_ram_alloc(struct bootinfo *bi)
  */
 errval_t aos_ram_alloc_aligned(struct capref *cap, size_t size, size_t alignment)
 {
-    return mm_alloc_aligned(&aos_mm, size, alignment, cap);
+    thread_mutex_lock_nested(&aos_mm_mutex);
+    errval_t err = mm_alloc_aligned(&aos_mm, size, alignment, cap);
+    thread_mutex_unlock(&aos_mm_mutex);
+    return err;
 }
 
 
@@ -166,7 +172,10 @@ errval_t aos_ram_alloc_aligned(struct capref *cap, size_t size, size_t alignment
  */
 errval_t aos_ram_free(struct capref cap)
 {
-    return mm_free(&aos_mm, cap);
+    thread_mutex_lock_nested(&aos_mm_mutex);
+    errval_t err = mm_free(&aos_mm, cap);
+    thread_mutex_unlock(&aos_mm_mutex);
+    return err;
 }
 
 
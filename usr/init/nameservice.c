@@ -0,0 +1,496 @@
+/*
+ * Copyright (c) 2023, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+/**
+ * @file
+ * @brief Brokering channels between nameservice clients and servers
+ *
+ * Requests about names go to the init on core 0 over UMP. Clients on the same core as the
+ * server get its endpoint and bind to it themselves. Clients on other cores send the frame
+ * of a UMP channel, which we pass on to the init of the server's core and that one to the
+ * server. Its reply tells the client the channel can be used.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+
+#include <aos/aos.h>
+#include <aos/aos_rpc.h>
+
+#include "nameservice.h"
+#include "distops/captx.h"
+
+/// where a name is registered, kept by the init on core 0 only
+struct ns_record {
+    char              name[NS_NAME_LEN];
+    coreid_t          core;
+    struct ns_record *next;
+};
+
+/// a server on this core
+struct ns_service {
+    char               name[NS_NAME_LEN];
+    struct capref      ep;
+    struct ns_service *next;
+};
+
+/// answer of the init on another core, in the payload of NS_REPLY
+struct ns_ump_reply {
+    errval_t err;
+    coreid_t core;
+};
+
+static struct ns_record *ns_registry;
+static struct ns_service *ns_services;
+
+/// requests are served by several threads, see worker_pool.h
+static struct thread_mutex ns_mutex = THREAD_MUTEX_INITIALIZER;
+
+
+/*
+ * ------------------------------------------------------------------------------------------------
+ * Registry (core 0)
+ * ------------------------------------------------------------------------------------------------
+ */
+
+static struct ns_record **ns_registry_find(const char *name)
+{
+    struct ns_record **rec = &ns_registry;
+    while (*rec != NULL && strncmp((*rec)->name, name, NS_NAME_LEN) != 0) {
+        rec = &(*rec)->next;
+    }
+    return rec;
+}
+
+static errval_t ns_registry_add(const char *name, coreid_t core)
+{
+    struct ns_record *rec = malloc(sizeof(*rec));
+    if (rec == NULL) {
+        return LIB_ERR_MALLOC_FAIL;
+    }
+    strncpy(rec->name, name, NS_NAME_LEN);
+    rec->name[NS_NAME_LEN - 1] = '\0';
+    rec->core = core;
+
+    thread_mutex_lock(&ns_mutex);
+    if (*ns_registry_find(name) != NULL) {
+        thread_mutex_unlock(&ns_mutex);
+        free(rec);
+        return LIB_ERR_NAMESERVICE_ALREADY_REGISTRED;
+    }
+    rec->next = ns_registry;
+    ns_registry = rec;
+    thread_mutex_unlock(&ns_mutex);
+    return SYS_ERR_OK;
+}
+
+// only the core that registered a name can remove it
+static errval_t ns_registry_remove(const char *name, coreid_t core)
+{
+    thread_mutex_lock(&ns_mutex);
+    struct ns_record **rec = ns_registry_find(name);
+    if (*rec == NULL || (*rec)->core != core) {
+        thread_mutex_unlock(&ns_mutex);
+        return LIB_ERR_NAMESERVICE_UNKNOWN_NAME;
+    }
+
+    struct ns_record *old = *rec;
+    *rec = old->next;
+    thread_mutex_unlock(&ns_mutex);
+    free(old);
+    return SYS_ERR_OK;
+}
+
+static errval_t ns_registry_lookup(const char *name, coreid_t *core)
+{
+    thread_mutex_lock(&ns_mutex);
+    struct ns_record *rec = *ns_registry_find(name);
+    if (rec != NULL) {
+        *core = rec->core;
+    }
+    thread_mutex_unlock(&ns_mutex);
+    return rec == NULL ? LIB_ERR_NAMESERVICE_UNKNOWN_NAME : SYS_ERR_OK;
+}
+
+// names that do not fit are left out, returns the number of bytes of out used
+static size_t ns_registry_enumerate(const char *query, struct ns_frame_output *out, size_t size)
+{
+    size_t qlen = strnlen(query, NS_NAME_LEN);
+    char *pos = out->names;
+    char *end = (char *)out + size;
+
+    out->num = 0;
+    thread_mutex_lock(&ns_mutex);
+    for (struct ns_record *rec = ns_registry; rec != NULL; rec = rec->next) {
+        size_t len = strlen(rec->name) + 1;
+        if (strncmp(rec->name, query, qlen) != 0 || pos + len > end) {
+            continue;
+        }
+        memcpy(pos, rec->name, len);
+        pos += len;
+        out->num++;
+    }
+    thread_mutex_unlock(&ns_mutex);
+    return pos - (char *)out;
+}
+
+
+/*
+ * ------------------------------------------------------------------------------------------------
+ * Requests to other cores
+ * ------------------------------------------------------------------------------------------------
+ */
+
+// send a request to the init on another core and wait for its answer
+static errval_t ns_ump_call(coreid_t core, struct ump_payload *msg, struct ump_payload *reply)
+{
+    errval_t err;
+
+    // nothing to release unless the answer comes with data
+    reply->data_len = 0;
+    if (!ump_peer_connected(core)) {
+        return MON_ERR_INVALID_CORE_ID;
+    }
+
+    msg->send_core = disp_get_core_id();
+    msg->recv_core = core;
+    msg->data_len = 0;
+
+    // one request at a time, the replies carry nothing to tell them apart
+    struct ump_demux *dm = get_ump_demux_peer(core);
+    thread_mutex_lock_nested(&dm->call_mutex);
+    err = ump_send(get_ump_chan_peer(core, 0), (char *)msg, sizeof(*msg));
+    if (err_is_ok(err)) {
+        err = ump_demux_wait(dm, NS_REPLY, reply);
+    }
+    thread_mutex_unlock(&dm->call_mutex);
+    if (err_is_fail(err)) {
+        return err;
+    }
+    struct ns_ump_reply r;
+    memcpy(&r, reply->payload, sizeof(r));
+    return r.err;
+}
+
+// ask the init on core 0 about a name, it has the registry
+static errval_t ns_registry_call(enum msg_type type, const char *name, coreid_t *core)
+{
+    struct ump_payload msg, reply;
+    msg.type = type;
+    strncpy(msg.payload, name, NS_NAME_LEN);
+    msg.payload[NS_NAME_LEN - 1] = '\0';
+
+    errval_t err = ns_ump_call(0, &msg, &reply);
+    if (err_is_ok(err) && core != NULL) {
+        struct ns_ump_reply r;
+        memcpy(&r, reply.payload, sizeof(r));
+        *core = r.core;
+    }
+    // only enumerations come with data
+    ump_msg_release(get_ump_demux_peer(0)->chan, &reply);
+    return err;
+}
+
+
+/*
+ * ------------------------------------------------------------------------------------------------
+ * Servers on this core
+ * ------------------------------------------------------------------------------------------------
+ */
+
+// called with ns_mutex held
+static struct ns_service **ns_service_find(const char *name)
+{
+    struct ns_service **srv = &ns_services;
+    while (*srv != NULL && strncmp((*srv)->name, name, NS_NAME_LEN) != 0) {
+        srv = &(*srv)->next;
+    }
+    return srv;
+}
+
+// give the server the frame of a channel from a client on another core
+static errval_t ns_deliver_ump(const char *name, struct capref frame)
+{
+    errval_t err;
+
+    thread_mutex_lock(&ns_mutex);
+    struct ns_service *srv = *ns_service_find(name);
+    struct capref ep = srv != NULL ? srv->ep : NULL_CAP;
+    thread_mutex_unlock(&ns_mutex);
+    if (srv == NULL) {
+        return LIB_ERR_NAMESERVICE_UNKNOWN_NAME;
+    }
+
+    // the listening endpoint is shared with the bind requests of local clients
+    do {
+        err = lmp_ep_send1(ep, LMP_SEND_FLAGS_DEFAULT, frame, AOS_RPC_HDR(NS_BIND_UMP, 0));
+        if (lmp_err_is_transient(err)) {
+            thread_yield();
+        }
+    } while (lmp_err_is_transient(err));
+
+    if (err_is_fail(err)) {
+        return err_push(err, LIB_ERR_LMP_CHAN_SEND);
+    }
+    return SYS_ERR_OK;
+}
+
+errval_t ns_register(const char *name, struct capref ep)
+{
+    errval_t err;
+
+    struct ns_service *srv = malloc(sizeof(*srv));
+    if (srv == NULL) {
+        err = LIB_ERR_MALLOC_FAIL;
+        goto fail;
+    }
+
+    if (disp_get_core_id() == 0) {
+        err = ns_registry_add(name, 0);
+    } else {
+        err = ns_registry_call(NS_REGISTER, name, NULL);
+    }
+    if (err_is_fail(err)) {
+        goto fail;
+    }
+
+    strncpy(srv->name, name, NS_NAME_LEN);
+    srv->name[NS_NAME_LEN - 1] = '\0';
+    srv->ep = ep;
+    thread_mutex_lock(&ns_mutex);
+    srv->next = ns_services;
+    ns_services = srv;
+    thread_mutex_unlock(&ns_mutex);
+    return SYS_ERR_OK;
+
+fail:
+    free(srv);
+    cap_destroy(ep);
+    return err;
+}
+
+errval_t ns_deregister(const char *name)
+{
+    errval_t err;
+
+    thread_mutex_lock(&ns_mutex);
+    bool known = *ns_service_find(name) != NULL;
+    thread_mutex_unlock(&ns_mutex);
+    if (!known) {
+        return LIB_ERR_NAMESERVICE_UNKNOWN_NAME;
+    }
+
+    if (disp_get_core_id() == 0) {
+        err = ns_registry_remove(name, 0);
+    } else {
+        err = ns_registry_call(NS_DEREGISTER, name, NULL);
+    }
+    if (err_is_fail(err)) {
+        return err;
+    }
+
+    thread_mutex_lock(&ns_mutex);
+    struct ns_service **srv = ns_service_find(name);
+    struct ns_service *old = *srv;
+    if (old != NULL) {
+        *srv = old->next;
+    }
+    thread_mutex_unlock(&ns_mutex);
+
+    // removed by a concurrent request otherwise
+    if (old != NULL) {
+        cap_destroy(old->ep);
+        free(old);
+    }
+    return SYS_ERR_OK;
+}
+
+errval_t ns_lookup(const char *name, coreid_t *core, struct capref *ep)
+{
+    errval_t err;
+
+    if (disp_get_core_id() == 0) {
+        err = ns_registry_lookup(name, core);
+    } else {
+        err = ns_registry_call(NS_LOOKUP, name, core);
+    }
+    if (err_is_fail(err)) {
+        return err;
+    }
+
+    *ep = NULL_CAP;
+    if (*core == disp_get_core_id()) {
+        thread_mutex_lock(&ns_mutex);
+        struct ns_service *srv = *ns_service_find(name);
+        if (srv != NULL) {
+            *ep = srv->ep;
+        }
+        thread_mutex_unlock(&ns_mutex);
+        if (srv == NULL) {
+            return LIB_ERR_NAMESERVICE_UNKNOWN_NAME;
+        }
+    }
+    return SYS_ERR_OK;
+}
+
+errval_t ns_enumerate(const char *query, struct ns_frame_output *out, size_t size)
+{
+    errval_t err;
+
+    if (disp_get_core_id() == 0) {
+        ns_registry_enumerate(query, out, size);
+        return SYS_ERR_OK;
+    }
+
+    struct ump_payload msg, reply;
+    msg.type = NS_ENUMERATE;
+    strncpy(msg.payload, query, NS_NAME_LEN);
+    msg.payload[NS_NAME_LEN - 1] = '\0';
+
+    struct ump_chan *chan = get_ump_demux_peer(0)->chan;
+    err = ns_ump_call(0, &msg, &reply);
+    void *data = ump_msg_data(chan, &reply);
+    if (err_is_ok(err) && data != NULL) {
+        memcpy(out, data, MIN(reply.data_len, size));
+    } else if (err_is_ok(err)) {
+        out->num = 0;
+    }
+    ump_msg_release(chan, &reply);
+    return err;
+}
+
+errval_t ns_bind_ump(const char *name, coreid_t core, struct capref frame)
+{
+    errval_t err;
+
+    if (core == disp_get_core_id()) {
+        err = ns_deliver_ump(name, frame);
+        cap_destroy(frame);
+        return err;
+    }
+
+    // the init on the server's core recreates the frame and passes it on
+    struct ump_ns_bind bind;
+    err = captx_prepare_send(frame, core, &bind.cap);
+    if (err_is_fail(err)) {
+        cap_destroy(frame);
+        return err;
+    }
+    strncpy(bind.name, name, NS_NAME_LEN);
+    bind.name[NS_NAME_LEN - 1] = '\0';
+
+    struct ump_payload msg, reply;
+    msg.type = NS_BIND_UMP;
+    memcpy(msg.payload, &bind, sizeof(bind));
+    err = ns_ump_call(core, &msg, &reply);
+
+    cap_destroy(frame);
+    return err;
+}
+
+
+/*
+ * ------------------------------------------------------------------------------------------------
+ * Requests from other cores
+ * ------------------------------------------------------------------------------------------------
+ */
+
+static void ns_ump_reply(struct ump_payload *msg, errval_t err, coreid_t core, const void *data,
+                         size_t len)
+{
+    struct ump_payload reply;
+    reply.type = NS_REPLY;
+    reply.send_core = disp_get_core_id();
+    reply.recv_core = msg->send_core;
+    struct ns_ump_reply r = { .err = err, .core = core };
+    memcpy(reply.payload, &r, sizeof(r));
+
+    struct ump_chan *chan = get_ump_chan_peer(msg->send_core, 0);
+    if (len > 0) {
+        err = ump_send_data(chan, &reply, data, len);
+    } else {
+        reply.data_len = 0;
+        err = ump_send(chan, (char *)&reply, sizeof(reply));
+    }
+    if (err_is_fail(err)) {
+        DEBUG_ERR(err, "couldn't answer a nameservice request from core %d", msg->send_core);
+    }
+}
+
+// registry requests, only ever sent to core 0
+static bool ns_ump_registry_handler(struct ump_payload *msg, void *arg)
+{
+    (void)arg;
+    errval_t err;
+    coreid_t core = msg->send_core;
+
+    char name[NS_NAME_LEN];
+    memcpy(name, msg->payload, NS_NAME_LEN);
+    name[NS_NAME_LEN - 1] = '\0';
+
+    switch (msg->type) {
+    case NS_REGISTER:
+        err = ns_registry_add(name, msg->send_core);
+        break;
+    case NS_DEREGISTER:
+        err = ns_registry_remove(name, msg->send_core);
+        break;
+    case NS_LOOKUP:
+        err = ns_registry_lookup(name, &core);
+        break;
+    case NS_ENUMERATE: {
+        struct ns_frame_output *out = malloc(AOS_RPC_BULK_SIZE);
+        if (out == NULL) {
+            err = LIB_ERR_MALLOC_FAIL;
+            break;
+        }
+        size_t len = ns_registry_enumerate(name, out, AOS_RPC_BULK_SIZE);
+        ns_ump_reply(msg, SYS_ERR_OK, core, out, len);
+        free(out);
+        return true;
+    }
+    default:
+        return false;
+    }
+
+    ns_ump_reply(msg, err, core, NULL, 0);
+    return true;
+}
+
+// a client on another core binds to a server on this one
+static bool ns_ump_bind_handler(struct ump_payload *msg, void *arg)
+{
+    (void)arg;
+    errval_t err;
+
+    struct ump_ns_bind bind;
+    memcpy(&bind, msg->payload, sizeof(bind));
+    bind.name[NS_NAME_LEN - 1] = '\0';
+
+    struct capref frame;
+    err = captx_handle_recv(&bind.cap, &frame);
+    if (err_is_ok(err)) {
+        err = ns_deliver_ump(bind.name, frame);
+        cap_destroy(frame);
+    }
+
+    ns_ump_reply(msg, err, disp_get_core_id(), NULL, 0);
+    return true;
+}
+
+void ns_register_ump_handlers(struct ump_demux *dm)
+{
+    if (disp_get_core_id() == 0) {
+        ump_demux_register(dm, NS_REGISTER, ns_ump_registry_handler, dm);
+        ump_demux_register(dm, NS_DEREGISTER, ns_ump_registry_handler, dm);
+        ump_demux_register(dm, NS_LOOKUP, ns_ump_registry_handler, dm);
+        ump_demux_register(dm, NS_ENUMERATE, ns_ump_registry_handler, dm);
+    }
+    ump_demux_register(dm, NS_BIND_UMP, ns_ump_bind_handler, dm);
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2023, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+/**
+ * @file
+ * @brief Brokering channels between nameservice clients and servers
+ *
+ * The init on core 0 keeps the core every name is registered on, the init on each core the
+ * endpoints of the servers running there. Neither is involved once a client has its channel.
+ */
+
+#ifndef INIT_NAMESERVICE_H_
+#define INIT_NAMESERVICE_H_ 1
+
+#include <aos/aos.h>
+#include <aos/aos_rpc.h>
+
+
+/**
+ * @brief registers a server on this core under a name
+ *
+ * @param[in] name  the name
+ * @param[in] ep    endpoint the server accepts new channels on, kept on success and
+ *                  destroyed otherwise
+ *
+ * @return SYS_ERR_OK on success, LIB_ERR_NAMESERVICE_ALREADY_REGISTRED if the name is taken
+ */
+errval_t ns_register(const char *name, struct capref ep);
+
+/**
+ * @brief removes a name registered on this core
+ *
+ * @param[in] name  the name
+ *
+ * @return SYS_ERR_OK on success, error value on failure
+ */
+errval_t ns_deregister(const char *name);
+
+/**
+ * @brief finds the server registered under a name
+ *
+ * @param[in]  name  the name
+ * @param[out] core  the core the server runs on
+ * @param[out] ep    its endpoint if that is this core, NULL_CAP otherwise
+ *
+ * @return SYS_ERR_OK on success, LIB_ERR_NAMESERVICE_UNKNOWN_NAME if there is none
+ */
+errval_t ns_lookup(const char *name, coreid_t *core, struct capref *ep);
+
+/**
+ * @brief lists the registered names starting with a prefix
+ *
+ * @param[in]  query  the prefix
+ * @param[out] out    filled in with the names
+ * @param[in]  size   size of out in bytes
+ *
+ * @return SYS_ERR_OK on success, error value on failure
+ */
+errval_t ns_enumerate(const char *query, struct ns_frame_output *out, size_t size);
+
+/**
+ * @brief hands a frame holding a UMP channel to a server, possibly on another core
+ *
+ * @param[in] name   the name the server is registered under
+ * @param[in] core   the core it runs on
+ * @param[in] frame  the frame, destroyed once it has been passed on
+ *
+ * @return SYS_ERR_OK on success, error value on failure
+ */
+errval_t ns_bind_ump(const char *name, coreid_t core, struct capref frame);
+
+/**
+ * @brief handles the nameservice requests of the init on another core
+ *
+ * @param[in] dm  the channel from that core
+ */
+void ns_register_ump_handlers(struct ump_demux *dm);
+
+#endif /* INIT_NAMESERVICE_H_ */
@@ -27,12 +27,43 @@
 #include <spawn/argv.h>
 
 #include "proc_mgmt.h"
+#include "distops/captx.h"
 
 extern struct bootinfo *bi;
 extern coreid_t         my_core_id;
 
-// TODO: make this work with multiple cores.
-struct spawninfo* root = NULL;
+/// buckets of either index of a fresh process table, a power of two
+#define PROC_TABLE_MIN_BUCKETS 64
+
+/// the processes spawned on this core, indexed by PID and by binary name
+struct proc_table {
+    struct spawninfo **by_pid;   ///< buckets chained through pid_next
+    struct spawninfo **by_name;  ///< buckets chained through name_next
+    size_t             buckets;  ///< number of buckets of either index, a power of two
+    size_t             count;    ///< number of processes in the table
+};
+
+static struct spawninfo *initial_by_pid[PROC_TABLE_MIN_BUCKETS];
+static struct spawninfo *initial_by_name[PROC_TABLE_MIN_BUCKETS];
+
+static struct proc_table procs = {
+    .by_pid  = initial_by_pid,
+    .by_name = initial_by_name,
+    .buckets = PROC_TABLE_MIN_BUCKETS,
+    .count   = 0,
+};
+
+/// terminated processes kept for a later wait, beyond that the oldest ones are reaped
+#define PROC_ZOMBIES_MAX 64
+
+/// terminated processes nobody has waited for yet, oldest first, chained through name_next
+static struct spawninfo *zombie_head;
+static struct spawninfo *zombie_tail;
+static size_t            zombie_count;
+
+// spawning happens on init's worker threads, the table is read from the dispatcher meanwhile
+static struct thread_mutex proc_mutex = THREAD_MUTEX_INITIALIZER;
+static domainid_t          next_pid   = 1;
 
 
 /*
@@ -41,8 +72,7 @@ struct spawninfo* root = NULL;
  * ------------------------------------------------------------------------------------------------
  */
 
-__attribute__((__used__)) static void spawn_info_to_proc_status(struct spawninfo   *si,
-                                                                struct proc_status *status)
+static void spawn_info_to_proc_status(struct spawninfo *si, struct proc_status *status)
 {
     status->core      = my_core_id;
     status->pid       = si->pid;
@@ -82,6 +112,186 @@ __attribute__((__used__)) static void spawn_info_to_proc_status(struct spawninfo
  * ------------------------------------------------------------------------------------------------
  */
 
+static inline size_t pid_bucket(domainid_t pid, size_t buckets)
+{
+    // only this core's PIDs are in the table, their counters are consecutive
+    return pid & (buckets - 1);
+}
+
+static size_t name_bucket(const char *name, size_t buckets)
+{
+    // FNV-1a
+    uint32_t h = 2166136261u;
+    for (const char *c = name; *c != '\0'; c++) {
+        h = (h ^ (uint8_t)*c) * 16777619u;
+    }
+    return h & (buckets - 1);
+}
+
+// appends to the name chain, which so stays ordered by PID: PIDs only grow
+static void proc_table_link_name(struct proc_table *t, struct spawninfo *si)
+{
+    struct spawninfo **pos = &t->by_name[name_bucket(si->binary_name, t->buckets)];
+    while (*pos != NULL) {
+        pos = &(*pos)->name_next;
+    }
+    si->name_next = NULL;
+    *pos = si;
+}
+
+static void proc_table_link(struct proc_table *t, struct spawninfo *si)
+{
+    size_t b = pid_bucket(si->pid, t->buckets);
+    si->pid_next = t->by_pid[b];
+    t->by_pid[b] = si;
+
+    // a process that failed to load has no name and can only be found by PID
+    si->name_next = NULL;
+    if (si->binary_name != NULL) {
+        proc_table_link_name(t, si);
+    }
+}
+
+static void proc_table_unlink_name(struct proc_table *t, struct spawninfo *si)
+{
+    struct spawninfo **pos = &t->by_name[name_bucket(si->binary_name, t->buckets)];
+    while (*pos != NULL && *pos != si) {
+        pos = &(*pos)->name_next;
+    }
+    if (*pos == si) {
+        *pos = si->name_next;
+    }
+    si->name_next = NULL;
+}
+
+static void proc_table_unlink_pid(struct proc_table *t, struct spawninfo *si)
+{
+    struct spawninfo **pos = &t->by_pid[pid_bucket(si->pid, t->buckets)];
+    while (*pos != NULL && *pos != si) {
+        pos = &(*pos)->pid_next;
+    }
+    if (*pos == si) {
+        *pos = si->pid_next;
+        t->count--;
+    }
+}
+
+// doubles the buckets, with proc_mutex held. The table stays as is if memory runs out.
+static void proc_table_grow(struct proc_table *t)
+{
+    size_t buckets = t->buckets * 2;
+    struct spawninfo **by_pid  = calloc(buckets, sizeof(*by_pid));
+    struct spawninfo **by_name = calloc(buckets, sizeof(*by_name));
+    if (by_pid == NULL || by_name == NULL) {
+        free(by_pid);
+        free(by_name);
+        return;
+    }
+
+    struct proc_table grown = { .by_pid = by_pid, .by_name = by_name, .buckets = buckets,
+                                .count = t->count };
+    for (size_t i = 0; i < t->buckets; i++) {
+        for (struct spawninfo *si = t->by_pid[i], *next; si != NULL; si = next) {
+            next = si->pid_next;
+            size_t b = pid_bucket(si->pid, buckets);
+            si->pid_next = by_pid[b];
+            by_pid[b] = si;
+        }
+        // the old chain is in PID order, appending keeps the new ones in it
+        for (struct spawninfo *si = t->by_name[i], *next; si != NULL; si = next) {
+            next = si->name_next;
+            proc_table_link_name(&grown, si);
+        }
+    }
+
+    if (t->by_pid != initial_by_pid) {
+        free(t->by_pid);
+        free(t->by_name);
+    }
+    *t = grown;
+}
+
+// finds a process by PID, with proc_mutex held
+static struct spawninfo *proc_table_find(struct proc_table *t, domainid_t pid)
+{
+    if (PROC_PID_CORE(pid) != my_core_id) {
+        return NULL;
+    }
+    struct spawninfo *si = t->by_pid[pid_bucket(pid, t->buckets)];
+    while (si != NULL && si->pid != pid) {
+        si = si->pid_next;
+    }
+    return si;
+}
+
+// finds the live process with the smallest PID running a binary, with proc_mutex held.
+// Processes leave the name index when they terminate, the first match is the one.
+static struct spawninfo *proc_table_find_name(struct proc_table *t, const char *name)
+{
+    struct spawninfo *si = t->by_name[name_bucket(name, t->buckets)];
+    while (si != NULL && strcmp(si->binary_name, name) != 0) {
+        si = si->name_next;
+    }
+    return si;
+}
+
+// removes a terminated process from the table and frees it, with proc_mutex held
+static void proc_table_reap(struct proc_table *t, struct spawninfo *si)
+{
+    struct spawninfo **pos = &zombie_head;
+    struct spawninfo  *prev = NULL;
+    while (*pos != NULL && *pos != si) {
+        prev = *pos;
+        pos  = &(*pos)->name_next;
+    }
+    if (*pos == si) {
+        *pos = si->name_next;
+        if (zombie_tail == si) {
+            zombie_tail = prev;
+        }
+        zombie_count--;
+    }
+
+    proc_table_unlink_pid(t, si);
+    // TODO: the capabilities of the process are still not cleaned up, see spawn_cleanup()
+    free(si->binary_name);
+    free(si);
+}
+
+struct spawninfo *proc_mgmt_find(domainid_t pid)
+{
+    thread_mutex_lock(&proc_mutex);
+    struct spawninfo *si = proc_table_find(&procs, pid);
+    thread_mutex_unlock(&proc_mutex);
+    return si;
+}
+
+static domainid_t alloc_pid(void)
+{
+    const domainid_t counter_mask = (1u << PROC_PID_CORE_SHIFT) - 1;
+
+    thread_mutex_lock(&proc_mutex);
+    domainid_t pid;
+    do {
+        pid = ((domainid_t)my_core_id << PROC_PID_CORE_SHIFT) | (next_pid++ & counter_mask);
+        // the RPC replies use a few PIDs to say there is no process
+    } while ((pid & counter_mask) == 0 || pid == SPAWN_ERR_PID || pid == NOT_TERMINATED_PID);
+    thread_mutex_unlock(&proc_mutex);
+    return pid;
+}
+
+// adds a loaded process to the table, before it runs and sends its first requests
+static void publish_process(struct spawninfo *si)
+{
+    thread_mutex_lock(&proc_mutex);
+    if (procs.count >= procs.buckets) {
+        proc_table_grow(&procs);
+    }
+    proc_table_link(&procs, si);
+    procs.count++;
+    thread_mutex_unlock(&proc_mutex);
+}
+
 static errval_t parse_args(const char *cmdline, int *argc, char *argv[])
 {
     // check if we have at least one argument
@@ -106,6 +316,66 @@ static errval_t parse_args(const char *cmdline, int *argc, char *argv[])
     return SYS_ERR_OK;
 }
 
+// have init on another core spawn the process, the capabilities are recreated over there
+static errval_t spawn_with_caps_remote(int argc, const char *argv[], int capc,
+                                       struct capref capv[], coreid_t core, domainid_t *pid)
+{
+    errval_t err;
+
+    if (!ump_peer_connected(core)) {
+        return MON_ERR_INVALID_CORE_ID;
+    }
+    if (capc > UMP_SPAWN_MAX_CAPS) {
+        return MON_ERR_CAP_SEND;
+    }
+
+    struct ump_spawn_caps req = { .argc = argc, .capc = capc };
+    for (int i = 0; i < capc; i++) {
+        err = captx_prepare_send(capv[i], core, &req.capv[i]);
+        if (err_is_fail(err)) {
+            return err;
+        }
+    }
+
+    // the arguments go through the data area, back to back
+    size_t args_len = 0;
+    for (int i = 0; i < argc; i++) {
+        args_len += strlen(argv[i]) + 1;
+    }
+    char *args = malloc(args_len);
+    if (args == NULL) {
+        return LIB_ERR_MALLOC_FAIL;
+    }
+    char *arg = args;
+    for (int i = 0; i < argc; i++) {
+        size_t len = strlen(argv[i]) + 1;
+        memcpy(arg, argv[i], len);
+        arg += len;
+    }
+
+    struct ump_payload send_msg;
+    send_msg.type = SPAWN_WITH_CAPS_MSG;
+    send_msg.send_core = my_core_id;
+    send_msg.recv_core = core;
+    memcpy(send_msg.payload, &req, sizeof(req));
+
+    // other threads may be spawning there as well, the acks would get mixed up
+    struct ump_demux *dm = get_ump_demux_peer(core);
+    struct ump_payload recv_msg;
+    thread_mutex_lock_nested(&dm->call_mutex);
+    err = ump_send_data(get_ump_chan_peer(core, 0), &send_msg, args, args_len);
+    free(args);
+    if (err_is_ok(err)) {
+        err = ump_demux_wait(dm, PID_ACK, &recv_msg);
+    }
+    thread_mutex_unlock(&dm->call_mutex);
+    if (err_is_fail(err)) {
+        return err;
+    }
+    *pid = *(domainid_t *)recv_msg.payload;
+    return *pid == SPAWN_ERR_PID ? SPAWN_ERR_LOAD : SYS_ERR_OK;
+}
+
 /**
  * @brief spawns a new process with the given arguments and capabilities on the given core.
  *
@@ -133,20 +403,19 @@ errval_t proc_mgmt_spawn_with_caps(int argc, const char *argv[], int capc, struc
     (void)capv;
     (void)core;
     (void)pid;
-    struct spawninfo * si = (struct spawninfo *) malloc(sizeof(struct spawninfo));
+
+    if (core != my_core_id) {
+        return spawn_with_caps_remote(argc, argv, capc, capv, core, pid);
+    }
+
+    struct spawninfo * si = calloc(1, sizeof(struct spawninfo));
     if (si == NULL) {
         debug_printf("malloc failed in spawn with caps\n");
         abort();
     }
     struct elfimg ei;
 
-    si->next = root;
-    if (si->next == NULL) {
-        si->pid = 1;
-    } else {
-        si->pid = si->next->pid + 1;
-    }
-    root = si;
+    si->pid = alloc_pid();
     struct mem_region* module = multiboot_find_module(bi, argv[0]);
     if (module == NULL) {
         // debug_printf("multiboot_find_module failed to find %s\n", argv[0]);
@@ -160,9 +429,11 @@ errval_t proc_mgmt_spawn_with_caps(int argc, const char *argv[], int capc, struc
     elfimg_init_from_module(&ei, module);
     err = spawn_load_with_caps(si, &ei, argc, argv, capc, capv, si->pid);
     DEBUG_ERR_ON_FAIL(err, "couldn't spawn load with caps\n");
+    publish_process(si);
+    // once started, the process may exit and be reaped before we get to look at si again
+    *pid = si->pid;
     err = spawn_start(si);
     DEBUG_ERR_ON_FAIL(err, "couldn't start loaded process\n");
-    *pid = si->pid;
     // TODO:
     //  - optional - if we want to stop and restart processes (or kill at all) keep track of 
     //    allocated cnodes so we can deallocate later
@@ -211,95 +482,38 @@ errval_t proc_mgmt_spawn_with_cmdline(const char *cmdline, coreid_t core, domain
     send_msg.type = SPAWN_CMDLINE;
     send_msg.send_core = my_core_id;
     send_msg.recv_core = core;
-    strncpy(send_msg.payload, cmdline, 128);
-
-    if (my_core_id == 0) {
-        // send directly to app core
-        debug_printf("sending spawn message from bsp to core %d\n", core);
-        err = ump_send(get_ump_chan_mon(core, 1), (char *)&send_msg, sizeof(struct ump_payload));
-        DEBUG_ERR_ON_FAIL(err, "couldn't send spawn message to app core\n");
-
-        // wait for response and set the pid
-        struct ump_payload recv_msg;
-        debug_printf("waiting for pid from core %d\n", core);
-        while (true) {
-            err = ump_receive(get_ump_chan_mon(core, 0), PID_ACK, &recv_msg);
-            if (err == SYS_ERR_OK) {
-                // debug_printf("got pid %d\n", *(domainid_t *)recv_msg.payload);
-
-                // if recv_msg's recv_core is not core, then we need to forward the message
-                if (recv_msg.recv_core != my_core_id) {
-                    debug_printf("forwarding pid to core %d\n", recv_msg.recv_core);
-                    err = ump_send(get_ump_chan_mon(recv_msg.recv_core, 1), (char *)&recv_msg, sizeof(struct ump_payload));
-                    DEBUG_ERR_ON_FAIL(err, "couldn't send spawn message to app core\n");
-                } else {
-                    *pid = *(domainid_t *)recv_msg.payload;
-                }
-                break;
-            } else if (err == LIB_ERR_UMP_CHAN_RECV) {
-                // another message needs to be processed first
-                // debug_printf("another message needs to be processed first\n");
-                // err = ump_receive(get_ump_chan_mon(core, 0), SPAWN_CMDLINE, &recv_msg);
-                // if (err == SYS_ERR_OK) {
-                //     domainid_t spawn_pid;
-                //     err = spawn_with_cmdline_same_core(recv_msg.payload, &spawn_pid);
-                //     if (err_is_fail(err)) {
-                //         spawn_pid = SPAWN_ERR_PID;
-                //     }
-
-                //     // send pid back in ack
-                //     struct ump_payload ack_msg;
-                //     ack_msg.type = PID_ACK;
-                //     ack_msg.send_core = my_core_id;
-                //     ack_msg.recv_core = recv_msg.send_core;
-                //     *(domainid_t *)ack_msg.payload = spawn_pid;
-                //     err = ump_send(get_ump_chan_mon(recv_msg.send_core, 1), (char *)&ack_msg, sizeof(struct ump_payload));
-                //     DEBUG_ERR_ON_FAIL(err, "couldn't send ack message to app core\n");
-                //     debug_printf("successfully sent ack for intermediate message\n");
-                // }
-            }
-            thread_yield();
-        }
+    send_msg.data_len = 0;
+    strncpy(send_msg.payload, cmdline, sizeof(send_msg.payload));
+
+    if (!ump_peer_connected(core)) {
+        return MON_ERR_INVALID_CORE_ID;
+    }
+
+    // every core has a direct channel to every other one.
+    // command lines that don't fit into the message go through the channel's data area
+    debug_printf("sending spawn message from core %d to core %d\n", my_core_id, core);
+    size_t cmdline_len = strlen(cmdline) + 1;
+    struct ump_chan *chan = get_ump_chan_peer(core, 0);
+    struct ump_demux *dm = get_ump_demux_peer(core);
+    thread_mutex_lock_nested(&dm->call_mutex);
+    if (cmdline_len > sizeof(send_msg.payload)) {
+        err = ump_send_data(chan, &send_msg, cmdline, cmdline_len);
     } else {
-        // send to bsp core to forward to app core
-        debug_printf("sending spawn message from core %d to bsp\n", my_core_id);
-        err = ump_send(get_ump_chan_core(0), (char *)&send_msg, sizeof(struct ump_payload));
-        DEBUG_ERR_ON_FAIL(err, "couldn't send spawn message to bsp\n");
-
-        // wait for response and set the pid
-        struct ump_payload recv_msg;
-        while (true) {
-            err = ump_receive(get_ump_chan_core(1), PID_ACK, &recv_msg);
-            if (err == SYS_ERR_OK) {
-                // debug_printf("got pid %d\n", *(domainid_t *)recv_msg.payload);
-                *pid = *(domainid_t *)recv_msg.payload;
-                break;
-            } else if (err == LIB_ERR_UMP_CHAN_RECV) {
-                debug_printf("another message needs to be processed first\n");
-                err = ump_receive(get_ump_chan_core(1), SPAWN_CMDLINE, &recv_msg);
-                if (err == SYS_ERR_OK) {
-                    domainid_t spawn_pid;
-                    err = spawn_with_cmdline_same_core(recv_msg.payload, &spawn_pid);
-                    if (err_is_fail(err)) {
-                        continue;
-                    }
-
-                    // send pid back in ack
-                    struct ump_payload ack_msg;
-                    ack_msg.type = PID_ACK;
-                    ack_msg.send_core = my_core_id;
-                    ack_msg.recv_core = recv_msg.send_core;
-                    *(domainid_t *)ack_msg.payload = spawn_pid;
-                    err = ump_send(get_ump_chan_core(0), (char *)&ack_msg, sizeof(struct ump_payload));
-                    DEBUG_ERR_ON_FAIL(err, "couldn't send ack message to app core\n");
-                    debug_printf("successfully sent ack for intermediate message\n");
-                    // ump_print(get_ump_chan_core(1));
-                }
-            }
-            thread_yield();
-        }
+        err = ump_send(chan, (char *)&send_msg, sizeof(struct ump_payload));
+    }
+    if (err_is_fail(err)) {
+        thread_mutex_unlock(&dm->call_mutex);
+        DEBUG_ERR(err, "couldn't send spawn message to core %d\n", core);
+        return err;
     }
 
+    // wait for response and set the pid, requests from other cores are handled in the meantime
+    struct ump_payload recv_msg;
+    err = ump_demux_wait(dm, PID_ACK, &recv_msg);
+    thread_mutex_unlock(&dm->call_mutex);
+    DEBUG_ERR_ON_FAIL(err, "couldn't receive pid from core %d\n", core);
+    *pid = *(domainid_t *)recv_msg.payload;
+
     return SYS_ERR_OK;
 }
 
@@ -325,22 +539,192 @@ errval_t proc_mgmt_spawn_program(const char *path, coreid_t core, domainid_t *pi
     
     // Note: With multicore support, you many need to send a message to the other core
 
-    struct spawninfo * si = (struct spawninfo *) malloc(sizeof(struct spawninfo));
+    struct spawninfo * si = calloc(1, sizeof(struct spawninfo));
 
-    si->next = root;
-    if (si->next == NULL) {
-        si->pid = 1;
-    } else {
-        si->pid = si->next->pid + 1;
-    }
-    root = si;
-    
+    si->pid = alloc_pid();
     spawn_load_with_bootinfo(si, bi, path, si->pid);
+    publish_process(si);
+    *pid = si->pid;
     spawn_start(si);
     return SYS_ERR_OK;
 }
 
 
+/*
+ * ------------------------------------------------------------------------------------------------
+ * Processes of Other Cores
+ * ------------------------------------------------------------------------------------------------
+ */
+
+// asks the init on another core about its processes. The data of the reply, if any, is
+// returned in a buffer the caller frees.
+static errval_t proc_remote_call(coreid_t core, enum ump_proc_op op, domainid_t pid,
+                                 struct ump_proc_reply *reply, void **data, size_t *len)
+{
+    errval_t err;
+
+    if (data != NULL) {
+        *data = NULL;
+        *len  = 0;
+    }
+    if (core == my_core_id || !ump_peer_connected(core)) {
+        return SPAWN_ERR_DOMAIN_NOTFOUND;
+    }
+
+    struct ump_proc_req req = { .op = op, .pid = pid };
+    struct ump_payload msg;
+    msg.type      = PROC_MGMT_REQ;
+    msg.send_core = my_core_id;
+    msg.recv_core = core;
+    msg.data_len  = 0;
+    memcpy(msg.payload, &req, sizeof(req));
+
+    // the replies of concurrent requests to the same core would get mixed up
+    struct ump_demux *dm = get_ump_demux_peer(core);
+    thread_mutex_lock_nested(&dm->call_mutex);
+    err = ump_send(get_ump_chan_peer(core, 0), (char *)&msg, sizeof(msg));
+    if (err_is_ok(err)) {
+        err = ump_demux_wait(dm, PROC_MGMT_REPLY, &msg);
+    }
+    thread_mutex_unlock(&dm->call_mutex);
+    if (err_is_fail(err)) {
+        return err;
+    }
+
+    memcpy(reply, msg.payload, sizeof(*reply));
+    if (data != NULL) {
+        void *msg_data = ump_msg_data(dm->chan, &msg);
+        if (msg_data != NULL && msg.data_len > 0) {
+            *data = malloc(msg.data_len);
+            if (*data == NULL) {
+                err = LIB_ERR_MALLOC_FAIL;
+            } else {
+                memcpy(*data, msg_data, msg.data_len);
+                *len = msg.data_len;
+            }
+        }
+    }
+    ump_msg_release(dm->chan, &msg);
+    return err;
+}
+
+static errval_t proc_local_status(domainid_t pid, struct proc_status *status)
+{
+    thread_mutex_lock(&proc_mutex);
+    struct spawninfo *si = proc_table_find(&procs, pid);
+    if (si != NULL) {
+        spawn_info_to_proc_status(si, status);
+    }
+    thread_mutex_unlock(&proc_mutex);
+    return si != NULL ? SYS_ERR_OK : SPAWN_ERR_DOMAIN_NOTFOUND;
+}
+
+static errval_t proc_local_try_wait(domainid_t pid, int *status, bool *terminated)
+{
+    thread_mutex_lock(&proc_mutex);
+    struct spawninfo *si = proc_table_find(&procs, pid);
+    *terminated = si != NULL
+                  && (si->state == SPAWN_STATE_TERMINATED || si->state == SPAWN_STATE_KILLED);
+    if (*terminated) {
+        *status = si->state == SPAWN_STATE_KILLED ? -1 : si->exitcode;
+        proc_table_reap(&procs, si);
+    }
+    thread_mutex_unlock(&proc_mutex);
+    return si != NULL ? SYS_ERR_OK : SPAWN_ERR_DOMAIN_NOTFOUND;
+}
+
+// the PIDs of the running processes on this core, in an array the caller frees
+static errval_t proc_local_list(domainid_t **pids, size_t *num)
+{
+    thread_mutex_lock(&proc_mutex);
+    size_t n = 0;
+    for (size_t b = 0; b < procs.buckets; b++) {
+        for (struct spawninfo *si = procs.by_pid[b]; si != NULL; si = si->pid_next) {
+            if (si->state == SPAWN_STATE_RUNNING) {
+                n++;
+            }
+        }
+    }
+    *pids = malloc(sizeof(domainid_t) * MAX(n, 1));
+    if (*pids == NULL) {
+        thread_mutex_unlock(&proc_mutex);
+        *num = 0;
+        return LIB_ERR_MALLOC_FAIL;
+    }
+
+    *num = 0;
+    for (size_t b = 0; b < procs.buckets; b++) {
+        for (struct spawninfo *si = procs.by_pid[b]; si != NULL; si = si->pid_next) {
+            if (si->state == SPAWN_STATE_RUNNING && *num < n) {
+                (*pids)[(*num)++] = si->pid;
+            }
+        }
+    }
+    thread_mutex_unlock(&proc_mutex);
+    return SYS_ERR_OK;
+}
+
+// answers another core's request about the processes spawned here
+static bool proc_ump_handler(struct ump_payload *msg, void *arg)
+{
+    (void)arg;
+
+    struct ump_proc_req req;
+    memcpy(&req, msg->payload, sizeof(req));
+
+    struct ump_proc_reply reply = { .err = SYS_ERR_OK, .status = 0, .terminated = false };
+    struct proc_status    status;
+    domainid_t           *pids = NULL;
+    void                 *data = NULL;
+    size_t                len  = 0;
+    switch (req.op) {
+    case UMP_PROC_STATUS:
+        reply.err = proc_local_status(req.pid, &status);
+        if (err_is_ok(reply.err)) {
+            data = &status;
+            len  = sizeof(status);
+        }
+        break;
+    case UMP_PROC_TRY_WAIT:
+        reply.err = proc_local_try_wait(req.pid, &reply.status, &reply.terminated);
+        break;
+    case UMP_PROC_LIST: {
+        size_t num;
+        reply.err = proc_local_list(&pids, &num);
+        data = pids;
+        len  = num * sizeof(domainid_t);
+        break;
+    }
+    default:
+        reply.err = LIB_ERR_NOT_IMPLEMENTED;
+    }
+
+    struct ump_payload ack;
+    ack.type      = PROC_MGMT_REPLY;
+    ack.send_core = my_core_id;
+    ack.recv_core = msg->send_core;
+    memcpy(ack.payload, &reply, sizeof(reply));
+    struct ump_chan *chan = get_ump_chan_peer(msg->send_core, 0);
+    errval_t err;
+    if (len > 0) {
+        err = ump_send_data(chan, &ack, data, len);
+    } else {
+        ack.data_len = 0;
+        err = ump_send(chan, (char *)&ack, sizeof(ack));
+    }
+    if (err_is_fail(err)) {
+        DEBUG_ERR(err, "couldn't answer a process request from core %d", msg->send_core);
+    }
+    free(pids);
+    return true;
+}
+
+void proc_mgmt_register_ump_handlers(struct ump_demux *dm)
+{
+    ump_demux_register(dm, PROC_MGMT_REQ, proc_ump_handler, dm);
+}
+
+
 /*
  * ------------------------------------------------------------------------------------------------
  * Listing of Processes
@@ -361,35 +745,28 @@ errval_t proc_mgmt_spawn_program(const char *path, coreid_t core, domainid_t *pi
  */
 errval_t proc_mgmt_ps(struct proc_status **ps, size_t *num)
 {
-    // make compiler happy about unused parameters
-    (void)ps;
-    (void)num;
-
+    errval_t err;
 
-    // TODO: this is not done
-    struct spawninfo *curr = root;
-    while (curr != NULL) {
-        if (curr->state == SPAWN_STATE_RUNNING) {
-            (*num)++;
-        }
-        curr = curr->next;
+    domainid_t *pids;
+    size_t      npids;
+    err = proc_mgmt_get_proc_list(&pids, &npids);
+    if (err_is_fail(err)) {
+        return err;
+    }
+    *ps = malloc(sizeof(struct proc_status) * MAX(npids, 1));
+    if (*ps == NULL) {
+        free(pids);
+        return LIB_ERR_MALLOC_FAIL;
     }
-    *ps = (struct proc_status *) malloc(sizeof(struct proc_status) * (*num));
 
-    curr = root;
-    int i = 0;
-    while (curr != NULL) {
-        if (curr->state == SPAWN_STATE_RUNNING) {
-            ps[i]->pid = curr->pid;
-            ps[i]->core = curr->core_id;
-            ps[i]->state = PROC_STATE_RUNNING;
-            ps[i]->exit_code = curr->exitcode;
-            strncpy(ps[i]->cmdline, curr->cmdline, MAX_CMDLINE_ARGS);
-            i++;
+    // processes that exited in between are left out
+    *num = 0;
+    for (size_t i = 0; i < npids; i++) {
+        if (err_is_ok(proc_mgmt_get_status(pids[i], &(*ps)[*num]))) {
+            (*num)++;
         }
-        curr = curr->next;
     }
-
+    free(pids);
     return SYS_ERR_OK;
 }
 
@@ -406,31 +783,35 @@ errval_t proc_mgmt_ps(struct proc_status **ps, size_t *num)
  */
 errval_t proc_mgmt_get_proc_list(domainid_t **pids, size_t *num)
 {
-    // make compiler happy about unused parameters
-    (void)pids;
-    (void)num;
+    errval_t err;
 
-    // TODO:
-    //  - consult the process table to obtain a list of PIDs of the processes in the system
-    struct spawninfo *curr = root;
-    while (curr != NULL) {
-        if (curr->state == SPAWN_STATE_RUNNING) {
-            (*num)++;
-        }
-        curr = curr->next;
+    err = proc_local_list(pids, num);
+    if (err_is_fail(err)) {
+        return err;
     }
-    *pids = (domainid_t *) malloc(sizeof(domainid_t *) * (*num));  // TODO: memory leak? should malloc non-pointer??
 
-    curr = root;
-    int i = 0;
-    while (curr != NULL) {
-        if (curr->state == SPAWN_STATE_RUNNING) {
-            (*pids)[i] = curr->pid;
-            i++;
+    // add the processes of every other core, skipping the ones that cannot be reached
+    for (coreid_t core = 0; core < UMP_MAX_CORES; core++) {
+        if (core == my_core_id || !ump_peer_connected(core)) {
+            continue;
+        }
+        struct ump_proc_reply reply;
+        void  *data;
+        size_t len;
+        err = proc_remote_call(core, UMP_PROC_LIST, 0, &reply, &data, &len);
+        if (err_is_fail(err) || err_is_fail(reply.err) || data == NULL) {
+            free(data);
+            continue;
+        }
+        size_t      n     = len / sizeof(domainid_t);
+        domainid_t *grown = realloc(*pids, sizeof(domainid_t) * (*num + n));
+        if (grown != NULL) {
+            memcpy(grown + *num, data, n * sizeof(domainid_t));
+            *pids = grown;
+            *num += n;
         }
-        curr = curr->next;
+        free(data);
     }
-
     return SYS_ERR_OK;
 }
 
@@ -452,37 +833,13 @@ errval_t proc_mgmt_get_pid_by_name(const char *name, domainid_t *pid)
     // make compiler happy about unused parameters
     (void)name;
     (void)pid;
-    struct spawninfo *curr = root;
-    while (curr != NULL) {
-        if (strcmp(name, curr->binary_name) == 0) {
-            *pid = curr->pid;
-            return SYS_ERR_OK;
-        }
-        curr = curr->next;
-    }
-    *pid = -1;
-    return -1;
-}
 
-static proc_state_t get_proc_state_from_spawn_state(spawn_state_t state)
-{
-    switch (state) {
-        case SPAWN_STATE_RUNNING:
-            return PROC_STATE_RUNNING;
-        case SPAWN_STATE_UNKNOWN:
-            return PROC_STATE_UNKNOWN;
-        case SPAWN_STATE_SPAWNING:
-            return PROC_STATE_SPAWNING;
-        case SPAWN_STATE_SUSPENDED:
-            return PROC_STATE_PAUSED;
-        case SPAWN_STATE_KILLED:
-            return PROC_STATE_KILLED;
-        default:
-            USER_PANIC("invalid spawn state\n");
-            return -1;
-    }
-    USER_PANIC("invalid spawn state\n");
-    return -1;
+    thread_mutex_lock(&proc_mutex);
+    struct spawninfo *si = proc_table_find_name(&procs, name);
+    *pid = si != NULL ? si->pid : (domainid_t)-1;
+    thread_mutex_unlock(&proc_mutex);
+
+    return si != NULL ? SYS_ERR_OK : SPAWN_ERR_DOMAIN_NOTFOUND;
 }
 
 /**
@@ -495,29 +852,27 @@ static proc_state_t get_proc_state_from_spawn_state(spawn_state_t state)
  */
 errval_t proc_mgmt_get_status(domainid_t pid, struct proc_status *status)
 {
-    // make compiler happy about unused parameters
-    (void)pid;
-    (void)status;
+    errval_t err;
 
-    // TODO:
-    //   - get the status of the process with the given PID
-    struct spawninfo *curr = root;
-    while (curr != NULL) {
-        if (curr->pid == pid) {
-            status->core = curr->core_id;
-            status->state = get_proc_state_from_spawn_state(curr->state);
-            status->pid = pid;
-            status->exit_code = curr->exitcode;
-
-            strncpy(status->cmdline, curr->cmdline, MAX_CMDLINE_ARGS);
-
-            return SYS_ERR_OK;
-        }
-        curr = curr->next;
+    if (PROC_PID_CORE(pid) == my_core_id) {
+        return proc_local_status(pid, status);
     }
-    debug_printf("done\n");
 
-    return SPAWN_ERR_WRONG_STATE;
+    // the init that spawned the process keeps track of it
+    struct ump_proc_reply reply;
+    void  *data;
+    size_t len;
+    err = proc_remote_call(PROC_PID_CORE(pid), UMP_PROC_STATUS, pid, &reply, &data, &len);
+    if (err_is_fail(err)) {
+        return err;
+    }
+    if (err_is_ok(reply.err) && len == sizeof(*status)) {
+        memcpy(status, data, sizeof(*status));
+    } else if (err_is_ok(reply.err)) {
+        reply.err = SPAWN_ERR_DOMAIN_NOTFOUND;
+    }
+    free(data);
+    return reply.err;
 }
 
 
@@ -539,16 +894,14 @@ errval_t proc_mgmt_get_name(domainid_t pid, char **name, size_t len)
 
     // TODO:
     //   - get the name of the process with the given PID
-    struct spawninfo * curr = root;
-    while (curr != NULL) {
-        if (curr->pid == pid) {
-            // found our process
-            strcpy(*name, curr->binary_name);
-            len = strlen(curr->binary_name);
-        }
-        curr = curr->next;
+    struct spawninfo *si = proc_mgmt_find(pid);
+    if (si == NULL || si->binary_name == NULL || len == 0) {
+        return SPAWN_ERR_DOMAIN_NOTFOUND;
     }
-    return SPAWN_ERR_DOMAIN_NOTFOUND;
+
+    strncpy(*name, si->binary_name, len - 1);
+    (*name)[len - 1] = '\0';
+    return SYS_ERR_OK;
 }
 
 
@@ -637,25 +990,36 @@ errval_t proc_mgmt_exit(int status)
  */
 errval_t proc_mgmt_terminated(domainid_t pid, int status)
 {
-    // make compiler happy about unused parameters
-    (void)pid;
-    (void)status;
+    thread_mutex_lock(&proc_mutex);
+    struct spawninfo *si = proc_table_find(&procs, pid);
+    if (si == NULL || si->state == SPAWN_STATE_TERMINATED || si->state == SPAWN_STATE_KILLED) {
+        thread_mutex_unlock(&proc_mutex);
+        debug_printf("process %u exited but is not running on this core\n", pid);
+        return SPAWN_ERR_DOMAIN_NOTFOUND;
+    }
 
-    // debug_printf("entering proc_mgmt_exit\n");
-    struct spawninfo * curr = root;
-    while (curr != NULL) {
-        if (curr->pid == pid) {
-            // found our process
-            // debug_printf("found our process, here is the exit code we are using: %d\n", status);
-            curr->exitcode = status;
-            curr->state = SPAWN_STATE_TERMINATED;
-            // TODO: actually kill the process (bonus)
-            return SYS_ERR_OK;
-        }
-        curr = curr->next;
+    si->exitcode = status;
+    si->state    = SPAWN_STATE_TERMINATED;
+    // TODO: actually kill the process (bonus)
+
+    // it can no longer be found by name, and stays around by PID until it is waited for
+    if (si->binary_name != NULL) {
+        proc_table_unlink_name(&procs, si);
     }
-    debug_printf("\n!\n!\n!\n!tried to kill a process that doesn't exist!\n!\n!\n!\n");
-    return SPAWN_ERR_DOMAIN_NOTFOUND;
+    if (zombie_tail == NULL) {
+        zombie_head = si;
+    } else {
+        zombie_tail->name_next = si;
+    }
+    zombie_tail = si;
+    zombie_count++;
+
+    // nobody is going to wait for the oldest ones anymore
+    while (zombie_count > PROC_ZOMBIES_MAX) {
+        proc_table_reap(&procs, zombie_head);
+    }
+    thread_mutex_unlock(&proc_mutex);
+    return SYS_ERR_OK;
 }
 
 
@@ -669,42 +1033,46 @@ errval_t proc_mgmt_terminated(domainid_t pid, int status)
  */
 errval_t proc_mgmt_wait(domainid_t pid, int *status)
 {
-    // make compiler happy about unused parameters
-    (void)pid;
-    (void)status;
+    errval_t err;
 
-    struct spawninfo * curr = root;
-    // debug_printf("spawn_state_terminated: %d, killed: %d\n", SPAWN_STATE_TERMINATED, SPAWN_STATE_KILLED);
-
-    while (curr != NULL) {
-        if (curr->pid == pid) {
-            // debug_printf("pid: %d, state: %d\n", curr->pid, curr->state);
-            while(curr->state != SPAWN_STATE_TERMINATED && curr->state != SPAWN_STATE_KILLED) {
-                // wait;
-                //debug_printf("waiting...\n");
-                thread_yield();
-                // event_dispatch(get_default_waitset());
-            }
-            
-            // debug_printf("heres the exit code from inside proc_mgmt_wait: %d\n", curr->exitcode);
-            *status = curr->exitcode;
-            return SYS_ERR_OK;
+    // the exit message comes in on the default waitset, sleep on it until then
+    bool terminated = false;
+    while (true) {
+        err = proc_mgmt_try_wait(pid, status, &terminated);
+        if (err_is_fail(err) || terminated) {
+            return err;
+        }
+        err = event_dispatch(get_default_waitset());
+        if (err_is_fail(err)) {
+            return err_push(err, LIB_ERR_EVENT_DISPATCH);
         }
-        curr = curr->next;
     }
-    return SPAWN_ERR_DOMAIN_NOTFOUND;
+}
+
+errval_t proc_mgmt_try_wait(domainid_t pid, int *status, bool *terminated)
+{
+    errval_t err;
+
+    if (PROC_PID_CORE(pid) == my_core_id) {
+        return proc_local_try_wait(pid, status, terminated);
+    }
+
+    struct ump_proc_reply reply;
+    err = proc_remote_call(PROC_PID_CORE(pid), UMP_PROC_TRY_WAIT, pid, &reply, NULL, NULL);
+    if (err_is_fail(err)) {
+        return err;
+    }
+    *status     = reply.status;
+    *terminated = reply.terminated;
+    return reply.err;
 }
 
 // returns whether or not a process has terminated
 bool proc_mgmt_has_terminated(domainid_t pid) {
-    struct spawninfo *curr = root;
-    while (curr != NULL) {
-        if (curr->pid == pid) {
-            return (curr->state == SPAWN_STATE_TERMINATED || curr->state == SPAWN_STATE_KILLED);
-        }
-        curr = curr->next;
-    }
-    return false;
+    struct proc_status status;
+    errval_t err = proc_mgmt_get_status(pid, &status);
+    return err_is_ok(err)
+           && (status.state == PROC_STATE_EXITED || status.state == PROC_STATE_KILLED);
 }
 
 /**
@@ -14,10 +14,47 @@
 #include <aos/aos_rpc.h>
 #include <proc_mgmt/proc_mgmt.h>
 
+struct spawninfo;
 
+/// a PID carries the core that spawned the process above this bit, a per-core counter below
+#define PROC_PID_CORE_SHIFT 24
 
+/// the core whose init spawned, and keeps track of, the process with this PID
+#define PROC_PID_CORE(pid) ((coreid_t)((pid) >> PROC_PID_CORE_SHIFT))
 
 
+/**
+ * @brief finds a process spawned on this core
+ *
+ * @param[in] pid  the PID of the process
+ *
+ * @return its spawninfo, or NULL if there is no such process on this core
+ *
+ * The spawninfo stays valid until the process is reaped by proc_mgmt_try_wait(), or after
+ * enough later exits, which both only happen on init's dispatcher thread.
+ */
+struct spawninfo *proc_mgmt_find(domainid_t pid);
+
+/**
+ * @brief collects the exit status of a process if it has terminated, without blocking
+ *
+ * @param[in]  pid         the PID of the process, which may run on another core
+ * @param[out] status      its exit status, if it has terminated
+ * @param[out] terminated  whether it has terminated. It is then removed from the table.
+ *
+ * @return SYS_ERR_OK on success, SPAWN_ERR_DOMAIN_NOTFOUND if there is no such process
+ *
+ * A process on another core is asked about over UMP, so this may wait for that core.
+ */
+errval_t proc_mgmt_try_wait(domainid_t pid, int *status, bool *terminated);
+
+/**
+ * @brief answers requests of the inits on other cores about the processes spawned here
+ *
+ * @param[in] dm  the channel from one of those cores
+ */
+void proc_mgmt_register_ump_handlers(struct ump_demux *dm);
+
 /**
  * @brief terminates the process in respose to an exit message
  *
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2023, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetstr. 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#include "worker_pool.h"
+
+/// a queued job
+struct worker_job {
+    worker_fn          fn;
+    void              *arg;
+    struct worker_job *next;
+};
+
+/// jobs not picked up yet, oldest first
+static struct worker_job  *job_head;
+static struct worker_job  *job_tail;
+static struct thread_mutex job_mutex;
+static struct thread_cond  job_cond;
+
+
+static int worker_thread(void *arg)
+{
+    (void)arg;
+
+    while (true) {
+        thread_mutex_lock(&job_mutex);
+        while (job_head == NULL) {
+            thread_cond_wait(&job_cond, &job_mutex);
+        }
+        struct worker_job *job = job_head;
+        job_head = job->next;
+        if (job_head == NULL) {
+            job_tail = NULL;
+        }
+        thread_mutex_unlock(&job_mutex);
+
+        job->fn(job->arg);
+        free(job);
+    }
+    return 0;
+}
+
+errval_t worker_pool_init(void)
+{
+    thread_mutex_init(&job_mutex);
+    thread_cond_init(&job_cond);
+
+    for (int i = 0; i < WORKER_POOL_THREADS; i++) {
+        struct thread *t = thread_create(worker_thread, NULL);
+        if (t == NULL) {
+            return LIB_ERR_THREAD_CREATE;
+        }
+        thread_detach(t);
+    }
+    return SYS_ERR_OK;
+}
+
+errval_t worker_pool_submit(worker_fn fn, void *arg)
+{
+    struct worker_job *job = malloc(sizeof(*job));
+    if (job == NULL) {
+        return LIB_ERR_MALLOC_FAIL;
+    }
+    job->fn   = fn;
+    job->arg  = arg;
+    job->next = NULL;
+
+    thread_mutex_lock(&job_mutex);
+    if (job_tail == NULL) {
+        job_head = job;
+    } else {
+        job_tail->next = job;
+    }
+    job_tail = job;
+    thread_cond_signal(&job_cond);
+    thread_mutex_unlock(&job_mutex);
+    return SYS_ERR_OK;
+}
@@ -0,0 +1,46 @@
+/**
+ * \file
+ * \brief threads serving the requests that would hold up init's dispatcher
+ */
+
+/*
+ * Copyright (c) 2023, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#ifndef _INIT_WORKER_POOL_H_
+#define _INIT_WORKER_POOL_H_
+
+#include <aos/aos.h>
+
+/// number of threads taking jobs, and so of slow requests served at the same time
+#define WORKER_POOL_THREADS 4
+
+/// a job, run on one of the worker threads
+typedef void (*worker_fn)(void *arg);
+
+
+/**
+ * @brief starts the worker threads
+ *
+ * @return SYS_ERR_OK on success, LIB_ERR_THREAD_CREATE on failure
+ */
+errval_t worker_pool_init(void);
+
+/**
+ * @brief queues a job for the next idle worker thread
+ *
+ * @param[in] fn   function to run
+ * @param[in] arg  argument passed to it, owned by the job from now on
+ *
+ * @return SYS_ERR_OK on success, LIB_ERR_MALLOC_FAIL on failure
+ *
+ * Jobs are started in the order they were submitted, but may finish in any order.
+ */
+errval_t worker_pool_submit(worker_fn fn, void *arg);
+
+#endif /* _INIT_WORKER_POOL_H_ */
@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2022, The University of British Columbia.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetstr. 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#include "zero_pool.h"
+#include "mem_alloc.h"
+#include "distops/invocations.h"
+
+/// a pre-zeroed frame that is handed out from the front
+struct zero_chunk {
+    struct capref frame;  ///< frame capability covering the whole chunk
+    size_t        used;   ///< bytes already handed out
+};
+
+STATIC_ASSERT(ZERO_POOL_CHUNK_BYTES % ZERO_POOL_STEP_BYTES == 0,
+              "a chunk is cleared in whole steps");
+
+/// a chunk being cleared, a step at a time, through a mapping in our address space
+struct zero_fill {
+    struct capref frame;
+    char         *buf;     ///< NULL if no chunk is being cleared
+    size_t        zeroed;  ///< bytes cleared so far, from the front
+};
+
+/// chunks with room left, in no particular order
+static struct zero_chunk chunks[ZERO_POOL_MAX_CHUNKS];
+static int               chunk_count;
+static struct zero_fill  fill;
+
+/// a request found no chunk with enough room left while the pool was at its target size
+static bool missed;
+
+
+bool zero_pool_needs_refill(void)
+{
+    return chunk_count < ZERO_POOL_MAX_CHUNKS || missed;
+}
+
+// takes a chunk of RAM as a frame without having the kernel clear it, init hands out all
+// memory in the first place. We clear it ourselves in steps.
+static errval_t zero_pool_fill_start(void)
+{
+    errval_t err;
+
+    struct capref ram;
+    err = aos_ram_alloc(&ram, ZERO_POOL_CHUNK_BYTES);
+    if (err_is_fail(err)) {
+        return err_push(err, LIB_ERR_RAM_ALLOC);
+    }
+
+    struct capref frame;
+    err = slot_alloc(&frame);
+    if (err_is_fail(err)) {
+        aos_ram_free(ram);
+        return err_push(err, LIB_ERR_SLOT_ALLOC);
+    }
+    err = invoke_monitor_remote_cap_retype_flags(get_croot_addr(ram), get_cap_addr(ram), 0,
+                                                 ObjType_Frame, ZERO_POOL_CHUNK_BYTES, 1,
+                                                 get_croot_addr(frame), get_cnode_addr(frame),
+                                                 frame.slot, get_cnode_level(frame),
+                                                 RETYPE_FLAG_NOZERO);
+    if (err_is_fail(err)) {
+        slot_free(frame);
+        aos_ram_free(ram);
+        return err_push(err, LIB_ERR_CAP_RETYPE);
+    }
+
+    // the frame keeps the memory typed, the RAM capability is of no further use
+    err = cap_destroy(ram);
+    if (err_is_fail(err)) {
+        DEBUG_ERR(err, "deleting the RAM capability of a zeroed chunk");
+    }
+
+    void *buf;
+    err = paging_map_frame(get_current_paging_state(), &buf, ZERO_POOL_CHUNK_BYTES, frame);
+    if (err_is_fail(err)) {
+        cap_destroy(frame);
+        return err_push(err, LIB_ERR_VSPACE_MAP);
+    }
+
+    fill.frame  = frame;
+    fill.buf    = buf;
+    fill.zeroed = 0;
+    return SYS_ERR_OK;
+}
+
+// puts the cleared chunk into the pool. If the pool is at its target size, a request missed
+// it, so the chunk replaces the one with the least room left.
+static void zero_pool_fill_done(void)
+{
+    errval_t err = paging_unmap(get_current_paging_state(), fill.buf);
+    if (err_is_fail(err)) {
+        DEBUG_ERR(err, "unmapping a zeroed chunk");
+    }
+    fill.buf = NULL;
+
+    struct zero_chunk *c = &chunks[chunk_count];
+    if (chunk_count == ZERO_POOL_MAX_CHUNKS) {
+        c = &chunks[0];
+        for (int i = 1; i < chunk_count; i++) {
+            if (chunks[i].used > c->used) {
+                c = &chunks[i];
+            }
+        }
+        // only kept alive by the frames carved from it, like an exhausted chunk
+        cap_destroy(c->frame);
+    } else {
+        chunk_count++;
+    }
+    c->frame = fill.frame;
+    c->used  = 0;
+    missed   = false;
+}
+
+errval_t zero_pool_refill_step(void)
+{
+    errval_t err;
+
+    if (fill.buf == NULL) {
+        if (!zero_pool_needs_refill()) {
+            return SYS_ERR_OK;
+        }
+        err = zero_pool_fill_start();
+        if (err_is_fail(err)) {
+            return err;
+        }
+    }
+
+    memset(fill.buf + fill.zeroed, 0, ZERO_POOL_STEP_BYTES);
+    fill.zeroed += ZERO_POOL_STEP_BYTES;
+    if (fill.zeroed == ZERO_POOL_CHUNK_BYTES) {
+        zero_pool_fill_done();
+    }
+    return SYS_ERR_OK;
+}
+
+errval_t zero_pool_alloc(size_t bytes, struct capref *frame, size_t *ret_bytes)
+{
+    errval_t err;
+
+    bytes = ROUND_UP(bytes, BASE_PAGE_SIZE);
+    if (bytes == 0 || bytes > ZERO_POOL_CHUNK_BYTES) {
+        return MM_ERR_NOT_FOUND;
+    }
+
+    // carve from the fullest chunk that still fits, so the emptier ones stay available
+    // for large requests. Chunks that cannot fit are kept for smaller requests.
+    struct zero_chunk *c = NULL;
+    for (int i = 0; i < chunk_count; i++) {
+        if (chunks[i].used + bytes <= ZERO_POOL_CHUNK_BYTES
+            && (c == NULL || chunks[i].used > c->used)) {
+            c = &chunks[i];
+        }
+    }
+    if (c == NULL) {
+        // clear another chunk even if the pool is at its target size
+        missed = true;
+        return MM_ERR_NOT_FOUND;
+    }
+
+    err = slot_alloc(frame);
+    if (err_is_fail(err)) {
+        return err_push(err, LIB_ERR_SLOT_ALLOC);
+    }
+    err = frame_retype_prezeroed(*frame, c->frame, c->used, bytes);
+    if (err_is_fail(err)) {
+        slot_free(*frame);
+        return err_push(err, LIB_ERR_CAP_RETYPE);
+    }
+
+    c->used += bytes;
+    *ret_bytes = bytes;
+
+    // an exhausted chunk is only kept alive by the frames carved from it
+    if (c->used == ZERO_POOL_CHUNK_BYTES) {
+        cap_destroy(c->frame);
+        *c = chunks[--chunk_count];
+    }
+    return SYS_ERR_OK;
+}
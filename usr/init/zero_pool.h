@@ -0,0 +1,57 @@
+/**
+ * \file
+ * \brief pool of pre-zeroed frames
+ */
+
+/*
+ * Copyright (c) 2022, The University of British Columbia.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#ifndef _INIT_ZERO_POOL_H_
+#define _INIT_ZERO_POOL_H_
+
+#include <aos/aos.h>
+
+/// size of a single pre-zeroed chunk, larger requests bypass the pool
+#define ZERO_POOL_CHUNK_BYTES (16 * 1024 * 1024)
+
+/// number of chunks the pool tries to keep ready
+#define ZERO_POOL_MAX_CHUNKS 4
+
+/// bytes cleared by a single refill step, bounds how long a request may be held up by one
+#define ZERO_POOL_STEP_BYTES (256 * 1024)
+
+
+/**
+ * @brief clears another ZERO_POOL_STEP_BYTES of a chunk if the pool needs a refill
+ *
+ * This is meant to be called whenever init has nothing else to do, so the cost of
+ * clearing memory is not paid by the domain that requests a frame.
+ *
+ * @return SYS_ERR_OK on success (or if there is nothing to do), LIB_ERR_* on failure
+ */
+errval_t zero_pool_refill_step(void);
+
+/**
+ * @brief returns whether the pool is below its target size, or a request found no chunk
+ *        with enough room left since the last chunk was added
+ */
+bool zero_pool_needs_refill(void);
+
+/**
+ * @brief hands out a frame carved from a pre-zeroed chunk
+ *
+ * @param[in]  bytes      size of the requested frame
+ * @param[out] frame      returns the frame capability
+ * @param[out] ret_bytes  returns the size of the frame
+ *
+ * @return SYS_ERR_OK on success, MM_ERR_NOT_FOUND if the pool cannot satisfy the request
+ */
+errval_t zero_pool_alloc(size_t bytes, struct capref *frame, size_t *ret_bytes);
+
+#endif /* _INIT_ZERO_POOL_H_ */
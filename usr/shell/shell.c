@@ -174,26 +174,56 @@ static void handle_command(char **tokens, int num_tokens) {
             } else {
                 printf("usage: oncore [coreid] [cmdline] [&]\n");
             }
+        } else if (is_string(tokens[0], "bench")) {
+            // run the IPC benchmarks and wait for them, UMP ones cover every pair of cores
+            char *what = num_tokens > 1 ? tokens[1] : (char *)"all";
+            if (!is_string(what, "lmp") && !is_string(what, "rpc") && !is_string(what, "bulk")
+                && !is_string(what, "ump") && !is_string(what, "all")) {
+                printf("usage: bench [lmp|rpc|bulk|ump|all]\n");
+                return;
+            }
+            char cmdline[LINE_LENGTH];
+            snprintf(cmdline, sizeof(cmdline), "ipcbench %s", what);
+
+            domainid_t pid;
+            errval_t err = aos_rpc_proc_spawn_with_cmdline(rpc, cmdline, disp_get_core_id(), &pid);
+            if (err_is_fail(err) || pid == SPAWN_ERR_PID) {
+                printf("unable to run ipcbench\n");
+                return;
+            }
+            int status;
+            aos_rpc_proc_wait(rpc, pid, &status);
+            var_exit_code = status;
+            var_exit_pid = pid;
         } else if (is_string(tokens[0], "ps")) {
             // print running processes
             printf("PID:\tName:\n");
             domainid_t *pids;
             size_t num_pids;
-            aos_rpc_proc_get_all_pids(rpc, &pids, &num_pids);
+            if (err_is_fail(aos_rpc_proc_get_all_pids(rpc, &pids, &num_pids))) {
+                return;
+            }
             for (size_t i = 0; i < num_pids; i++) {
                 char *proc_name;
-                aos_rpc_proc_get_name(rpc, pids[i], &proc_name);
+                if (err_is_fail(aos_rpc_proc_get_name(rpc, pids[i], &proc_name))) {
+                    continue;
+                }
                 printf("%d\t%s\n", pids[i], proc_name);
+                free(proc_name);
             }
+            free(pids);
         } else if (is_string(tokens[0], "lsmod")) {
             // print elf modules
             printf("ELF modules on boot image:\n");
             char (*names)[][MOD_NAME_LEN];
             int name_count;
-            aos_rpc_list_elf_mod_names(rpc, &names, &name_count);
+            if (err_is_fail(aos_rpc_list_elf_mod_names(rpc, &names, &name_count))) {
+                return;
+            }
             for (int i = 0; i < name_count; i++) {
                 printf("%s\n", (*names)[i]);
             }
+            free(names);
         } else if (is_string(tokens[0], "help")) {
             // print a help message
             printf("Process management:\n");
@@ -216,6 +246,7 @@ static void handle_command(char **tokens, int num_tokens) {
             printf("\trun_memtest [size]\n");
             printf("\tlsmod\n");
             printf("\ttime [cmd]\n");
+            printf("\tbench [lmp|rpc|bulk|ump|all]\n");
             printf("\thelp\n");
         } else if (is_string(tokens[0], "ls")) {
             ramfs_opendir(fs, current_path, &current_dir_handle);
@@ -357,8 +388,7 @@ int main(int argc, char *argv[]) {
     char c;
     int length;
     while (true) {
-        aos_rpc_serial_putchar(rpc, '$');
-        aos_rpc_serial_putchar(rpc, ' ');
+        aos_rpc_serial_putstring(rpc, "$ ", 2);
         length = 0;
         while (length < LINE_LENGTH) {
             aos_rpc_serial_getchar(rpc, &c);
@@ -368,9 +398,7 @@ int main(int argc, char *argv[]) {
                 if (length > 0) {
                     // backspace was pressed
                     length--;
-                    aos_rpc_serial_putchar(rpc, '\b');
-                    aos_rpc_serial_putchar(rpc, ' ');
-                    aos_rpc_serial_putchar(rpc, '\b');
+                    aos_rpc_serial_putstring(rpc, "\b \b", 3);
                 }
             } else if (c == '\r') {
                 // start a new line and evaluate the command
@@ -0,0 +1,221 @@
+/**
+ * \file
+ * \brief lib/netutil checksum test and benchmark
+ */
+
+/*
+ * Copyright (c) 2023, The University of British Columbia.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <aos/aos.h>
+#include <aos/systime.h>
+#include <netutil/checksum.h>
+#include <netutil/htons.h>
+
+#define BUF_SIZE (64 * 1024)
+
+static uint8_t src[BUF_SIZE + 64] __attribute__((aligned(64)));
+static uint8_t dst[BUF_SIZE + 64] __attribute__((aligned(64)));
+
+// the lwIP routine lib/netutil used before, everything is compared against it
+__attribute__((noinline))
+static uint16_t ref_checksum(const void *dataptr, uint16_t len)
+{
+    uint32_t acc = 0;
+    const uint8_t *octetptr = dataptr;
+
+    while (len > 1) {
+        acc += (octetptr[0] << 8) | octetptr[1];
+        octetptr += 2;
+        len -= 2;
+    }
+    if (len > 0) {
+        acc += octetptr[0] << 8;
+    }
+    acc = (acc >> 16) + (acc & 0xffff);
+    acc = (acc >> 16) + (acc & 0xffff);
+    return ~htons((uint16_t)acc);
+}
+
+static void fill_random(uint8_t *buf, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        buf[i] = rand();
+    }
+}
+
+static bool test_checksum(void)
+{
+    fill_random(src, sizeof(src));
+
+    for (size_t off = 0; off < 16; off++) {
+        for (size_t len = 0; len < 600; len++) {
+            if (inet_checksum(src + off, len) != ref_checksum(src + off, len)) {
+                printf("inet_checksum: wrong sum, len %zu offset %zu\n", len, off);
+                return false;
+            }
+        }
+    }
+
+    // long enough to take the SIMD loop many times
+    for (size_t len = 65000; len < 65536; len += 97) {
+        if (inet_checksum(src + 3, len) != ref_checksum(src + 3, len)) {
+            printf("inet_checksum: wrong sum, len %zu\n", len);
+            return false;
+        }
+    }
+
+    // the same packet summed in two pieces
+    for (size_t split = 0; split <= 1500; split += 2) {
+        uint32_t sum = inet_checksum_partial(src, split, 0);
+        sum = inet_checksum_partial(src + split, 1500 - split, sum);
+        if (inet_checksum_fold(sum) != ref_checksum(src, 1500)) {
+            printf("inet_checksum_partial: wrong sum, split at %zu\n", split);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool test_copy(void)
+{
+    fill_random(src, 4096);
+
+    for (size_t so = 0; so < 16; so++) {
+        for (size_t d_o = 0; d_o < 16; d_o++) {
+            for (size_t len = 0; len < 300; len += (len < 80 ? 1 : 7)) {
+                memset(dst, 0xee, 400);
+                uint16_t sum = inet_checksum_copy(dst + d_o, src + so, len);
+                if (sum != ref_checksum(src + so, len)
+                    || memcmp(dst + d_o, src + so, len) != 0 || dst[d_o + len] != 0xee) {
+                    printf("inet_checksum_copy: len %zu, offsets %zu -> %zu\n", len, so, d_o);
+                    return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+static bool test_update(void)
+{
+    uint8_t hdr[20];
+
+    for (int i = 0; i < 10000; i++) {
+        fill_random(hdr, sizeof(hdr));
+        hdr[10] = hdr[11] = 0;
+        uint16_t check = ref_checksum(hdr, sizeof(hdr));
+
+        // rewrite TTL and protocol, then the destination address
+        uint16_t old16, new16 = rand();
+        memcpy(&old16, &hdr[8], 2);
+        memcpy(&hdr[8], &new16, 2);
+        check = inet_checksum_update16(check, old16, new16);
+
+        uint32_t old32, new32 = rand();
+        memcpy(&old32, &hdr[16], 4);
+        memcpy(&hdr[16], &new32, 4);
+        check = inet_checksum_update32(check, old32, new32);
+
+        // with the updated checksum in place the header has to sum up to zero
+        memcpy(&hdr[10], &check, 2);
+        if (ref_checksum(hdr, sizeof(hdr)) != 0) {
+            printf("inet_checksum_update: wrong sum in round %d\n", i);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void report(const char *name, size_t len, size_t rounds, systime_t t_new,
+                   systime_t t_ref)
+{
+    uint64_t bytes = (uint64_t)len * rounds;
+    uint64_t ns_new = systime_to_ns(t_new);
+    uint64_t ns_ref = systime_to_ns(t_ref);
+
+    printf("%-14s %6zu B: %6" PRIu64 " MB/s, before %6" PRIu64 " MB/s\n", name, len,
+           ns_new ? bytes * 1000 / ns_new : 0, ns_ref ? bytes * 1000 / ns_ref : 0);
+}
+
+/*
+ * The first byte changes every round, so no sum can be computed once and reused. Both
+ * versions see the same data and have to arrive at the same total.
+ */
+static bool bench(void)
+{
+    static const size_t lens[] = { 20, 64, 576, 1500, 9000, 65535 };
+
+    for (size_t i = 0; i < ARRAY_LENGTH(lens); i++) {
+        size_t len = lens[i];
+        size_t rounds = 32 * BUF_SIZE / len;
+        uint32_t sum_new = 0, sum_ref = 0;
+        systime_t start, t_new, t_ref;
+
+        start = systime_now();
+        for (size_t k = 0; k < rounds; k++) {
+            src[0] = k;
+            sum_new += inet_checksum(src, len);
+        }
+        t_new = systime_now() - start;
+
+        start = systime_now();
+        for (size_t k = 0; k < rounds; k++) {
+            src[0] = k;
+            sum_ref += ref_checksum(src, len);
+        }
+        t_ref = systime_now() - start;
+        report("checksum", len, rounds, t_new, t_ref);
+
+        start = systime_now();
+        for (size_t k = 0; k < rounds; k++) {
+            src[0] = k;
+            sum_new += inet_checksum_copy(dst, src, len);
+        }
+        t_new = systime_now() - start;
+
+        start = systime_now();
+        for (size_t k = 0; k < rounds; k++) {
+            src[0] = k;
+            memcpy(dst, src, len);
+            sum_ref += ref_checksum(dst, len);
+        }
+        t_ref = systime_now() - start;
+        report("copy+checksum", len, rounds, t_new, t_ref);
+
+        if (sum_new != sum_ref) {
+            printf("checksumbench: sums differ for %zu bytes\n", len);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    if (!test_checksum() || !test_copy() || !test_update()) {
+        printf("checksumbench: FAILED\n");
+        return EXIT_FAILURE;
+    }
+    printf("checksumbench: checks passed\n");
+
+    // -n skips the benchmark
+    if (argc > 1 && strcmp(argv[1], "-n") == 0) {
+        return EXIT_SUCCESS;
+    }
+
+    return bench() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
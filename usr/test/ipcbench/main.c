@@ -0,0 +1,532 @@
+/**
+ * \file
+ * \brief IPC microbenchmarks
+ *
+ * Measures raw LMP messages to a copy of this program, aos_rpc calls to init, payload
+ * transfers to init by size and UMP messages between the inits of every pair of cores.
+ * Times are cycles of the core read with rdccnt(), reported as percentiles of many rounds
+ * after a few warm-up rounds, with the median also in ns.
+ *
+ * Not measured: the serial calls, which wait for or write to the console, pause, resume
+ * and kill, which need a victim process each round, proc_exit, which ends the caller, and
+ * ns_bind_ump, which needs a server on another core.
+ *
+ * usage: ipcbench [lmp|rpc|bulk|ump|all]
+ */
+
+/*
+ * Copyright (c) 2023, The University of British Columbia.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <aos/aos.h>
+#include <aos/aos_rpc.h>
+#include <aos/systime.h>
+#include <barrelfish_kpi/asm_inlines_arch.h>
+
+#define BENCH_ROUNDS    1000
+#define BENCH_WARMUP    16
+
+static cycles_t samples[BENCH_ROUNDS];
+static cycles_t samples_oneway[BENCH_ROUNDS];
+
+/// cycles of this core per microsecond, measured against the system counter
+static uint64_t cycles_per_us;
+
+static void calibrate(void)
+{
+    systime_t start = systime_now();
+    cycles_t cstart = rdccnt();
+    while (systime_now() - start < us_to_systime(10000)) {
+    }
+    cycles_t cend = rdccnt();
+    systime_t end = systime_now();
+    cycles_per_us = (cend - cstart) / MAX(systime_to_us(end - start), 1);
+}
+
+static uint64_t cycles_to_ns(cycles_t c)
+{
+    return cycles_per_us ? c * 1000 / cycles_per_us : 0;
+}
+
+static int cmp_cycles(const void *a, const void *b)
+{
+    cycles_t x = *(const cycles_t *)a, y = *(const cycles_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void report(const char *name, cycles_t *s, size_t n)
+{
+    if (n == 0) {
+        return;
+    }
+    qsort(s, n, sizeof(*s), cmp_cycles);
+    printf("%-26s min %7" PRIu64 " p50 %7" PRIu64 " p90 %7" PRIu64 " p99 %7" PRIu64
+           " max %7" PRIu64 " (p50 %" PRIu64 " ns)\n", name, s[0], s[n / 2], s[n * 9 / 10],
+           s[n * 99 / 100], s[n - 1], cycles_to_ns(s[n / 2]));
+}
+
+/*
+ * ------------------------------------------------------------------------------------------------
+ * Raw LMP
+ * ------------------------------------------------------------------------------------------------
+ */
+
+static struct lmp_chan lmp;
+static struct lmp_recv_msg lmp_msg;
+static struct capref lmp_cap;
+static bool lmp_received;
+
+static void lmp_recv_handler(void *arg)
+{
+    struct lmp_chan *lc = arg;
+    errval_t err;
+
+    lmp_msg = (struct lmp_recv_msg)LMP_RECV_MSG_INIT;
+    err = lmp_chan_recv(lc, &lmp_msg, &lmp_cap);
+    if (err_is_ok(err)) {
+        lmp_received = true;
+    } else if (!lmp_err_is_transient(err) && err_no(err) != LIB_ERR_NO_LMP_MSG) {
+        USER_PANIC_ERR(err, "receiving LMP message");
+    }
+    err = lmp_chan_register_recv(lc, get_default_waitset(), MKCLOSURE(lmp_recv_handler, lc));
+    if (err_is_fail(err)) {
+        USER_PANIC_ERR(err, "registering LMP receive handler");
+    }
+}
+
+static void lmp_wait(void)
+{
+    lmp_received = false;
+    while (!lmp_received) {
+        errval_t err = event_dispatch(get_default_waitset());
+        if (err_is_fail(err)) {
+            USER_PANIC_ERR(err, "dispatching LMP message");
+        }
+    }
+}
+
+static void lmp_send(struct capref cap, size_t words, uintptr_t *w)
+{
+    errval_t err;
+    do {
+        err = lmp_ep_send(lmp.remote_cap, LMP_SEND_FLAGS_DEFAULT, cap, words, w[0], w[1], w[2],
+                          w[3], w[4], w[5], w[6], w[7]);
+        if (lmp_err_is_transient(err)) {
+            thread_yield();
+        }
+    } while (lmp_err_is_transient(err));
+    if (err_is_fail(err)) {
+        USER_PANIC_ERR(err, "sending LMP message");
+    }
+}
+
+static void lmp_init(struct capref remote)
+{
+    errval_t err;
+
+    err = lmp_chan_accept(&lmp, DEFAULT_LMP_BUF_WORDS, remote);
+    if (err_is_fail(err)) {
+        USER_PANIC_ERR(err, "creating LMP endpoint");
+    }
+    err = lmp_chan_alloc_recv_slot(&lmp);
+    if (err_is_fail(err)) {
+        USER_PANIC_ERR(err, "allocating LMP receive slot");
+    }
+    err = lmp_chan_register_recv(&lmp, get_default_waitset(), MKCLOSURE(lmp_recv_handler, &lmp));
+    if (err_is_fail(err)) {
+        USER_PANIC_ERR(err, "registering LMP receive handler");
+    }
+}
+
+/*
+ * The child echoes every message, with the one-way latency it observed in the first
+ * word, which carries the send time. A message with a zero first word ends it.
+ */
+static int lmp_echo(void)
+{
+    struct capref parent = {
+        .cnode = {
+            .croot = get_croot_addr(cap_root),
+            .cnode = ROOTCN_SLOT_ADDR(ROOTCN_SLOT_SLOT_ALLOC0),
+            .level = CNODE_TYPE_OTHER,
+        },
+        .slot = 0,
+    };
+    lmp_init(parent);
+    uintptr_t w[LMP_MSG_LENGTH] = { 0 };
+    lmp_send(lmp.local_cap, 0, w);
+
+    while (true) {
+        lmp_wait();
+        cycles_t now = rdccnt();
+        if (lmp_msg.words[0] == 0) {
+            break;
+        }
+        memcpy(w, lmp_msg.words, sizeof(w));
+        w[0] = now - lmp_msg.words[0];
+        lmp_send(NULL_CAP, lmp_msg.buf.msglen, w);
+
+        // outside the round trip, the parent waits for the echo before sending again
+        if (!capref_is_null(lmp_cap)) {
+            cap_destroy(lmp_cap);
+            lmp_chan_alloc_recv_slot(&lmp);
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+static void bench_lmp(void)
+{
+    errval_t err;
+
+    printf("LMP to a process on the same core, in cycles:\n");
+    lmp_init(NULL_CAP);
+
+    domainid_t pid;
+    const char *argv[] = { "ipcbench", "lmp-echo" };
+    err = aos_rpc_proc_spawn_with_caps(aos_rpc_get_process_channel(), 2, argv, 1, lmp.local_cap,
+                                       disp_get_core_id(), &pid);
+    if (err_is_fail(err)) {
+        DEBUG_ERR(err, "spawning the echo process");
+        return;
+    }
+    lmp_wait();
+    lmp.remote_cap = lmp_cap;
+    lmp_chan_alloc_recv_slot(&lmp);
+
+    struct capref frame;
+    err = frame_alloc(&frame, BASE_PAGE_SIZE, NULL);
+    if (err_is_fail(err)) {
+        DEBUG_ERR(err, "allocating a frame to send");
+        return;
+    }
+
+    uintptr_t w[LMP_MSG_LENGTH] = { 0 };
+    for (int with_cap = 0; with_cap < 2; with_cap++) {
+        for (size_t words = 1; words <= LMP_MSG_LENGTH; words++) {
+            for (int i = 0; i < BENCH_WARMUP + BENCH_ROUNDS; i++) {
+                cycles_t start = rdccnt();
+                w[0] = start;
+                lmp_send(with_cap ? frame : NULL_CAP, words, w);
+                lmp_wait();
+                cycles_t end = rdccnt();
+                if (i >= BENCH_WARMUP) {
+                    samples[i - BENCH_WARMUP] = end - start;
+                    samples_oneway[i - BENCH_WARMUP] = lmp_msg.words[0];
+                }
+            }
+            char name[32];
+            snprintf(name, sizeof(name), "one-way %zu words%s", words, with_cap ? " + cap" : "");
+            report(name, samples_oneway, BENCH_ROUNDS);
+            snprintf(name, sizeof(name), "round trip %zu words%s", words,
+                     with_cap ? " + cap" : "");
+            report(name, samples, BENCH_ROUNDS);
+        }
+    }
+
+    w[0] = 0;
+    lmp_send(NULL_CAP, 1, w);
+    cap_destroy(frame);
+}
+
+/*
+ * ------------------------------------------------------------------------------------------------
+ * aos_rpc calls
+ * ------------------------------------------------------------------------------------------------
+ */
+
+// a call to time, a capability it returns is deleted outside the measurement
+struct rpc_bench {
+    const char *name;
+    errval_t (*call)(struct capref *ret);
+    int rounds;
+};
+
+static errval_t rpc_number(struct capref *ret)
+{
+    (void)ret;
+    return aos_rpc_send_number(aos_rpc_get_init_channel(), 42);
+}
+
+static errval_t rpc_string(struct capref *ret)
+{
+    (void)ret;
+    return aos_rpc_bench_sink(aos_rpc_get_init_channel(), "hello init", 11);
+}
+
+static errval_t rpc_send_string(struct capref *ret)
+{
+    (void)ret;
+    return aos_rpc_send_string(aos_rpc_get_init_channel(), "ipcbench");
+}
+
+static errval_t rpc_ram_cap(struct capref *ret)
+{
+    size_t bytes;
+    return aos_rpc_get_ram_cap(aos_rpc_get_memory_channel(), BASE_PAGE_SIZE, BASE_PAGE_SIZE,
+                               ret, &bytes);
+}
+
+static errval_t rpc_zeroed_frame(struct capref *ret)
+{
+    size_t bytes;
+    return aos_rpc_get_zeroed_frame(aos_rpc_get_memory_channel(), BASE_PAGE_SIZE, ret, &bytes);
+}
+
+static errval_t rpc_all_pids(struct capref *ret)
+{
+    (void)ret;
+    domainid_t *pids;
+    size_t num;
+    errval_t err = aos_rpc_proc_get_all_pids(aos_rpc_get_process_channel(), &pids, &num);
+    if (err_is_ok(err)) {
+        free(pids);
+    }
+    return err;
+}
+
+static errval_t rpc_get_name(struct capref *ret)
+{
+    (void)ret;
+    char *name;
+    errval_t err = aos_rpc_proc_get_name(aos_rpc_get_process_channel(), disp_get_domain_id(),
+                                         &name);
+    if (err_is_ok(err)) {
+        free(name);
+    }
+    return err;
+}
+
+static errval_t rpc_get_pid(struct capref *ret)
+{
+    (void)ret;
+    domainid_t pid;
+    return aos_rpc_proc_get_pid(aos_rpc_get_process_channel(), "ipcbench", &pid);
+}
+
+static errval_t rpc_get_status(struct capref *ret)
+{
+    (void)ret;
+    coreid_t core;
+    char cmdline[64];
+    uint8_t state;
+    int exit_code;
+    return aos_rpc_proc_get_status(aos_rpc_get_process_channel(), disp_get_domain_id(), &core,
+                                   cmdline, sizeof(cmdline), &state, &exit_code);
+}
+
+static errval_t rpc_spawn_wait(struct capref *ret)
+{
+    (void)ret;
+    domainid_t pid;
+    int status;
+    errval_t err = aos_rpc_proc_spawn_with_cmdline(aos_rpc_get_process_channel(), "ipcbench noop",
+                                                   disp_get_core_id(), &pid);
+    if (err_is_ok(err)) {
+        err = aos_rpc_proc_wait(aos_rpc_get_process_channel(), pid, &status);
+    }
+    return err;
+}
+
+static errval_t rpc_ns_register(struct capref *ret)
+{
+    (void)ret;
+    errval_t err = aos_rpc_ns_register(aos_rpc_get_init_channel(), "ipcbench.rpc", cap_selfep);
+    if (err_is_ok(err)) {
+        err = aos_rpc_ns_deregister(aos_rpc_get_init_channel(), "ipcbench.rpc");
+    }
+    return err;
+}
+
+static errval_t rpc_ns_lookup(struct capref *ret)
+{
+    coreid_t core;
+    return aos_rpc_ns_lookup(aos_rpc_get_init_channel(), "ipcbench", &core, ret);
+}
+
+static errval_t rpc_ns_enumerate(struct capref *ret)
+{
+    (void)ret;
+    static uint64_t out[AOS_RPC_BULK_SIZE / sizeof(uint64_t)];
+    return aos_rpc_ns_enumerate(aos_rpc_get_init_channel(), "ipcbench",
+                                (struct ns_frame_output *)out);
+}
+
+static errval_t rpc_mod_names(struct capref *ret)
+{
+    (void)ret;
+    char (*names)[][MOD_NAME_LEN];
+    int num;
+    errval_t err = aos_rpc_list_elf_mod_names(aos_rpc_get_process_channel(), &names, &num);
+    if (err_is_ok(err)) {
+        free(names);
+    }
+    return err;
+}
+
+static const struct rpc_bench rpc_benches[] = {
+    // init prints every number and string it receives
+    { "send_number", rpc_number, 64 },
+    { "send_string", rpc_send_string, 64 },
+    { "short payload", rpc_string, BENCH_ROUNDS },
+    { "get_ram_cap 4K", rpc_ram_cap, 128 },
+    { "get_zeroed_frame 4K", rpc_zeroed_frame, 128 },
+    { "proc_get_all_pids", rpc_all_pids, BENCH_ROUNDS },
+    { "proc_get_status", rpc_get_status, BENCH_ROUNDS },
+    { "proc_get_name", rpc_get_name, BENCH_ROUNDS },
+    { "proc_get_pid", rpc_get_pid, BENCH_ROUNDS },
+    { "list_elf_mod_names", rpc_mod_names, BENCH_ROUNDS },
+    { "ns_register + deregister", rpc_ns_register, BENCH_ROUNDS },
+    { "ns_lookup", rpc_ns_lookup, BENCH_ROUNDS },
+    { "ns_enumerate", rpc_ns_enumerate, BENCH_ROUNDS },
+    // a whole process each round
+    { "spawn + wait", rpc_spawn_wait, 16 },
+};
+
+static void bench_rpc(void)
+{
+    // looked up by ns_lookup, a name that nobody binds to
+    errval_t err = aos_rpc_ns_register(aos_rpc_get_init_channel(), "ipcbench", cap_selfep);
+    if (err_is_fail(err)) {
+        DEBUG_ERR(err, "registering a name to look up");
+    }
+
+    printf("aos_rpc calls to init, in cycles:\n");
+    for (size_t b = 0; b < ARRAY_LENGTH(rpc_benches); b++) {
+        const struct rpc_bench *rb = &rpc_benches[b];
+        int n = 0;
+        for (int i = 0; i < BENCH_WARMUP + rb->rounds; i++) {
+            struct capref ret = NULL_CAP;
+            cycles_t start = rdccnt();
+            errval_t err = rb->call(&ret);
+            cycles_t end = rdccnt();
+            if (err_is_fail(err)) {
+                DEBUG_ERR(err, "%s", rb->name);
+                break;
+            }
+            if (!capref_is_null(ret)) {
+                cap_destroy(ret);
+            }
+            if (i >= BENCH_WARMUP) {
+                samples[n++] = end - start;
+            }
+        }
+        report(rb->name, samples, n);
+    }
+
+    err = aos_rpc_ns_deregister(aos_rpc_get_init_channel(), "ipcbench");
+    if (err_is_fail(err)) {
+        DEBUG_ERR(err, "deregistering the name to look up");
+    }
+}
+
+/*
+ * ------------------------------------------------------------------------------------------------
+ * Payload transfers
+ * ------------------------------------------------------------------------------------------------
+ */
+
+static char payload[AOS_RPC_BULK_SIZE];
+
+static void bench_bulk(void)
+{
+    static const size_t sizes[] = { 8, 64, 256, AOS_RPC_INLINE_MAX, AOS_RPC_INLINE_MAX + 1,
+                                    1024, 2048, AOS_RPC_BULK_SIZE };
+
+    printf("payloads sent to init, inline up to %d bytes, in cycles:\n", AOS_RPC_INLINE_MAX);
+    memset(payload, 'x', sizeof(payload));
+    for (size_t s = 0; s < ARRAY_LENGTH(sizes); s++) {
+        for (int i = 0; i < BENCH_WARMUP + BENCH_ROUNDS; i++) {
+            cycles_t start = rdccnt();
+            errval_t err = aos_rpc_bench_sink(aos_rpc_get_init_channel(), payload, sizes[s]);
+            cycles_t end = rdccnt();
+            if (err_is_fail(err)) {
+                DEBUG_ERR(err, "sending %zu bytes", sizes[s]);
+                return;
+            }
+            if (i >= BENCH_WARMUP) {
+                samples[i - BENCH_WARMUP] = end - start;
+            }
+        }
+        char name[32];
+        snprintf(name, sizeof(name), "%zu bytes", sizes[s]);
+        report(name, samples, BENCH_ROUNDS);
+        uint64_t ns = cycles_to_ns(samples[BENCH_ROUNDS / 2]);
+        printf("%-26s %" PRIu64 " MB/s at p50\n", "", ns ? sizes[s] * 1000 / ns : 0);
+    }
+}
+
+/*
+ * ------------------------------------------------------------------------------------------------
+ * UMP
+ * ------------------------------------------------------------------------------------------------
+ */
+
+static void bench_ump(void)
+{
+    static struct ump_bench_result res;
+
+    printf("UMP messages between the inits of two cores, in cycles:\n");
+    for (coreid_t from = 0; from < UMP_MAX_CORES; from++) {
+        for (coreid_t to = 0; to < UMP_MAX_CORES; to++) {
+            if (from == to) {
+                continue;
+            }
+            errval_t err = aos_rpc_bench_ump(aos_rpc_get_init_channel(), from, to, &res);
+            if (err_no(err) == MON_ERR_INVALID_CORE_ID) {
+                continue;
+            } else if (err_is_fail(err)) {
+                DEBUG_ERR(err, "UMP from core %d to core %d", from, to);
+                continue;
+            }
+
+            char name[32];
+            snprintf(name, sizeof(name), "round trip %d -> %d", from, to);
+            memcpy(samples, res.rtt, sizeof(res.rtt));
+            report(name, samples, UMP_BENCH_ROUNDS);
+            uint64_t ns = cycles_to_ns(res.stream_cycles);
+            printf("%-26s %" PRIu64 " messages/ms, %" PRIu64 " MB/s\n", "",
+                   ns ? (uint64_t)UMP_BENCH_STREAM * 1000000 / ns : 0,
+                   ns ? (uint64_t)UMP_BENCH_STREAM * sizeof(struct ump_payload) * 1000 / ns : 0);
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const char *what = argc > 1 ? argv[1] : "all";
+    bool all = strcmp(what, "all") == 0;
+
+    if (strcmp(what, "lmp-echo") == 0) {
+        return lmp_echo();
+    }
+    if (strcmp(what, "noop") == 0) {
+        return EXIT_SUCCESS;
+    }
+
+    calibrate();
+    printf("ipcbench: %d rounds, %" PRIu64 " cycles per us\n", BENCH_ROUNDS, cycles_per_us);
+    if (all || strcmp(what, "lmp") == 0) {
+        bench_lmp();
+    }
+    if (all || strcmp(what, "rpc") == 0) {
+        bench_rpc();
+    }
+    if (all || strcmp(what, "bulk") == 0) {
+        bench_bulk();
+    }
+    if (all || strcmp(what, "ump") == 0) {
+        bench_ump();
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,344 @@
+/**
+ * \file
+ * \brief Correctness and throughput tests for the libc string functions
+ *
+ * Checks memcpy, memmove, memset, memcmp, strlen and strchr against simple
+ * byte-at-a-time reference versions for all small sizes and alignments, then
+ * reports the throughput of the libc versions against the reference ones.
+ */
+
+/*
+ * Copyright (c) 2023, The University of British Columbia.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <aos/aos.h>
+#include <aos/systime.h>
+
+#define BUF_SIZE        (64 * 1024)
+#define MAX_CHECK_LEN   300
+#define MAX_ALIGN       16
+
+// keep the compiler from turning the reference loops back into libc calls
+#define REFERENCE __attribute__((noinline, optimize("no-tree-loop-distribute-patterns")))
+
+static uint8_t buf_a[BUF_SIZE + 2 * MAX_ALIGN] __attribute__((aligned(64)));
+static uint8_t buf_b[BUF_SIZE + 2 * MAX_ALIGN] __attribute__((aligned(64)));
+static uint8_t buf_ref[BUF_SIZE + 2 * MAX_ALIGN] __attribute__((aligned(64)));
+
+static size_t failures;
+
+// results of the benchmarked calls go here so they are not optimised away
+static volatile uintptr_t bench_sink;
+
+REFERENCE static void *ref_memmove(void *dst, const void *src, size_t n)
+{
+    uint8_t *d = dst;
+    const uint8_t *s = src;
+    if (d < s) {
+        for (size_t i = 0; i < n; i++) {
+            d[i] = s[i];
+        }
+    } else {
+        for (size_t i = n; i > 0; i--) {
+            d[i - 1] = s[i - 1];
+        }
+    }
+    return dst;
+}
+
+REFERENCE static void *ref_memset(void *dst, int c, size_t n)
+{
+    uint8_t *d = dst;
+    for (size_t i = 0; i < n; i++) {
+        d[i] = c;
+    }
+    return dst;
+}
+
+REFERENCE static int ref_memcmp(const void *a, const void *b, size_t n)
+{
+    const uint8_t *x = a, *y = b;
+    for (size_t i = 0; i < n; i++) {
+        if (x[i] != y[i]) {
+            return x[i] - y[i];
+        }
+    }
+    return 0;
+}
+
+REFERENCE static size_t ref_strlen(const char *s)
+{
+    size_t n = 0;
+    while (s[n] != '\0') {
+        n++;
+    }
+    return n;
+}
+
+REFERENCE static char *ref_strchr(const char *s, int c)
+{
+    for (;; s++) {
+        if (*s == (char)c) {
+            return (char *)s;
+        }
+        if (*s == '\0') {
+            return NULL;
+        }
+    }
+}
+
+static int sign(int x)
+{
+    return (x > 0) - (x < 0);
+}
+
+static void fill_pattern(uint8_t *buf, size_t len, unsigned seed)
+{
+    for (size_t i = 0; i < len; i++) {
+        buf[i] = (uint8_t)(seed + i * 7 + (i >> 8));
+    }
+}
+
+#define CHECK(cond, fmt, ...)                                                   \
+    do {                                                                        \
+        if (!(cond)) {                                                          \
+            if (failures++ < 10) {                                              \
+                printf("FAIL %s:%d: " fmt "\n", __func__, __LINE__, ##__VA_ARGS__); \
+            }                                                                   \
+        }                                                                       \
+    } while (0)
+
+static void check_memcpy(void)
+{
+    for (size_t sa = 0; sa < MAX_ALIGN; sa++) {
+        for (size_t da = 0; da < MAX_ALIGN; da++) {
+            for (size_t n = 0; n <= MAX_CHECK_LEN; n++) {
+                fill_pattern(buf_a, MAX_CHECK_LEN + 2 * MAX_ALIGN, n);
+                memset(buf_b, 0xaa, MAX_CHECK_LEN + 2 * MAX_ALIGN);
+                memcpy(buf_b + da, buf_a + sa, n);
+                ref_memset(buf_ref, 0xaa, MAX_CHECK_LEN + 2 * MAX_ALIGN);
+                ref_memmove(buf_ref + da, buf_a + sa, n);
+                CHECK(ref_memcmp(buf_b, buf_ref, MAX_CHECK_LEN + 2 * MAX_ALIGN) == 0,
+                      "n=%zu sa=%zu da=%zu", n, sa, da);
+            }
+        }
+    }
+}
+
+static void check_memmove(void)
+{
+    // overlapping moves in both directions, by every distance up to 80 and a spread of
+    // larger ones up to MAX_CHECK_LEN
+    const size_t span = 2 * MAX_CHECK_LEN + 2 * MAX_ALIGN;
+    for (size_t n = 0; n <= MAX_CHECK_LEN; n++) {
+        for (size_t dist = 0; dist <= MAX_CHECK_LEN; dist += (dist < 80 ? 1 : 13)) {
+            for (int dir = 0; dir < 2; dir++) {
+                size_t src = dir ? MAX_ALIGN + dist : MAX_ALIGN;
+                size_t dst = dir ? MAX_ALIGN : MAX_ALIGN + dist;
+                fill_pattern(buf_b, span, n + dist);
+                fill_pattern(buf_ref, span, n + dist);
+                memmove(buf_b + dst, buf_b + src, n);
+                ref_memmove(buf_ref + dst, buf_ref + src, n);
+                CHECK(ref_memcmp(buf_b, buf_ref, span) == 0,
+                      "n=%zu dist=%zu dir=%d", n, dist, dir);
+            }
+        }
+    }
+}
+
+static void check_memset(void)
+{
+    static const int values[] = { 0, 0x5a, 0xff, 0x1234 };
+    for (size_t v = 0; v < sizeof(values) / sizeof(values[0]); v++) {
+        for (size_t da = 0; da < MAX_ALIGN; da++) {
+            for (size_t n = 0; n <= MAX_CHECK_LEN; n++) {
+                fill_pattern(buf_b, MAX_CHECK_LEN + 2 * MAX_ALIGN, n);
+                fill_pattern(buf_ref, MAX_CHECK_LEN + 2 * MAX_ALIGN, n);
+                memset(buf_b + da, values[v], n);
+                ref_memset(buf_ref + da, values[v], n);
+                CHECK(ref_memcmp(buf_b, buf_ref, MAX_CHECK_LEN + 2 * MAX_ALIGN) == 0,
+                      "n=%zu da=%zu c=%x", n, da, values[v]);
+            }
+        }
+    }
+
+    // large zero fills take the DC ZVA path
+    for (size_t n = 4096 - 3; n <= 4096 + 3; n++) {
+        fill_pattern(buf_b, n + 2 * MAX_ALIGN, n);
+        memset(buf_b + 5, 0, n);
+        CHECK(buf_b[4] == (uint8_t)(n + 4 * 7) && buf_b[n + 5] == (uint8_t)(n + (n + 5) * 7 + ((n + 5) >> 8)),
+              "zva fill n=%zu overran", n);
+        for (size_t i = 0; i < n; i++) {
+            if (buf_b[5 + i] != 0) {
+                CHECK(false, "zva fill n=%zu byte %zu not zero", n, i);
+                break;
+            }
+        }
+    }
+}
+
+static void check_memcmp(void)
+{
+    for (size_t a = 0; a < MAX_ALIGN; a++) {
+        for (size_t n = 0; n <= MAX_CHECK_LEN; n++) {
+            fill_pattern(buf_a + a, n, 3);
+            fill_pattern(buf_b, n, 3);
+            CHECK(memcmp(buf_a + a, buf_b, n) == 0, "equal n=%zu a=%zu", n, a);
+            // every position near either end, where the blocks and the tail meet, and a
+            // spread of the ones in between
+            for (size_t pos = 0; pos < n; pos += (pos < 80 || pos + 80 >= n ? 1 : 7)) {
+                uint8_t saved = buf_b[pos];
+                buf_b[pos] = saved + 0x80;   // differ in the sign bit too
+                CHECK(sign(memcmp(buf_a + a, buf_b, n))
+                      == sign(ref_memcmp(buf_a + a, buf_b, n)),
+                      "n=%zu a=%zu pos=%zu", n, a, pos);
+                buf_b[pos] = saved;
+            }
+        }
+    }
+}
+
+static void check_strings(void)
+{
+    char *s = (char *)buf_a;
+    for (size_t a = 0; a < MAX_ALIGN; a++) {
+        for (size_t n = 0; n <= MAX_CHECK_LEN; n++) {
+            for (size_t i = 0; i < n; i++) {
+                s[a + i] = 'a' + (i % 26);
+            }
+            s[a + n] = '\0';
+            s[a + n + 1] = 'z';
+            CHECK(strlen(s + a) == n, "strlen n=%zu a=%zu got %zu", n, a, strlen(s + a));
+            CHECK(strchr(s + a, '\0') == s + a + n, "strchr nul n=%zu a=%zu", n, a);
+            CHECK(strchr(s + a, 'z') == ref_strchr(s + a, 'z'), "strchr past nul n=%zu", n);
+            for (char c = 'a'; c <= 'f'; c++) {
+                CHECK(strchr(s + a, c) == ref_strchr(s + a, c),
+                      "strchr '%c' n=%zu a=%zu", c, n, a);
+            }
+            CHECK(strchr(s + a, 0x100 + 'b') == ref_strchr(s + a, 'b'),
+                  "strchr int truncation n=%zu", n);
+        }
+    }
+}
+
+static uint64_t time_ns(systime_t start)
+{
+    return systime_to_ns(systime_now() - start);
+}
+
+static void report(const char *name, size_t bytes, size_t iters, uint64_t ns_lib,
+                   uint64_t ns_ref)
+{
+    uint64_t total = (uint64_t)bytes * iters;
+    printf("%-8s %6zu B: libc %6" PRIu64 " MB/s, reference %6" PRIu64 " MB/s\n",
+           name, bytes, ns_lib ? total * 1000 / ns_lib : 0,
+           ns_ref ? total * 1000 / ns_ref : 0);
+}
+
+static void bench(void)
+{
+    static const size_t sizes[] = { 16, 64, 256, 4096, BUF_SIZE };
+    char *s = (char *)buf_a;
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        size_t n = sizes[i];
+        size_t iters = (16 * BUF_SIZE) / n;
+        systime_t t;
+        uint64_t lib, ref;
+
+        t = systime_now();
+        for (size_t k = 0; k < iters; k++) {
+            memcpy(buf_b, buf_a, n);
+        }
+        lib = time_ns(t);
+        t = systime_now();
+        for (size_t k = 0; k < iters; k++) {
+            ref_memmove(buf_b, buf_a, n);
+        }
+        ref = time_ns(t);
+        report("memcpy", n, iters, lib, ref);
+
+        t = systime_now();
+        for (size_t k = 0; k < iters; k++) {
+            memset(buf_b, 0, n);
+        }
+        lib = time_ns(t);
+        t = systime_now();
+        for (size_t k = 0; k < iters; k++) {
+            ref_memset(buf_b, 0, n);
+        }
+        ref = time_ns(t);
+        report("memset", n, iters, lib, ref);
+
+        memcpy(buf_b, buf_a, n);
+        t = systime_now();
+        for (size_t k = 0; k < iters; k++) {
+            bench_sink += (uintptr_t)memcmp(buf_a, buf_b, n);
+        }
+        lib = time_ns(t);
+        t = systime_now();
+        for (size_t k = 0; k < iters; k++) {
+            bench_sink += (uintptr_t)ref_memcmp(buf_a, buf_b, n);
+        }
+        ref = time_ns(t);
+        report("memcmp", n, iters, lib, ref);
+
+        memset(s, 'x', n - 1);
+        s[n - 1] = '\0';
+        t = systime_now();
+        for (size_t k = 0; k < iters; k++) {
+            bench_sink += (uintptr_t)strlen(s);
+        }
+        lib = time_ns(t);
+        t = systime_now();
+        for (size_t k = 0; k < iters; k++) {
+            bench_sink += (uintptr_t)ref_strlen(s);
+        }
+        ref = time_ns(t);
+        report("strlen", n, iters, lib, ref);
+
+        t = systime_now();
+        for (size_t k = 0; k < iters; k++) {
+            bench_sink += (uintptr_t)strchr(s, 'y');
+        }
+        lib = time_ns(t);
+        t = systime_now();
+        for (size_t k = 0; k < iters; k++) {
+            bench_sink += (uintptr_t)ref_strchr(s, 'y');
+        }
+        ref = time_ns(t);
+        report("strchr", n, iters, lib, ref);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    bool run_bench = !(argc > 1 && strcmp(argv[1], "-n") == 0);
+
+    check_memcpy();
+    check_memmove();
+    check_memset();
+    check_memcmp();
+    check_strings();
+
+    if (failures != 0) {
+        printf("stringtest: %zu checks FAILED\n", failures);
+        return EXIT_FAILURE;
+    }
+    printf("stringtest: all checks passed\n");
+
+    if (run_bench) {
+        bench();
+    }
+
+    return EXIT_SUCCESS;
+}